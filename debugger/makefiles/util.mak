@@ -16,3 +16,9 @@ RM = rm -rvf --no-preserve-root
 ECHO = echo
 
 export MKDIR RM ECHO
+
+# Logging messages with the level higher than LOG_LEVEL_MAX are removed at
+# compile time, e.g. 'make LOG_LEVEL_MAX=3' removes all RISCV_debug calls.
+ifneq ($(LOG_LEVEL_MAX), )
+  LOG_CFLAGS = -DRISCV_LOG_LEVEL_MAX=$(LOG_LEVEL_MAX)
+endif
@@ -0,0 +1,88 @@
+"""
+ @copyright  Copyright 2019 Sergey Khabarov. All right reserved.
+ @author     Sergey Khabarov - sergeykhbr@gmail.com
+ @brief      Cycle-count equality check of the River SystemC model.
+
+ Runs the dhrystone scenario of autotest1.py on sysc_river_gui.json and
+ reads clock/step counters ('cpi') and registers ('regs') after each
+ stage. Results of the reference build are stored with 'save', any
+ change of the RTL model has to pass 'check' with the same counters:
+
+     python rtlcheck1.py save rtl_ref.txt [appdbg64g] [config]
+     python rtlcheck1.py check rtl_ref.txt [appdbg64g] [config]
+"""
+
+import sys
+import time
+import subprocess
+import rpc
+
+APP = "..\\win32build\\Release\\appdbg64g.exe"
+CFG = "..\\..\\targets\\sysc_river_gui.json"
+
+# Stages of autotest1.py: boot, switch UART to soc, run dhrystone
+STAGES = [
+    (None, 30000),
+    ("uart0 'set_module soc'", 20000),
+    ("uart0 dhry", 20000),
+]
+
+def run(app, cfg):
+    proc = subprocess.Popen([app, "-c", cfg])
+    time.sleep(5)
+
+    p = rpc.Simulator()
+    p.connect()
+    p.halt()
+
+    result = []
+    for cmd, steps in STAGES:
+        if cmd is not None:
+            p.cmd(cmd)
+        if len(result) == 0:
+            steps -= p.simSteps()
+        p.step(steps)
+        # [clock counter, step counter, ...] from DSU
+        cpi = p.cmd("cpi")
+        result.append("{0}: clocks={1} steps={2}".format(
+                      cmd, cpi[0], cpi[1]))
+        result.append("{0}: regs={1}".format(cmd, p.cmd("regs")))
+
+    p.exit()
+    p.disconnect()
+    proc.wait()
+    return result
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ("save", "check"):
+        print(__doc__)
+        return 1
+    app = sys.argv[3] if len(sys.argv) > 3 else APP
+    cfg = sys.argv[4] if len(sys.argv) > 4 else CFG
+    result = run(app, cfg)
+
+    if sys.argv[1] == "save":
+        f = open(sys.argv[2], "w")
+        f.write("\n".join(result) + "\n")
+        f.close()
+        print("Reference saved: {0}".format(sys.argv[2]))
+        return 0
+
+    f = open(sys.argv[2], "r")
+    ref = f.read().splitlines()
+    f.close()
+    errors = 0
+    for i in range(max(len(ref), len(result))):
+        r = ref[i] if i < len(ref) else "<none>"
+        d = result[i] if i < len(result) else "<none>"
+        if r != d:
+            print("Mismatch:\n  reference: {0}\n  result:    {1}".format(r, d))
+            errors += 1
+    if errors:
+        print("FAILED: {0} mismatches".format(errors))
+        return 1
+    print("PASSED")
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
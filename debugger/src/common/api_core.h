@@ -29,6 +29,14 @@ namespace debugger {
 #define LOG_INFO      3
 #define LOG_DEBUG     4
 
+/**
+ * Messages with the higher level are removed at compile time. Can be
+ * redefined by the build option, see makefiles/util.mak.
+ */
+#ifndef RISCV_LOG_LEVEL_MAX
+#define RISCV_LOG_LEVEL_MAX LOG_DEBUG
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -226,26 +234,39 @@ int RISCV_printf(void *iface, int level, const char *fmt, ...);
 /** Format input data */
 int RISCV_sscanf(const char *s, const char *fmt, ...);
 
+/**
+ * Level is checked before the call using getLogLevel() of the current
+ * context: IService returns its LogLevel attribute value, otherwise
+ * the default function below is used and RISCV_printf checks the level.
+ */
+#define RISCV_printf_level(level, fmt, ...) \
+    do { \
+        if ((level) <= RISCV_LOG_LEVEL_MAX && (level) <= getLogLevel()) { \
+            RISCV_printf(getInterface(IFACE_SERVICE), level, fmt, \
+                         __VA_ARGS__); \
+        } \
+    } while (0)
+
 /** Output always */
 #define RISCV_printf0(fmt, ...) \
     RISCV_printf(getInterface(IFACE_SERVICE), 0, fmt, __VA_ARGS__)
 
 /** Output with the maximal logging level */
 #define RISCV_error(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_ERROR, "%s:%d " fmt, \
-                 __FILE__, __LINE__, __VA_ARGS__)
+    RISCV_printf_level(LOG_ERROR, "%s:%d " fmt, __FILE__, __LINE__, \
+                       __VA_ARGS__)
 
 /** Output with the information logging level */
 #define RISCV_important(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_IMPORTANT, fmt, __VA_ARGS__)
+    RISCV_printf_level(LOG_IMPORTANT, fmt, __VA_ARGS__)
 
 /** Output with the information logging level */
 #define RISCV_info(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_INFO, fmt, __VA_ARGS__)
+    RISCV_printf_level(LOG_INFO, fmt, __VA_ARGS__)
 
 /** Output with the lower logging level */
 #define RISCV_debug(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_DEBUG, fmt, __VA_ARGS__)
+    RISCV_printf_level(LOG_DEBUG, fmt, __VA_ARGS__)
 
 /** Suspend thread on certain number of milliseconds */
 void RISCV_sleep_ms(int ms);
@@ -281,6 +302,14 @@ void* RISCV_memshare_map(sharemem_def h, int sz);
 void RISCV_memshare_unmap(void *buf, int sz);
 void RISCV_memshare_delete(sharemem_def h);
 
+/**
+ * Private copy-on-write mapping of the file region. Pages are loaded on
+ * first access, modifications aren't written back into file.
+ * @param off  Offset should be aligned to 64 KB (allocation granularity).
+ */
+void *RISCV_file_map(const char *filename, uint64_t off, uint64_t sz);
+void RISCV_file_unmap(void *buf, uint64_t sz);
+
 /** Memory allocator/de-allocator */
 void *RISCV_malloc(uint64_t sz);
 void RISCV_free(void *p);
@@ -302,6 +331,9 @@ void RISCV_write_json_file(const char *filename, const char *s);
 }
 #endif
 
+/** Default logging level of the code outside of services */
+static inline int getLogLevel() { return RISCV_LOG_LEVEL_MAX; }
+
 }  // namespace debugger
 
 #endif  // __DEBUGGER_API_CORE_H__
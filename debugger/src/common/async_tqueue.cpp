@@ -73,65 +73,175 @@ void AsyncTQueueType::initProc() {
 
 /** Clock queue */
 ClockAsyncTQueueType::ClockAsyncTQueueType() {
-    size_ = 1;
+    size_ = 16;
     queue_ = new StepQueueItemType[size_];
-
+    inbox_ = 0;
     RISCV_mutex_init(&mutex_);
     hardReset();
 }
 
 ClockAsyncTQueueType::~ClockAsyncTQueueType() {
-    RISCV_mutex_destroy(&mutex_);
+    hardReset();
     delete [] queue_;
+    RISCV_mutex_destroy(&mutex_);
 }
 
 void ClockAsyncTQueueType::hardReset() {
+    InboxItemType *item = inboxTakeAll();
+    while (item) {
+        InboxItemType *next = item->next;
+        delete item;
+        item = next;
+    }
     item_total_ = 0;
-    precnt_ = 0;
-    item_cnt_ = 0;
+    seq_ = 0;
+}
+
+void ClockAsyncTQueueType::inboxPush(InboxItemType *item) {
+    InboxItemType *head;
+    do {
+        head = inbox_;
+        item->next = head;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    } while (InterlockedCompareExchangePointer(
+                reinterpret_cast<void *volatile *>(&inbox_),
+                item, head) != head);
+#else
+    } while (!__sync_bool_compare_and_swap(&inbox_, head, item));
+#endif
 }
 
+ClockAsyncTQueueType::InboxItemType *ClockAsyncTQueueType::inboxTakeAll() {
+    InboxItemType *head;
+    do {
+        head = inbox_;
+        if (head == 0) {
+            return 0;
+        }
+#if defined(_WIN32) || defined(__CYGWIN__)
+    } while (InterlockedCompareExchangePointer(
+                reinterpret_cast<void *volatile *>(&inbox_),
+                0, head) != head);
+#else
+    } while (!__sync_bool_compare_and_swap(&inbox_, head,
+                                           static_cast<InboxItemType *>(0)));
+#endif
+    // Restore registration order
+    InboxItemType *fifo = 0, *next;
+    while (head) {
+        next = head->next;
+        head->next = fifo;
+        fifo = head;
+        head = next;
+    }
+    return fifo;
+}
 
 void ClockAsyncTQueueType::put(uint64_t time, IFace *cb) {
+    InboxItemType *item = new InboxItemType;
+    item->time = time;
+    item->iface = cb;
+    item->action = Inbox_Put;
+    inboxPush(item);
+}
+
+bool ClockAsyncTQueueType::move(IFace *cb, uint64_t time) {
+    InboxItemType *item = new InboxItemType;
+    item->time = time;
+    item->iface = cb;
+    item->action = Inbox_Move;
+    inboxPush(item);
+    return true;
+}
+
+int ClockAsyncTQueueType::getItemsTotal() {
+    int total;
     RISCV_mutex_lock(&mutex_);
-    if (precnt_ >= 1024) {
-        RISCV_mutex_unlock(&mutex_);
-        RISCV_printf(0, 0, "clock pre-queue overflow: %d", precnt_);
-        return;
-    }
-    prequeue_[precnt_].left = 0;
-    prequeue_[precnt_].right = 0;
-    prequeue_[precnt_].time = time;
-    prequeue_[precnt_++].iface = cb;
+    processInbox();
+    total = item_total_;
     RISCV_mutex_unlock(&mutex_);
+    return total;
 }
 
-bool ClockAsyncTQueueType::move(IFace *cb, uint64_t time) {
+int ClockAsyncTQueueType::getItems(uint64_t *time, IFace **cb, int max) {
+    StepQueueItemType *tmp;
+    int total;
+    int cnt;
     RISCV_mutex_lock(&mutex_);
-    for (int i = 0; i < precnt_; i++) {
-        if (prequeue_[i].iface == cb) {
-            prequeue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
+    processInbox();
+    total = item_total_;
+    tmp = new StepQueueItemType[total + 1];
+    memcpy(tmp, queue_, total * sizeof(StepQueueItemType));
+    RISCV_mutex_unlock(&mutex_);
+    // Sort copy by (time, seq) with the insertion sort, queue is small
+    for (int i = 1; i < total; i++) {
+        StepQueueItemType t1 = tmp[i];
+        int j = i - 1;
+        while (j >= 0 && (tmp[j].time > t1.time
+            || (tmp[j].time == t1.time && tmp[j].seq > t1.seq))) {
+            tmp[j + 1] = tmp[j];
+            j--;
         }
+        tmp[j + 1] = t1;
     }
-    for (int i = 0; i < item_total_; i++) {
-        if (queue_[i].iface == cb) {
-            queue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
-        }
+    for (cnt = 0; cnt < total && cnt < max; cnt++) {
+        time[cnt] = tmp[cnt].time;
+        cb[cnt] = tmp[cnt].iface;
+    }
+    delete [] tmp;
+    return cnt;
+}
+
+void ClockAsyncTQueueType::setItems(uint64_t *time, IFace **cb, int cnt) {
+    InboxItemType *item = new InboxItemType;
+    item->time = 0;
+    item->iface = 0;
+    item->action = Inbox_Clear;
+    inboxPush(item);
+    for (int i = 0; i < cnt; i++) {
+        put(time[i], cb[i]);
     }
-    RISCV_mutex_unlock(&mutex_);
-    return false;
 }
 
 void ClockAsyncTQueueType::pushPreQueued() {
-    if (precnt_ == 0) {
+    if (inbox_ == 0) {
         return;
     }
     RISCV_mutex_lock(&mutex_);
-    while ((precnt_ + item_total_) > size_) {
+    processInbox();
+    RISCV_mutex_unlock(&mutex_);
+}
+
+void ClockAsyncTQueueType::processInbox() {
+    InboxItemType *item = inboxTakeAll();
+    InboxItemType *next;
+    while (item) {
+        next = item->next;
+        if (item->action == Inbox_Clear) {
+            item_total_ = 0;
+        } else if (item->action == Inbox_Move) {
+            int i = 0;
+            while (i < item_total_ && queue_[i].iface != item->iface) {
+                i++;
+            }
+            if (i < item_total_) {
+                queue_[i].time = item->time;
+                queue_[i].seq = seq_++;
+                siftUp(i);
+                siftDown(i);
+            } else {
+                insert(item->time, item->iface);
+            }
+        } else {
+            insert(item->time, item->iface);
+        }
+        delete item;
+        item = next;
+    }
+}
+
+void ClockAsyncTQueueType::insert(uint64_t time, IFace *iface) {
+    if (item_total_ == size_) {
         int t1 = 2*size_;
         StepQueueItemType *p1 = new StepQueueItemType[t1];
         memcpy(p1, queue_, item_total_*sizeof(StepQueueItemType));
@@ -139,32 +249,57 @@ void ClockAsyncTQueueType::pushPreQueued() {
         queue_ = p1;
         size_ = t1;
     }
-    memcpy(&queue_[item_total_], prequeue_, precnt_*sizeof(StepQueueItemType));
-    item_total_ += precnt_;
-    precnt_ = 0;
-    RISCV_mutex_unlock(&mutex_);
+    queue_[item_total_].time = time;
+    queue_[item_total_].seq = seq_++;
+    queue_[item_total_].iface = iface;
+    siftUp(item_total_++);
 }
 
+void ClockAsyncTQueueType::siftUp(int idx) {
+    StepQueueItemType t1;
+    int parent;
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!less(idx, parent)) {
+            break;
+        }
+        t1 = queue_[parent];
+        queue_[parent] = queue_[idx];
+        queue_[idx] = t1;
+        idx = parent;
+    }
+}
+
+void ClockAsyncTQueueType::siftDown(int idx) {
+    StepQueueItemType t1;
+    int child;
+    while ((child = 2*idx + 1) < item_total_) {
+        if (child + 1 < item_total_ && less(child + 1, child)) {
+            child++;
+        }
+        if (!less(child, idx)) {
+            break;
+        }
+        t1 = queue_[child];
+        queue_[child] = queue_[idx];
+        queue_[idx] = t1;
+        idx = child;
+    }
+}
 
 IFace *ClockAsyncTQueueType::getNext(uint64_t step_cnt) {
     IFace *ret = 0;
-    if (item_cnt_ >= item_total_) {
-        return ret;
+    if (item_total_ == 0 || step_cnt < queue_[0].time) {
+        return 0;
     }
-    for (; item_cnt_ < item_total_; item_cnt_++) {
-        if (step_cnt < queue_[item_cnt_].time) {
-            continue;
-        }
-        ret = queue_[item_cnt_].iface;
-
-        // remove item from list using swap function to avoid usage
-        // of allocation/deallocation calls.
-        if (item_cnt_ < (item_total_ - 1)) {
-            queue_[item_cnt_] = queue_[item_total_ - 1];
-        }
-        item_total_--;
-        break;
+    // Lock only when the event is fired, the check above is the fast path
+    RISCV_mutex_lock(&mutex_);
+    if (item_total_ != 0 && step_cnt >= queue_[0].time) {
+        ret = queue_[0].iface;
+        queue_[0] = queue_[--item_total_];
+        siftDown(0);
     }
+    RISCV_mutex_unlock(&mutex_);
     return ret;
 }
 
@@ -51,6 +51,12 @@ class AsyncTQueueType {
 };
 
 
+/**
+ * Clock events scheduler: binary min-heap ordered by the step counter (and
+ * by registration order for equal steps). The heap is accessed only from
+ * the clock owner thread, other threads register callbacks through the
+ * lock-free inbox, so the earliest time is available without locking.
+ */
 class ClockAsyncTQueueType {
  public:
     ClockAsyncTQueueType();
@@ -66,9 +72,12 @@ class ClockAsyncTQueueType {
     void pushPreQueued();
 
     /** Reset proccessed counter at the begining of each iteration */
-    void initProc() { item_cnt_ = 0; }
+    void initProc() {}
 
-    /** move previously regsiterd callbacks: true: moved; false: not found */
+    /**
+     * Thread safe move of the previously registered callback. Callback is
+     * registered if it wasn't found, so the method always returns true.
+     */
     bool move(IFace *cb, uint64_t time);
 
     /**
@@ -76,22 +85,67 @@ class ClockAsyncTQueueType {
      */
     IFace *getNext(uint64_t step_cnt);
 
+    /** Earliest registered time of the main queue */
+    uint64_t getNextTime() {
+        return item_total_ ? queue_[0].time : ~0ull;
+    }
+
+    /** New items were registered or moved since the last pushPreQueued() */
+    bool isModified() { return inbox_ != 0; }
+
+    /**
+     * Number of registered items including not yet pushed requests. It
+     * should be called when the clock owner is halted.
+     */
+    int getItemsTotal();
+
+    /**
+     * Copy of the main queue sorted in the execution order (snapshot). It
+     * should be called when the clock owner is halted. Returns the number
+     * of copied items that is never larger than 'max'.
+     */
+    int getItems(uint64_t *time, IFace **cb, int max);
+
+    /** Thread safe replacement of the whole queue content (restore) */
+    void setItems(uint64_t *time, IFace **cb, int cnt);
+
  private:
     struct StepQueueItemType {
-        StepQueueItemType *left;
-        StepQueueItemType *right;
+        uint64_t time;
+        uint64_t seq;           // registration order of the equal times
+        IFace *iface;
+    };
+    enum EInboxAction {
+        Inbox_Put,
+        Inbox_Move,
+        Inbox_Clear
+    };
+    struct InboxItemType {
+        InboxItemType *next;
         uint64_t time;
         IFace *iface;
+        EInboxAction action;
     };
+
+    void inboxPush(InboxItemType *item);
+    InboxItemType *inboxTakeAll();
+    void processInbox();
+    void insert(uint64_t time, IFace *iface);
+    void siftUp(int idx);
+    void siftDown(int idx);
+    bool less(int a, int b) {
+        return queue_[a].time < queue_[b].time
+            || (queue_[a].time == queue_[b].time
+                && queue_[a].seq < queue_[b].seq);
+    }
+
     StepQueueItemType *queue_;
     int size_;
     int item_total_;
-    int item_cnt_;
+    uint64_t seq_;
 
-    int precnt_;
-    StepQueueItemType prequeue_[1024];
-
-    mutex_def mutex_;
+    InboxItemType *volatile inbox_;     // LIFO list of the new requests
+    mutex_def mutex_;                   // heap modification vs snapshot
 };
 
 
@@ -23,9 +23,75 @@
 
 namespace debugger {
 
-static const int64_t MIN_ALLOC_BYTES = 1 << 12;
+static const unsigned ALLOC_ITEMS_MIN = 4;
+static const unsigned DICT_HASH_MIN = 16;       // capacity with hash index
 static AttributeType NilAttribute;
 
+/**
+ * Hash index follows the pairs in the same allocation:
+ *      [pairs x capacity][indexed][slots x 2*capacity]
+ * Pairs [0, indexed) are in the table, the rest are checked one by one.
+ * Slot holds the pair index + 1, zero is the empty slot.
+ */
+struct AttributeDictIndexType {
+    unsigned indexed;
+    unsigned slot[1];
+};
+
+/** Capacity is derived from the size so that it isn't stored */
+static unsigned attr_capacity(unsigned size) {
+    if (size == 0) {
+        return 0;
+    }
+    unsigned cap = ALLOC_ITEMS_MIN;
+    while (cap < size) {
+        cap <<= 1;
+    }
+    return cap;
+}
+
+static size_t attr_dict_bytes(unsigned cap) {
+    size_t ret = cap * sizeof(AttributePairType);
+    if (cap >= DICT_HASH_MIN) {
+        ret += (1 + 2 * cap) * sizeof(unsigned);
+    }
+    return ret;
+}
+
+static AttributeDictIndexType *attr_dict_index(AttributePairType *dict,
+                                               unsigned size) {
+    unsigned cap = attr_capacity(size);
+    if (cap < DICT_HASH_MIN) {
+        return 0;
+    }
+    return reinterpret_cast<AttributeDictIndexType *>(&dict[cap]);
+}
+
+/** FNV-1a */
+static unsigned attr_hash(const char *key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h = (h ^ static_cast<uint8_t>(*key++)) * 16777619u;
+    }
+    return h;
+}
+
+/** The first pair with the same key stays in the table */
+static void attr_dict_insert(AttributePairType *dict, unsigned size,
+                             unsigned n) {
+    AttributeDictIndexType *idx = attr_dict_index(dict, size);
+    unsigned mask = 2 * attr_capacity(size) - 1;
+    const char *key = dict[n].key_.to_string();
+    unsigned h = attr_hash(key) & mask;
+    while (idx->slot[h]) {
+        if (strcmp(key, dict[idx->slot[h] - 1].key_.to_string()) == 0) {
+            return;
+        }
+        h = (h + 1) & mask;
+    }
+    idx->slot[h] = n + 1;
+}
+
 void attribute_to_string(const AttributeType *attr, AutoBuffer *buf);
 int string_to_attribute(const char *cfg, int &off, AttributeType *out);
 
@@ -56,8 +122,10 @@ void AttributeType::freeAttrDescription() {
 void AttributeType::attr_free() {
     if (size()) {
         if (is_string()) {
-            RISCV_free(u_.string);
-        } else if (is_data() && size() > 8) {
+            if (size() >= ATTR_INLINE_BYTES) {
+                RISCV_free(u_.string);
+            }
+        } else if (is_data() && size() > ATTR_INLINE_BYTES) {
             RISCV_free(u_.data);
         } else if (is_list()) {
             for (unsigned i = 0; i < size(); i++) {
@@ -96,6 +164,7 @@ void AttributeType::clone(const AttributeType *v) {
             u_.dict[i].key_.make_string(v->dict_key(i)->to_string());
             u_.dict[i].value_.clone(v->dict_value(i));
         }
+        dict_rehash();
     } else {
         this->kind_ = v->kind_;
         this->u_ = v->u_;
@@ -142,28 +211,20 @@ AttributeType &AttributeType::operator[](unsigned idx) {
 }
 
 const AttributeType &AttributeType::operator[](const char *key) const {
-    for (unsigned i = 0; i < size(); i++) {
-        if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
-            return u_.dict[i].value_;
-        }
+    int idx = dict_find(key);
+    if (idx >= 0) {
+        return u_.dict[idx].value_;
     }
     AttributeType *pthis = const_cast<AttributeType*>(this);
-    pthis->realloc_dict(size()+1);
-    pthis->u_.dict[size()-1].key_.make_string(key);
-    pthis->u_.dict[size()-1].value_.make_nil();
-    return u_.dict[size()-1].value_;
+    return pthis->dict_append(key);
 }
 
 AttributeType &AttributeType::operator[](const char *key) {
-    for (unsigned i = 0; i < size(); i++) {
-        if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
-            return u_.dict[i].value_;
-        }
+    int idx = dict_find(key);
+    if (idx >= 0) {
+        return u_.dict[idx].value_;
     }
-    realloc_dict(size()+1);
-    u_.dict[size()-1].key_.make_string(key);
-    u_.dict[size()-1].value_.make_nil();
-    return u_.dict[size()-1].value_;
+    return dict_append(key);
 }
 
 const uint8_t &AttributeType::operator()(unsigned idx) const {
@@ -171,7 +232,7 @@ const uint8_t &AttributeType::operator()(unsigned idx) const {
         RISCV_printf(NULL, LOG_ERROR, "Data index '%d' out of range.", idx);
         return u_.data[0];
     }
-    if (size_ > 8) {
+    if (size_ > ATTR_INLINE_BYTES) {
         return u_.data[idx];
     }
     return u_.data_bytes[idx];
@@ -182,8 +243,12 @@ void AttributeType::make_string(const char *value) {
     if (value) {
         kind_ = Attr_String;
         size_ = (unsigned)strlen(value);
-        u_.string = static_cast<char *>(RISCV_malloc(size_ + 1));
-        memcpy(u_.string, value, size_ + 1);
+        if (size_ < ATTR_INLINE_BYTES) {
+            memcpy(u_.string_bytes, value, size_ + 1);
+        } else {
+            u_.string = static_cast<char *>(RISCV_malloc(size_ + 1));
+            memcpy(u_.string, value, size_ + 1);
+        }
     } else {
         kind_ = Attr_Nil;
     }
@@ -193,7 +258,7 @@ void AttributeType::make_data(unsigned size) {
     attr_free();
     kind_ = Attr_Data;
     size_ = size;
-    if (size > 8) {
+    if (size > ATTR_INLINE_BYTES) {
         u_.data = static_cast<uint8_t *>(RISCV_malloc(size_));
     }
 }
@@ -202,7 +267,7 @@ void AttributeType::make_data(unsigned size, const void *data) {
     attr_free();
     kind_ = Attr_Data;
     size_ = size;
-    if (size > 8) {
+    if (size > ATTR_INLINE_BYTES) {
         u_.data = static_cast<uint8_t *>(RISCV_malloc(size_));
         memcpy(u_.data, data, size);
     } else {
@@ -214,10 +279,10 @@ void AttributeType::realloc_data(unsigned size) {
     if (!is_data()) {
         return;
     }
-    if (size <= 8) {    
-        if (size_ > 8) {
+    if (size <= ATTR_INLINE_BYTES) {
+        if (size_ > ATTR_INLINE_BYTES) {
             uint8_t *pold = u_.data;
-            memcpy(u_.data_bytes, u_.data, size);
+            memcpy(u_.data_bytes, pold, size);
             RISCV_free(pold);
         }
         size_ = size;
@@ -228,16 +293,15 @@ void AttributeType::realloc_data(unsigned size) {
     if (size_ < sz) {
         sz = size_;
     }
-    if (sz > 8) {
-        memcpy(pnew, u_.data, sz);
+    memcpy(pnew, data(), sz);
+    if (size_ > ATTR_INLINE_BYTES) {
         RISCV_free(u_.data);
-    } else {
-        memcpy(pnew, u_.data_bytes, sz);
     }
     u_.data = pnew;
     size_ = size;
 }
 
+/** Inline string with '\0' fits into inline data */
 void AttributeType::string_to_data() {
     size_++;    // null symbol
     kind_ = Attr_Data;
@@ -252,16 +316,13 @@ void AttributeType::make_list(unsigned size) {
 }
 
 void AttributeType::realloc_list(unsigned size) {
-    size_t req_sz = (size * sizeof(AttributeType) + MIN_ALLOC_BYTES - 1)
-                   / MIN_ALLOC_BYTES;
-    size_t cur_sz = (size_ * sizeof(AttributeType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    if (req_sz > cur_sz) {
+    unsigned cap = attr_capacity(size);
+    if (cap > attr_capacity(size_)) {
         AttributeType * t1 = static_cast<AttributeType *>(
-                RISCV_malloc(MIN_ALLOC_BYTES * req_sz));
+                RISCV_malloc(cap * sizeof(AttributeType)));
         memcpy(static_cast<void*>(t1), u_.list, size_ * sizeof(AttributeType));
         memset(static_cast<void*>(&t1[size_]), 0,
-                (MIN_ALLOC_BYTES * req_sz) - size_ * sizeof(AttributeType));
+                (cap - size_) * sizeof(AttributeType));
         if (size_) {
             RISCV_free(u_.list);
         }
@@ -275,24 +336,17 @@ void AttributeType::insert_to_list(unsigned idx, const AttributeType *item) {
         RISCV_printf(NULL, LOG_ERROR, "%s", "Insert index out of bound");
         return;
     }
-    size_t new_sz = ((size_ + 1) * sizeof(AttributeType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    AttributeType * t1 = static_cast<AttributeType *>(
-                RISCV_malloc(MIN_ALLOC_BYTES * new_sz));
-    memset(static_cast<void*>(t1 + idx), 0,
-           sizeof(AttributeType));  // Fix bug request #4
-
-    memcpy(static_cast<void*>(t1), u_.list, idx * sizeof(AttributeType));
-    t1[idx].clone(item);
-    memcpy(static_cast<void*>(&t1[idx + 1]), &u_.list[idx],
-           (size_ - idx) * sizeof(AttributeType));
-    memset(static_cast<void*>(&t1[size_ + 1]), 0,
-           (MIN_ALLOC_BYTES * new_sz) - (size_ + 1) * sizeof(AttributeType));
-    if (size_) {
-        RISCV_free(u_.list);
+    AttributeType t1;
+    if (size_ && item >= u_.list && item < &u_.list[size_]) {
+        t1 = *item;         // item is moved by the insertion
+        item = &t1;
     }
-    u_.list = t1;
-    size_++;
+    realloc_list(size_ + 1);
+    memmove(static_cast<void*>(&u_.list[idx + 1]), &u_.list[idx],
+           (size_ - 1 - idx) * sizeof(AttributeType));
+    memset(static_cast<void*>(&u_.list[idx]), 0,
+           sizeof(AttributeType));  // Fix bug request #4
+    u_.list[idx].clone(item);
 }
 
 void AttributeType::remove_from_list(unsigned idx) {
@@ -323,13 +377,16 @@ void AttributeType::swap_list_item(unsigned n, unsigned m) {
     }
     unsigned tsize = u_.list[n].size_;
     KindType tkind = u_.list[n].kind_;
-    int64_t tinteger = u_.list[n].u_.integer;
-    u_.list[n].size_ = u_.list[m].size_;
-    u_.list[n].kind_ = u_.list[m].kind_;
-    u_.list[n].u_.integer = u_.list[m].u_.integer;
-    u_.list[m].size_ = tsize;
-    u_.list[m].kind_ = tkind;
-    u_.list[m].u_.integer = tinteger;
+    AttributeType *pn = &u_.list[n];
+    AttributeType *pm = &u_.list[m];
+    uint8_t tu[sizeof(pn->u_)];
+    memcpy(tu, &pn->u_, sizeof(tu));
+    pn->size_ = pm->size_;
+    pn->kind_ = pm->kind_;
+    memcpy(&pn->u_, &pm->u_, sizeof(tu));
+    pm->size_ = tsize;
+    pm->kind_ = tkind;
+    memcpy(&pm->u_, tu, sizeof(tu));
 }
 
 
@@ -425,13 +482,8 @@ void AttributeType::sort(int idx) {
 }
 
 bool AttributeType::has_key(const char *key) const {
-    for (unsigned i = 0; i < size(); i++) {
-        AttributePairType &pair = u_.dict[i];
-        if (pair.key_.is_equal(key) && !pair.value_.is_nil()) {
-            return true;
-        }
-    }
-    return false;
+    int idx = dict_find(key);
+    return idx >= 0 && !u_.dict[idx].value_.is_nil();
 }
 
 const AttributeType *AttributeType::dict_key(unsigned idx) const {
@@ -455,24 +507,92 @@ void AttributeType::make_dict() {
     u_.dict = NULL;
 }
 
+/**
+ * New pairs have no keys, the hash index includes them after dict_rehash()
+ * or dict_append().
+ */
 void AttributeType::realloc_dict(unsigned size) {
-    size_t req_sz = (size * sizeof(AttributePairType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    size_t cur_sz = (size_ * sizeof(AttributePairType) + MIN_ALLOC_BYTES - 1)
-                  / MIN_ALLOC_BYTES;
-    if (req_sz > cur_sz) {
-        AttributePairType * t1 = static_cast<AttributePairType *>(
-                RISCV_malloc(MIN_ALLOC_BYTES * req_sz));
-        memcpy(static_cast<void*>(t1), u_.dict,
-               size_ * sizeof(AttributePairType));
-        memset(static_cast<void*>(&t1[size_]), 0,
-                (MIN_ALLOC_BYTES * req_sz) - size_ * sizeof(AttributePairType));
+    unsigned cap = attr_capacity(size);
+    for (unsigned i = size; i < size_; i++) {
+        u_.dict[i].key_.attr_free();
+        u_.dict[i].value_.attr_free();
+    }
+    // Index position depends on capacity so shrink reallocates too
+    if (cap != attr_capacity(size_)) {
+        AttributePairType *t1 = 0;
+        unsigned n = size < size_ ? size : size_;
+        if (cap) {
+            size_t bytes = attr_dict_bytes(cap);
+            t1 = static_cast<AttributePairType *>(RISCV_malloc(bytes));
+            memcpy(static_cast<void*>(t1), u_.dict,
+                   n * sizeof(AttributePairType));
+            memset(static_cast<void*>(&t1[n]), 0,
+                   bytes - n * sizeof(AttributePairType));
+        }
         if (size_) {
             RISCV_free(u_.dict);
         }
         u_.dict = t1;
     }
     size_ = size;
+    dict_rehash();
+}
+
+int AttributeType::dict_find(const char *key) const {
+    unsigned start = 0;
+    AttributeDictIndexType *idx = attr_dict_index(u_.dict, size_);
+    if (idx) {
+        unsigned mask = 2 * attr_capacity(size_) - 1;
+        unsigned h = attr_hash(key) & mask;
+        while (idx->slot[h]) {
+            unsigned n = idx->slot[h] - 1;
+            if (strcmp(key, u_.dict[n].key_.to_string()) == 0) {
+                return static_cast<int>(n);
+            }
+            h = (h + 1) & mask;
+        }
+        start = idx->indexed;
+    }
+    for (unsigned i = start; i < size_; i++) {
+        if (strcmp(key, u_.dict[i].key_.to_string()) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+AttributeType &AttributeType::dict_append(const char *key) {
+    unsigned n = size_;
+    if (attr_capacity(n + 1) != attr_capacity(n)) {
+        realloc_dict(n + 1);
+    } else {
+        size_ = n + 1;
+    }
+    u_.dict[n].key_.make_string(key);
+    u_.dict[n].value_.make_nil();
+
+    AttributeDictIndexType *idx = attr_dict_index(u_.dict, size_);
+    if (idx && idx->indexed == n) {
+        attr_dict_insert(u_.dict, size_, n);
+        idx->indexed = n + 1;
+    }
+    return u_.dict[n].value_;
+}
+
+void AttributeType::dict_rehash() {
+    AttributeDictIndexType *idx = attr_dict_index(u_.dict, size_);
+    if (!idx) {
+        return;
+    }
+    memset(idx->slot, 0, 2 * attr_capacity(size_) * sizeof(unsigned));
+    idx->indexed = 0;
+    for (unsigned i = 0; i < size_; i++) {
+        if (!u_.dict[i].key_.is_string()) {
+            break;
+        }
+        attr_dict_insert(u_.dict, size_, i);
+        idx->indexed = i + 1;
+    }
 }
 
 const AttributeType& AttributeType::to_config() {
@@ -40,6 +40,13 @@ enum KindType {
 
 class AttributePairType;
 
+/**
+ * Short strings and data are stored inside of the attribute without
+ * allocation. Lists and dictionaries grow geometrically, large
+ * dictionaries have the hash index of keys.
+ */
+static const unsigned ATTR_INLINE_BYTES = 16;
+
 class AttributeType : public IAttribute {
  public:
     KindType kind_;
@@ -52,7 +59,8 @@ class AttributeType : public IAttribute {
         AttributeType *list;
         AttributePairType *dict;
         uint8_t *data;
-        uint8_t data_bytes[8];  // Data without allocation
+        uint8_t data_bytes[ATTR_INLINE_BYTES];      // Data without allocation
+        char string_bytes[ATTR_INLINE_BYTES];       // String with '\0'
         void *py_object;
         IFace *iface;
         char *uobject;
@@ -81,6 +89,8 @@ class AttributeType : public IAttribute {
     void attr_free();
 
     explicit AttributeType(const char *str) {
+        kind_ = Attr_Invalid;
+        size_ = 0;
         make_string(str);
     }
 
@@ -158,6 +168,9 @@ class AttributeType : public IAttribute {
     }
 
     const char * to_string() const {
+        if (kind_ == Attr_String && size_ < ATTR_INLINE_BYTES) {
+            return u_.string_bytes;
+        }
         return u_.string;
     }
 
@@ -168,14 +181,14 @@ class AttributeType : public IAttribute {
         if (kind_ != Attr_String) {
             return 0;
         }
-        char *p = u_.string;
+        char *p = const_cast<char *>(to_string());
         while (*p) {
             if (p[0] >= 'a' && p[0] <= 'z') {
                 p[0] = p[0] - 'a' + 'A';
             }
             p++;
         }
-        return u_.string;
+        return to_string();
     }
 
     bool is_list() const {
@@ -283,7 +296,7 @@ class AttributeType : public IAttribute {
 
     int64_t integer() const { return u_.integer; }
 
-    const char *string() const { return u_.string; }
+    const char *string() const { return to_string(); }
 
     bool boolean() const { return u_.boolean; }
 
@@ -306,13 +319,13 @@ class AttributeType : public IAttribute {
     AttributeType *dict_value(unsigned idx);
 
     const uint8_t *data() const {
-        if (size_ > 8) {
+        if (size_ > ATTR_INLINE_BYTES) {
             return u_.data;
         }
         return u_.data_bytes;
     }
     uint8_t *data() {
-        if (size_ > 8) {
+        if (size_ > ATTR_INLINE_BYTES) {
             return u_.data;
         }
         return u_.data_bytes;
@@ -341,6 +354,11 @@ class AttributeType : public IAttribute {
 
     const AttributeType& to_config();
     void from_config(const char *str);
+
+ private:
+    int dict_find(const char *key) const;
+    AttributeType &dict_append(const char *key);
+    void dict_rehash();
 };
 
 class AttributePairType {
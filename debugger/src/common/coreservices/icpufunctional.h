@@ -21,6 +21,7 @@
 #include <iface.h>
 #include <api_types.h>
 #include "coreservices/imemop.h"
+#include "coreservices/iinstrtrace.h"
 
 namespace debugger {
 
@@ -79,6 +80,15 @@ class ICpuFunctional : public IFace {
     virtual void skipBreakpoint() = 0;
     virtual void flush(uint64_t addr) = 0;
     virtual void doNotCache(uint64_t addr) = 0;
+    /** Execution is driven by the external multi-hart scheduler */
+    virtual void attachScheduler() = 0;
+    /** Execute instructions until step counter reaches the quantum end */
+    virtual void executeUntil(uint64_t t) = 0;
+    /** Report retired instructions to the listener, 0 to disable */
+    virtual void setInstrTrace(IInstrTrace *itrace) = 0;
+    /** Convert binary trace file into the CPU text trace, return records
+        count or -1 on error */
+    virtual int64_t renderTrace(const char *binfile, const char *txtfile) = 0;
 
   protected:
     virtual uint64_t getResetAddress() = 0;
@@ -34,6 +34,13 @@ public:
 
     virtual uint64_t readCSR(int idx) = 0;
     void virtual writeCSR(int idx, uint64_t val) = 0;
+    /**
+     * MPU region written through CSR_mpu_ctrl. MPU CSRs are write-only,
+     * so the region table cannot be restored by reading CSR values.
+     * @return false if region wasn't programmed since reset.
+     */
+    virtual bool getMpuRegion(int idx, uint64_t *addr, uint64_t *mask,
+                              uint64_t *ctrl) = 0;
 };
 
 }  // namespace debugger
@@ -29,6 +29,16 @@ class IDpi : public IFace {
 
     virtual void axi4_write(uint64_t addr, int bytes, uint64_t data) = 0;
     virtual void axi4_read(uint64_t addr, int bytes, uint64_t *data) = 0;
+
+    /**
+     * Posted transactions don't wait the RTL response. Read data is
+     * compared with the expected value of the functional model when the
+     * response arrives and mismatch is reported with the step counter
+     * of the request.
+     */
+    virtual void axi4_post_write(uint64_t addr, int bytes, uint64_t data) = 0;
+    virtual void axi4_post_read(uint64_t addr, int bytes,
+                                uint64_t expected) = 0;
     virtual bool is_irq() = 0;
     virtual int get_irq() = 0;
 };
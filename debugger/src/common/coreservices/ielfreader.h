@@ -25,6 +25,21 @@ namespace debugger {
 
 static const char *const IFACE_ELFREADER = "IElfReader";
 
+/** Row of the DWARF line table */
+struct SourceLineType {
+    uint64_t addr;
+    uint32_t file;      // index in the source files list
+    uint32_t line;
+};
+
+/** PT_LOAD program header */
+struct LoadSegmentType {
+    uint64_t addr;      // physical (load) address
+    uint64_t filesz;
+    uint64_t memsz;     // tail after filesz is zero-filled
+    uint8_t *data;      // points into the mapped file
+};
+
 class IElfReader : public IFace {
  public:
     IElfReader() : IFace(IFACE_ELFREADER) {}
@@ -39,7 +54,25 @@ class IElfReader : public IFace {
 
     virtual uint64_t sectionSize(unsigned idx) = 0;
 
+    /** Points into the mapped file, NULL for sections without file image */
     virtual uint8_t *sectionData(unsigned idx) = 0;
+
+    /** Valid until the next readFile() call */
+    virtual unsigned loadableSegmentTotal() = 0;
+
+    virtual const LoadSegmentType *loadableSegment(unsigned idx) = 0;
+
+    /** Line table of the executable sections sorted by address */
+    virtual unsigned sourceLineTotal() = 0;
+
+    virtual const SourceLineType *sourceLine(unsigned idx) = 0;
+
+    virtual unsigned sourceFileTotal() = 0;
+
+    virtual const char *sourceFileName(unsigned idx) = 0;
+
+    /** Line number units of unsupported format missing in the table */
+    virtual unsigned sourceLineUnitsSkipped() = 0;
 };
 
 }  // namespace debugger
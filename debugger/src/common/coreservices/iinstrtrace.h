@@ -0,0 +1,64 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_IINSTRTRACE_H__
+#define __DEBUGGER_COMMON_CORESERVICES_IINSTRTRACE_H__
+
+#include <inttypes.h>
+#include <iface.h>
+#include <api_types.h>
+
+namespace debugger {
+
+static const char *const IFACE_INSTR_TRACE = "IInstrTrace";
+
+struct TraceActionType {
+    bool memop;             // 0=register; 1=memop
+    int waddr;              // register addr
+    uint64_t wdata;         // register data
+    int memop_write;        // 0=read
+    uint64_t memop_addr;
+    Reg64Type memop_data;
+    int memop_size;
+};
+
+static const int TRACE_ACTIONS_MAX = 64;
+
+struct TraceRecordType {
+    uint64_t step_cnt;
+    uint64_t pc;
+    uint32_t instr;
+    char disasm[256];
+    // 1 instruction several actions
+    TraceActionType action[TRACE_ACTIONS_MAX];
+    int action_cnt;
+};
+
+/**
+ * Listener of the retired instructions. CPU model calls it instead of
+ * (or in addition to) the trace file output, record is valid only
+ * during the call.
+ */
+class IInstrTrace : public IFace {
+ public:
+    IInstrTrace() : IFace(IFACE_INSTR_TRACE) {}
+
+    virtual void instrRetired(TraceRecordType *rec) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_IINSTRTRACE_H__
@@ -0,0 +1,41 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_IIRQCTRL_H__
+#define __DEBUGGER_COMMON_CORESERVICES_IIRQCTRL_H__
+
+#include <inttypes.h>
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_IRQ_CONTROLLER = "IIrqController";
+
+/**
+ * Interrupt controller that clears the pending state of the line when
+ * CPU takes the exception (Cortex-M NVIC).
+ */
+class IIrqController : public IFace {
+ public:
+    IIrqController() : IFace(IFACE_IRQ_CONTROLLER) {}
+
+    /** @param idx CPU signal index as used in ICpuGeneric::raiseSignal */
+    virtual void acknowledgeInterrupt(int idx) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_IIRQCTRL_H__
@@ -62,6 +62,17 @@ typedef struct Axi4TransactionType {
     int source_idx;             // Need for bus utilization statistic
 } Axi4TransactionType;
 
+/**
+ * Host memory of the device that can be accessed directly without
+ * transactions (see IMemoryOperation::getHostRegion).
+ */
+typedef struct HostMemoryRegionType {
+    uint64_t addr;              // bus address of the first byte
+    uint64_t size;              // [Bytes]
+    uint8_t *ptr;               // host memory of the first byte
+    bool writable;
+} HostMemoryRegionType;
+
 /**
  * Non-blocking memory access response interface (Initiator/Master)
  */
@@ -124,6 +135,23 @@ class IMemoryOperation : public IFace {
         return ret;
     }
 
+    /**
+     * Host memory region containing the address
+     *
+     * Can be implemented by plain memory without any side effects on access
+     * so that the CPU models may bypass b_transport.
+     */
+    virtual bool getHostRegion(uint64_t addr, HostMemoryRegionType *r) {
+        return false;
+    }
+
+    /**
+     * Accesses of the master done through the host region, so that the bus
+     * utilization statistic includes them.
+     */
+    virtual void reportHostAccess(int mst_id, uint64_t rdcnt,
+                                  uint64_t wrcnt) {}
+
     virtual uint64_t getBaseAddress() { return baseAddress_.to_uint64(); }
     virtual void setBaseAddress(uint64_t addr) {
         baseAddress_.make_uint64(addr);
@@ -0,0 +1,80 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_ISNAPSHOT_H__
+#define __DEBUGGER_COMMON_CORESERVICES_ISNAPSHOT_H__
+
+#include <inttypes.h>
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_SNAPSHOT = "ISnapshot";
+
+/**
+ * Snapshot file:
+ *      header:   SnapshotHeaderType
+ *      sections: SnapshotSectionType[section_total]
+ *      data:     state of each service aligned to SNAPSHOT_ALIGN so that
+ *                it can be mapped directly into memory on restore
+ */
+static const char SNAPSHOT_MAGIC[8] = {'R', 'V', 'S', 'N', 'A', 'P', 0, 0};
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const uint64_t SNAPSHOT_ALIGN = 1 << 16;
+static const uint32_t SNAPSHOT_SECTIONS_MAX = 4096;
+
+struct SnapshotHeaderType {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_total;
+};
+
+struct SnapshotSectionType {
+    char name[64];          // service name
+    uint64_t offset;        // offset in file
+    uint64_t size;
+};
+
+enum ESnapshotStatus {
+    SNAPSHOT_COPIED,        // data was copied, mapping can be released
+    SNAPSHOT_MAPPED,        // service owns the mapping
+    SNAPSHOT_ERROR
+};
+
+class ISnapshot : public IFace {
+ public:
+    ISnapshot() : IFace(IFACE_SNAPSHOT) {}
+
+    /** Size of the saved state in bytes */
+    virtual uint64_t getSnapshotSize() = 0;
+
+    /** Check size of the stored state before restoring any service */
+    virtual bool checkSnapshotSize(uint64_t sz) = 0;
+
+    /** Store state into buffer of getSnapshotSize() bytes */
+    virtual void saveSnapshot(uint8_t *buf) = 0;
+
+    /**
+     * Restore state from the private copy-on-write mapping of the file.
+     * Service may keep the mapping instead of copying data and release it
+     * with RISCV_file_unmap().
+     */
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_ISNAPSHOT_H__
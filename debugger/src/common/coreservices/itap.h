@@ -36,6 +36,19 @@ static const char *const ITap_detail =
 
 static const int TAP_ERROR = -1;
 
+enum ETapAction {
+    TapAction_Read,
+    TapAction_Write
+};
+
+/** Single operation of the batched request */
+struct TapOperationType {
+    uint64_t addr;
+    int bytes;
+    ETapAction action;
+    uint8_t *buf;
+};
+
 class ITap : public IFace {
  public:
     ITap() : IFace(IFACE_TAP) {}
@@ -46,6 +59,27 @@ class ITap : public IFace {
 
     virtual int read(uint64_t addr, int bytes, uint8_t *obuf) = 0;
     virtual int write(uint64_t addr, int bytes, uint8_t *ibuf) = 0;
+
+    /**
+     * Scatter/gather request executed in the specified order
+     *
+     * Transport should pack operations into as few link transactions as it
+     * can. Default implementation executes them one by one.
+     */
+    virtual int batch(TapOperationType *ops, int cnt) {
+        int ret;
+        for (int i = 0; i < cnt; i++) {
+            if (ops[i].action == TapAction_Read) {
+                ret = read(ops[i].addr, ops[i].bytes, ops[i].buf);
+            } else {
+                ret = write(ops[i].addr, ops[i].bytes, ops[i].buf);
+            }
+            if (ret == TAP_ERROR) {
+                return TAP_ERROR;
+            }
+        }
+        return cnt;
+    }
 };
 
 }  // namespace debugger
@@ -25,6 +25,7 @@ DSU::DSU(const char *name) :
     DsuRegisters(static_cast<IService *>(this)) {
     registerInterface(static_cast<IMemoryOperation *>(this));
     registerInterface(static_cast<IDsuGeneric *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("CPU", &cpu_);
     icpulist_.make_list(0);
 }
@@ -37,11 +38,20 @@ void DSU::postinitService() {
 
     ICpuGeneric *icpu;
     for (unsigned i = 0; i < cpu_.size(); i++) {
-        icpu = static_cast<ICpuGeneric *>(
-            RISCV_get_service_iface(cpu_[i].to_string(), IFACE_CPU_GENERIC));
+        AttributeType &cpu = cpu_[i];
+        if (cpu.is_list() && cpu.size() == 2) {
+            // Hart of the multi-core service: ['service', 'port']
+            icpu = static_cast<ICpuGeneric *>(
+                RISCV_get_service_port_iface(cpu[0u].to_string(),
+                                             cpu[1].to_string(),
+                                             IFACE_CPU_GENERIC));
+        } else {
+            icpu = static_cast<ICpuGeneric *>(
+                RISCV_get_service_iface(cpu.to_string(),
+                                        IFACE_CPU_GENERIC));
+        }
         if (!icpu) {
-            RISCV_error("Can't find ICpuGeneric interface %s",
-            cpu_[i].to_string());
+            RISCV_error("Can't find ICpuGeneric interface of CPU[%d]", i);
         } else {
             AttributeType item;
             item.make_iface(icpu);
@@ -64,6 +74,10 @@ void DSU::incrementWrAccess(int mst_id) {
 void DSU::softReset(bool val) {
     IResetListener *irst;
     for (unsigned i = 0; i < cpu_.size(); i++) {
+        if (!cpu_[i].is_string()) {
+            // Harts are reset together with their service
+            continue;
+        }
         irst = static_cast<IResetListener *>(
             RISCV_get_service_iface(cpu_[i].to_string(),
                                     IFACE_RESET_LISTENER));
@@ -88,5 +102,29 @@ void DSU::setCpuContext(unsigned n) {
     cpu_context_.setValue(n);
 }
 
+/** Soft reset, CPU context and bus utilization counters */
+uint64_t DSU::getSnapshotSize() {
+    return 2 * sizeof(uint64_t) + bus_util_.getLength();
+}
+
+void DSU::saveSnapshot(uint8_t *buf) {
+    uint64_t *p = reinterpret_cast<uint64_t *>(buf);
+    p[0] = soft_reset_.getValue().val;
+    p[1] = cpu_context_.getValue().val;
+    memcpy(&p[2], bus_util_.getp(), bus_util_.getLength());
+}
+
+ESnapshotStatus DSU::restoreSnapshot(uint8_t *buf, uint64_t sz) {
+    uint64_t *p = reinterpret_cast<uint64_t *>(buf);
+    if (sz != getSnapshotSize()) {
+        RISCV_error("Wrong snapshot size %" RV_PRI64 "d", sz);
+        return SNAPSHOT_ERROR;
+    }
+    soft_reset_.setValue(p[0]);
+    setCpuContext(static_cast<unsigned>(p[1]));
+    memcpy(bus_util_.getp(), &p[2], bus_util_.getLength());
+    return SNAPSHOT_COPIED;
+}
+
 }  // namespace debugger
 
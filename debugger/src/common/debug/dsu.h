@@ -29,13 +29,15 @@
 #include "coreservices/icpugen.h"
 #include "coreservices/idsugen.h"
 #include "coreservices/iwire.h"
+#include "coreservices/isnapshot.h"
 #include "dsu_regs.h"
 
 namespace debugger {
 
 class DSU : public RegMemBankGeneric,
             public DsuRegisters,
-            public IDsuGeneric {
+            public IDsuGeneric,
+            public ISnapshot {
  public:
     explicit DSU(const char *name);
     virtual ~DSU();
@@ -49,6 +51,14 @@ class DSU : public RegMemBankGeneric,
     void softReset(bool val);
     void setCpuContext(unsigned n);
 
+    /** ISnapshot */
+    virtual uint64_t getSnapshotSize();
+    virtual bool checkSnapshotSize(uint64_t sz) {
+        return sz == getSnapshotSize();
+    }
+    virtual void saveSnapshot(uint8_t *buf);
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz);
+
  private:
     AttributeType cpu_;
     AttributeType icpulist_;
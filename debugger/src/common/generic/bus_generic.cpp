@@ -17,6 +17,7 @@
 #include <api_core.h>
 #include "bus_generic.h"
 #include "coreservices/icpugen.h"
+#include "coreservices/icpufunctional.h"
 #include "debug/dsumap.h"
 
 namespace debugger {
@@ -28,17 +29,29 @@ BusGeneric::BusGeneric(const char *name) : IService(name),
             sizeof(DsuMapType::local_regs_type::\
                    local_region_type::mst_bus_util_type)) {
     registerInterface(static_cast<IMemoryOperation *>(this));
-    registerAttribute("UseHash", &useHash_);
     RISCV_mutex_init(&mutexBAccess_);
     RISCV_mutex_init(&mutexNBAccess_);
     RISCV_register_hap(static_cast<IHap *>(this));
     busUtil_.setPriority(10);     // Overmap DSU registers
-    imaphash_ = 0;
+    routes_ = 0;
+    routes_cnt_ = 0;
+    chunks_ = 0;
 }
 
 BusGeneric::~BusGeneric() {
     RISCV_mutex_destroy(&mutexBAccess_);
     RISCV_mutex_destroy(&mutexNBAccess_);
+    if (chunks_) {
+        for (int i = 0; i < ROUTE_CHUNKS; i++) {
+            if (chunks_[i].pages) {
+                delete [] chunks_[i].pages;
+            }
+        }
+        delete [] chunks_;
+    }
+    if (routes_) {
+        delete [] routes_;
+    }
 }
 
 void BusGeneric::postinitService() {
@@ -70,34 +83,26 @@ void BusGeneric::postinitService() {
     }
 }
 
-/** We need correctly mapped device list to compute hash, postinit
-    doesn't allow to guarantee order of initialization. */
+/** We need correctly mapped device list to build address decoder,
+    postinit doesn't allow to guarantee order of initialization. */
 void BusGeneric::hapTriggered(IFace *isrc,
                                  EHapType type,
                                  const char *descr) {
-    if (!useHash_.to_bool()) {
-        return;
-    }
-
-    IMemoryOperation *imem;
-    for (unsigned i = 0; i < imap_.size(); i++) {
-        imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
-        maphash(imem);
-    }
+    // Functional CPUs snoop write transactions to invalidate decoded code
+    RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &icpulist_);
+    buildRoutes();
 }
 
 ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
     ETransStatus ret = TRANS_OK;
-    uint32_t sz;
     IMemoryOperation *memdev = 0;
-
-    RISCV_mutex_lock(&mutexBAccess_);
+    bool lock;
 
     if (itranslator_) {
         itranslator_->translate(trans);
     }
 
-    getMapedDevice(trans, &memdev, &sz);
+    getMapedDevice(trans, &memdev, &lock);
 
     if (memdev == 0) {
         RISCV_error("Blocking request to unmapped address "
@@ -105,21 +110,22 @@ ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
         memset(trans->rpayload.b8, 0xFF, trans->xsize);
         ret = TRANS_ERROR;
     } else {
+        if (lock) {
+            RISCV_mutex_lock(&mutexBAccess_);
+        }
         memdev->b_transport(trans);
+        if (lock) {
+            RISCV_mutex_unlock(&mutexBAccess_);
+        }
         RISCV_debug("[%08" RV_PRI64 "x] => [%08x %08x]",
             trans->addr,
             trans->rpayload.b32[1], trans->rpayload.b32[0]);
     }
 
-    // Update Bus utilization counters:
-    if (trans->source_idx >= 0 && trans->source_idx < 8) {
-        if (trans->action == MemAction_Read) {
-            busUtil_.getpR64()[2*trans->source_idx + 1]++;
-        } else if (trans->action == MemAction_Write) {
-            busUtil_.getpR64()[2*trans->source_idx]++;
-        }
+    if (trans->action == MemAction_Write) {
+        snoopWrite(trans->addr);
     }
-    RISCV_mutex_unlock(&mutexBAccess_);
+    updateBusUtil(trans);
     return ret;
 }
 
@@ -127,14 +133,12 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
                                IAxi4NbResponse *cb) {
     ETransStatus ret = TRANS_OK;
     IMemoryOperation *memdev = 0;
-    uint32_t sz;
-
-    RISCV_mutex_lock(&mutexNBAccess_);
+    bool lock;
 
     if (itranslator_) {
         itranslator_->translate(trans);
     }
-    getMapedDevice(trans, &memdev, &sz);
+    getMapedDevice(trans, &memdev, &lock);
 
     if (memdev == 0) {
         RISCV_error("Non-blocking request from %d to unmapped address "
@@ -144,47 +148,261 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
         cb->nb_response(trans);
         ret = TRANS_ERROR;
     } else {
+        if (lock) {
+            RISCV_mutex_lock(&mutexNBAccess_);
+        }
         memdev->nb_transport(trans, cb);
+        if (lock) {
+            RISCV_mutex_unlock(&mutexNBAccess_);
+        }
         RISCV_debug("Non-blocking request to [%08" RV_PRI64 "x]",
                     trans->addr);
     }
 
-    // Update Bus utilization counters:
-    if (trans->source_idx >= 0 && trans->source_idx < 8) {
-        if (trans->action == MemAction_Read) {
-            busUtil_.getpR64()[2*trans->source_idx + 1]++;
-        } else if (trans->action == MemAction_Write) {
-            busUtil_.getpR64()[2*trans->source_idx]++;
-        }
+    if (trans->action == MemAction_Write) {
+        snoopWrite(trans->addr);
     }
-    RISCV_mutex_unlock(&mutexNBAccess_);
+    updateBusUtil(trans);
     return ret;
 }
 
+/** Device region is limited by the other devices mapped over it */
+bool BusGeneric::getHostRegion(uint64_t addr, HostMemoryRegionType *r) {
+    BusRouteType *route;
+    if (itranslator_ || routes_ == 0 || (route = getRoute(addr)) == 0) {
+        return false;
+    }
+    if (!route->imem->getHostRegion(addr, r)) {
+        return false;
+    }
+    if (r->addr < route->addr) {
+        r->ptr += route->addr - r->addr;
+        r->size -= route->addr - r->addr;
+        r->addr = route->addr;
+    }
+    if (r->addr + r->size > route->end) {
+        r->size = route->end - r->addr;
+    }
+    return true;
+}
+
+void BusGeneric::reportHostAccess(int mst_id, uint64_t rdcnt,
+                                  uint64_t wrcnt) {
+    addBusUtil(mst_id, rdcnt, wrcnt);
+}
+
+void BusGeneric::updateBusUtil(Axi4TransactionType *trans) {
+    if (trans->action == MemAction_Read) {
+        addBusUtil(trans->source_idx, 1, 0);
+    } else if (trans->action == MemAction_Write) {
+        addBusUtil(trans->source_idx, 0, 1);
+    }
+}
+
+/** Bus utilization counters are incremented by several masters threads */
+void BusGeneric::addBusUtil(int mst_id, uint64_t rdcnt, uint64_t wrcnt) {
+    if (mst_id < 0 || mst_id >= 8) {
+        return;
+    }
+    uint64_t *cnt = &busUtil_.getpR64()[2*mst_id];
+#if defined(_WIN32) || defined(__CYGWIN__)
+    if (wrcnt) {
+        InterlockedAdd64(reinterpret_cast<volatile LONG64 *>(&cnt[0]),
+                         static_cast<LONG64>(wrcnt));
+    }
+    if (rdcnt) {
+        InterlockedAdd64(reinterpret_cast<volatile LONG64 *>(&cnt[1]),
+                         static_cast<LONG64>(rdcnt));
+    }
+#else
+    if (wrcnt) {
+        __sync_fetch_and_add(&cnt[0], wrcnt);
+    }
+    if (rdcnt) {
+        __sync_fetch_and_add(&cnt[1], rdcnt);
+    }
+#endif
+}
+
+void BusGeneric::snoopWrite(uint64_t addr) {
+    ICpuFunctional *icpu;
+    for (unsigned i = 0; i < icpulist_.size(); i++) {
+        icpu = static_cast<ICpuFunctional *>(icpulist_[i].to_iface());
+        icpu->flush(addr);
+    }
+}
+
 void BusGeneric::getMapedDevice(Axi4TransactionType *trans,
-                         IMemoryOperation **pdev, uint32_t *sz) {
-    IMemoryOperation *imem;
+                         IMemoryOperation **pdev, bool *plock) {
+    BusRouteType *r;
+    *plock = true;
     *pdev = 0;
-    *sz = 0;
-    if (useHash_.to_bool()) {
-        imem = getHashedDevice(trans->addr);
-        if (imem) {
-            *pdev = imem;
-            return;
+    if (routes_ == 0) {
+        // Decoder isn't built yet, use slow search
+        IMemoryOperation *imem;
+        uint64_t bar, barsz;
+        for (unsigned i = 0; i < imap_.size(); i++) {
+            imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
+            bar = imem->getBaseAddress();
+            barsz = imem->getLength();
+            if (bar <= trans->addr && trans->addr < (bar + barsz)) {
+                if (!(*pdev) || imem->getPriority() > (*pdev)->getPriority()) {
+                    *pdev = imem;
+                }
+            }
+        }
+        return;
+    }
+    if ((r = getRoute(trans->addr)) != 0) {
+        *pdev = r->imem;
+        *plock = r->lock;
+    }
+}
+
+BusGeneric::BusRouteType *BusGeneric::getRoute(uint64_t addr) {
+    BusRouteType *r = 0;
+    if ((addr >> 32) == 0) {
+        BusRouteChunkType *chunk = &chunks_[addr >> ROUTE_CHUNK_BITS];
+        if (chunk->route) {
+            r = chunk->route;
+        } else if (chunk->pages) {
+            r = chunk->pages[(addr >> ROUTE_PAGE_BITS)
+                             & ((1 << ROUTE_PAGES_BITS) - 1)];
+        }
+    }
+    if (r == 0) {
+        r = findRoute(addr);
+    }
+    return r;
+}
+
+/** Binary search in the sorted list of regions */
+BusGeneric::BusRouteType *BusGeneric::findRoute(uint64_t addr) {
+    int lo = 0;
+    int hi = routes_cnt_ - 1;
+    int mid;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (addr < routes_[mid].addr) {
+            hi = mid - 1;
+        } else if (addr >= routes_[mid].end) {
+            lo = mid + 1;
+        } else {
+            return &routes_[mid];
         }
     }
+    return 0;
+}
+
+/**
+ * Split address space on intervals by devices boundaries and select the
+ * device with the highest priority for each interval (the first mapped
+ * one if priorities are equal) as the linear search did.
+ */
+void BusGeneric::buildRoutes() {
+    if (routes_) {
+        return;
+    }
+    IMemoryOperation *imem, *sel;
+    unsigned devcnt = imap_.size();
+    int bcnt = 0;
+    uint64_t *bnd = new uint64_t[2*devcnt + 1];
+    uint64_t bar, end, t1;
 
-    uint64_t bar, barsz;
-    for (unsigned i = 0; i < imap_.size(); i++) {
+    // Sorted unique list of boundaries
+    for (unsigned i = 0; i < devcnt; i++) {
         imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
-        bar = imem->getBaseAddress();
-        barsz = imem->getLength();
-        if (bar <= trans->addr && trans->addr < (bar + barsz)) {
-            if (!(*pdev) || imem->getPriority() > (*pdev)->getPriority()) {
-                *pdev = imem;
+        for (int n = 0; n < 2; n++) {
+            t1 = imem->getBaseAddress();
+            if (n) {
+                t1 += imem->getLength();
+            }
+            int k = 0;
+            while (k < bcnt && bnd[k] < t1) {
+                k++;
             }
+            if (k < bcnt && bnd[k] == t1) {
+                continue;
+            }
+            for (int m = bcnt; m > k; m--) {
+                bnd[m] = bnd[m - 1];
+            }
+            bnd[k] = t1;
+            bcnt++;
+        }
+    }
+
+    BusRouteType *routes = new BusRouteType[bcnt + 1];
+    int rcnt = 0;
+    for (int k = 0; k < bcnt - 1; k++) {
+        sel = 0;
+        for (unsigned i = 0; i < devcnt; i++) {
+            imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
+            bar = imem->getBaseAddress();
+            end = bar + imem->getLength();
+            if (bar <= bnd[k] && bnd[k] < end) {
+                if (!sel || imem->getPriority() > sel->getPriority()) {
+                    sel = imem;
+                }
+            }
+        }
+        if (sel == 0) {
+            continue;
         }
+        if (rcnt && routes[rcnt - 1].imem == sel
+            && routes[rcnt - 1].end == bnd[k]) {
+            routes[rcnt - 1].end = bnd[k + 1];
+            continue;
+        }
+        routes[rcnt].addr = bnd[k];
+        routes[rcnt].end = bnd[k + 1];
+        routes[rcnt].imem = sel;
+        rcnt++;
     }
+    delete [] bnd;
+
+    HostMemoryRegionType hr;
+    for (int r = 0; r < rcnt; r++) {
+        routes[r].lock = !routes[r].imem->getHostRegion(routes[r].addr, &hr);
+    }
+
+    // Page-level table of the lower 4 GB. Pages partially covered by
+    // several regions are resolved with the binary search.
+    BusRouteChunkType *chunks = new BusRouteChunkType[ROUTE_CHUNKS];
+    memset(chunks, 0, ROUTE_CHUNKS * sizeof(BusRouteChunkType));
+    const uint64_t chunk_sz = 1ull << ROUTE_CHUNK_BITS;
+    const uint64_t page_sz = 1ull << ROUTE_PAGE_BITS;
+    for (int r = 0; r < rcnt; r++) {
+        bar = routes[r].addr;
+        end = routes[r].end;
+        if (end > 0x100000000ull) {
+            end = 0x100000000ull;
+        }
+        // Full pages only
+        bar = (bar + page_sz - 1) & ~(page_sz - 1);
+        end &= ~(page_sz - 1);
+        while (bar < end) {
+            BusRouteChunkType *chunk = &chunks[bar >> ROUTE_CHUNK_BITS];
+            if ((bar & (chunk_sz - 1)) == 0 && (end - bar) >= chunk_sz) {
+                chunk->route = &routes[r];
+                bar += chunk_sz;
+                continue;
+            }
+            if (chunk->pages == 0) {
+                chunk->pages = new BusRouteType *[1 << ROUTE_PAGES_BITS];
+                memset(chunk->pages, 0,
+                       (1 << ROUTE_PAGES_BITS) * sizeof(BusRouteType *));
+            }
+            chunk->pages[(bar >> ROUTE_PAGE_BITS)
+                         & ((1 << ROUTE_PAGES_BITS) - 1)] = &routes[r];
+            bar += page_sz;
+        }
+    }
+
+    chunks_ = chunks;
+    routes_cnt_ = rcnt;
+    RISCV_memory_barrier();
+    routes_ = routes;
 }
 
 }  // namespace debugger
@@ -39,27 +39,59 @@ class BusGeneric : public IService,
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
     virtual ETransStatus nb_transport(Axi4TransactionType *trans,
                                       IAxi4NbResponse *cb);
+    virtual bool getHostRegion(uint64_t addr, HostMemoryRegionType *r);
+    virtual void reportHostAccess(int mst_id, uint64_t rdcnt,
+                                  uint64_t wrcnt);
 
     /** IHap */
     virtual void hapTriggered(IFace *isrc, EHapType type, const char *descr);
 
  protected:
-    /** Speed-optimized mapping */
-    virtual uint64_t adr_hash(uint64_t adr) { return adr; }
-    virtual void maphash(IMemoryOperation *imemop) {}
-    virtual IMemoryOperation *getHashedDevice(uint64_t addr) { return 0; }
+    /** plock is set when the device requires serialized access */
     void getMapedDevice(Axi4TransactionType *trans,
-                        IMemoryOperation **pdev, uint32_t *sz);
+                        IMemoryOperation **pdev, bool *plock);
+    /** Invalidate decoded instructions in CPUs on write */
+    void snoopWrite(uint64_t addr);
+    /** Build address decoder when all devices are mapped */
+    void buildRoutes();
+    void updateBusUtil(Axi4TransactionType *trans);
+    void addBusUtil(int mst_id, uint64_t rdcnt, uint64_t wrcnt);
 
  protected:
-    AttributeType useHash_;
+    AttributeType icpulist_;
+    GenericReg64Bank busUtil_;    // per master read/write access statistic
+
+    /**
+     * Devices registers don't have own locks, so transactions to them are
+     * serialized as before. Plain memory is accessed by masters in parallel.
+     */
     mutex_def mutexBAccess_;
     mutex_def mutexNBAccess_;
-    Axi4TransactionType b_tr_;
-    Axi4TransactionType nb_tr_;
 
-    GenericReg64Bank busUtil_;    // per master read/write access statistic
-    IMemoryOperation **imaphash_;
+    /**
+     * Address regions with the priority already resolved. The tables are
+     * never modified after HAP_ConfigDone, so lookups are done without lock.
+     */
+    struct BusRouteType {
+        uint64_t addr;
+        uint64_t end;
+        IMemoryOperation *imem;
+        bool lock;              // device isn't a host memory
+    };
+    static const int ROUTE_PAGE_BITS = 12;
+    static const int ROUTE_PAGES_BITS = 10;    // pages in one chunk
+    static const int ROUTE_CHUNK_BITS = ROUTE_PAGE_BITS + ROUTE_PAGES_BITS;
+    static const int ROUTE_CHUNKS = 1 << (32 - ROUTE_CHUNK_BITS);
+    /** Lower 4 GB: route of the whole 4 MB chunk or of each its 4 KB page */
+    struct BusRouteChunkType {
+        BusRouteType *route;
+        BusRouteType **pages;
+    };
+    BusRouteType *routes_;
+    int routes_cnt_;
+    BusRouteChunkType *chunks_;
+    BusRouteType *getRoute(uint64_t addr);
+    BusRouteType *findRoute(uint64_t addr);
 };
 
 DECLARE_CLASS(BusGeneric)
@@ -108,11 +108,7 @@ void CmdBrGeneric::exec(AttributeType *args, AttributeType *res) {
             tap_->write(dsuaddr, 8, braddr.buf);
         } else {
             getSwBreakpointInstr(&brinstr, &brlen);
-            tap_->write(braddr.val, brlen, brinstr.buf);
-
-            // flush address from ICache
-            uint64_t dsuaddr = DSUREGBASE(udbg.v.br_flush_addr);
-            tap_->write(dsuaddr, 8, braddr.buf);
+            writeSwBreakpoint(&braddr, brlen, &brinstr);
         }
         return;
     } 
@@ -126,13 +122,24 @@ void CmdBrGeneric::exec(AttributeType *args, AttributeType *res) {
             // get restoring instruction length
             Reg64Type t1 = brinstr;
             getSwBreakpointInstr(&t1, &brlen);
-            tap_->write(braddr.val, brlen, brinstr.buf);
-
-            // flush address from ICache
-            uint64_t dsuaddr = DSUREGBASE(udbg.v.br_flush_addr);
-            tap_->write(dsuaddr, 8, braddr.buf);
+            writeSwBreakpoint(&braddr, brlen, &brinstr);
         }
     }
 }
 
+void CmdBrGeneric::writeSwBreakpoint(Reg64Type *braddr, uint32_t brlen,
+                                     Reg64Type *brinstr) {
+    // Instruction and flush address from ICache in one request
+    TapOperationType ops[2];
+    ops[0].addr = braddr->val;
+    ops[0].bytes = static_cast<int>(brlen);
+    ops[0].action = TapAction_Write;
+    ops[0].buf = brinstr->buf;
+    ops[1].addr = DSUREGBASE(udbg.v.br_flush_addr);
+    ops[1].bytes = 8;
+    ops[1].action = TapAction_Write;
+    ops[1].buf = braddr->buf;
+    tap_->batch(ops, 2);
+}
+
 }  // namespace debugger
@@ -39,6 +39,10 @@ class CmdBrGeneric : public ICommand  {
     }
     virtual void getSwBreakpointInstr(Reg64Type *instr, uint32_t *len) = 0;
 
+ private:
+    void writeSwBreakpoint(Reg64Type *braddr, uint32_t brlen,
+                           Reg64Type *brinstr);
+
  protected:
     ISourceCode *isrc_;
 };
@@ -45,24 +45,44 @@ int CmdRegsGeneric::isValid(AttributeType *args) {
 }
 
 void CmdRegsGeneric::exec(AttributeType *args, AttributeType *res) {
-    Reg64Type u;
+    const ECpuRegMapping *preg = getpMappedReg();
+    unsigned total = 0;
     if (args->size() != 1) {
-        res->make_list(args->size() - 1);
-        for (unsigned i = 1; i < args->size(); i++) {
-            const char *name = (*args)[i].to_string();
-            tap_->read(reg2addr(name), 8, u.buf);
-            (*res)[i - 1].make_uint64(u.val);
+        total = args->size() - 1;
+    } else {
+        while (preg[total].name[0]) {
+            total++;
         }
-        return;
     }
 
-    const ECpuRegMapping *preg = getpMappedReg();
-    res->make_dict();
-    while (preg->name[0]) {
-        tap_->read(preg->offset, 8, u.buf);
-        (*res)[preg->name].make_uint64(u.val);
-        preg++;
+    // All registers are read by the single batched request
+    Reg64Type *u = new Reg64Type[total];
+    TapOperationType *ops = new TapOperationType[total];
+    for (unsigned i = 0; i < total; i++) {
+        if (args->size() != 1) {
+            ops[i].addr = reg2addr((*args)[i + 1].to_string());
+        } else {
+            ops[i].addr = preg[i].offset;
+        }
+        ops[i].bytes = 8;
+        ops[i].action = TapAction_Read;
+        ops[i].buf = u[i].buf;
+    }
+    tap_->batch(ops, static_cast<int>(total));
+
+    if (args->size() != 1) {
+        res->make_list(total);
+        for (unsigned i = 0; i < total; i++) {
+            (*res)[i].make_uint64(u[i].val);
+        }
+    } else {
+        res->make_dict();
+        for (unsigned i = 0; i < total; i++) {
+            (*res)[preg[i].name].make_uint64(u[i].val);
+        }
     }
+    delete [] ops;
+    delete [] u;
 }
 
 uint64_t CmdRegsGeneric::reg2addr(const char *name) {
@@ -44,6 +44,7 @@ CpuGeneric::CpuGeneric(const char *name)
     registerInterface(static_cast<IPower *>(this));
     registerInterface(static_cast<IResetListener *>(this));
     registerInterface(static_cast<IHap *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("Enable", &isEnable_);
     registerAttribute("SysBus", &sysBus_);
     registerAttribute("DbgBus", &dbgBus_);
@@ -54,12 +55,14 @@ CpuGeneric::CpuGeneric(const char *name)
     registerAttribute("StackTraceSize", &stackTraceSize_);
     registerAttribute("FreqHz", &freqHz_);
     registerAttribute("GenerateTraceFile", &generateTraceFile_);
+    registerAttribute("TraceBinary", &traceBinary_);
     registerAttribute("ResetVector", &resetVector_);
     registerAttribute("SysBusMasterID", &sysBusMasterID_);
     registerAttribute("CacheBaseAddress", &cacheBaseAddr_);
     registerAttribute("CacheAddressMask", &cacheAddrMask_);
     registerAttribute("CoverageTracker", &coverageTracker_);
     registerAttribute("ResetState", &resetState_);
+    registerAttribute("IdleFastForward", &idleFastForward_);
 
     char tstr[256];
     RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
@@ -78,14 +81,32 @@ CpuGeneric::CpuGeneric(const char *name)
     skip_sw_breakpoint_ = false;
     hwBreakpoints_.make_list(0);
     do_not_cache_ = false;
+    ext_scheduler_ = false;
+    quantum_end_ = ~0ull;
+    idleFastForward_.make_boolean(true);
+    memset(&idle_, 0, sizeof(idle_));
+    memwr_cnt_ = 0;
 
     dport_.valid = 0;
     trace_file_ = 0;
+    trace_writer_ = 0;
+    itrace_ = 0;
+    snapshot_evt_total_ = 0;
     memset(&trace_data_, 0, sizeof(trace_data_));
-    icache_ = 0;
-    memcache_sz_ = 0;
+    memset(dpage_hash_, 0, sizeof(dpage_hash_));
+    memset(dpage_map_, 0, sizeof(dpage_map_));
+    dpage_last_ = 0;
+    dblock_ = 0;
+    dblock_gen_ = 1;
+    RISCV_mutex_init(&mutex_flush_);
+    flush_pending_ = false;
+    flush_cnt_ = 0;
     fetch_addr_ = 0;
-    cache_offset_ = 0;
+    pcache_ = 0;
+    host_tlb_cnt_ = 0;
+    host_tlb_next_ = 0;
+    host_rdcnt_ = 0;
+    host_wrcnt_ = 0;
     cachable_pc_ = false;
     CACHE_BASE_ADDR_ = 0;
     CACHE_MASK_ = 0;
@@ -100,13 +121,24 @@ CpuGeneric::CpuGeneric(const char *name)
 CpuGeneric::~CpuGeneric() {
     RISCV_set_default_clock(0);
     RISCV_event_close(&eventConfigDone_);
-    if (icache_) {
-        delete [] icache_;
+    RISCV_mutex_destroy(&mutex_flush_);
+    DecodedPageType *page;
+    for (int i = 0; i < DPAGE_HASH_SIZE; i++) {
+        while ((page = dpage_hash_[i]) != 0) {
+            dpage_hash_[i] = page->next;
+            delete page;
+        }
+    }
+    if (dblock_) {
+        delete [] dblock_;
     }
     if (trace_file_) {
         trace_file_->close();
         delete trace_file_;
     }
+    if (trace_writer_) {
+        delete trace_writer_;
+    }
 }
 
 void CpuGeneric::postinitService() {
@@ -168,13 +200,19 @@ void CpuGeneric::postinitService() {
 
     stackTraceBuf_.setRegTotal(2 * stackTraceSize_.to_int());
 
-    CACHE_BASE_ADDR_ = cacheBaseAddr_.to_uint64();
-    CACHE_MASK_ = ~cacheAddrMask_.to_uint64();
-    if (cacheAddrMask_.to_uint64()) {
-        memcache_sz_ = cacheAddrMask_.to_int() + 1;
-        icache_ = new ICacheType[memcache_sz_];
-        memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
+    // Cache any address if the region isn't specified, zero mask disables
+    // caching (memory could be modified bypassing the system bus).
+    CACHE_BASE_ADDR_ = 0;
+    CACHE_MASK_ = 0;
+    if (cacheAddrMask_.is_integer()) {
+        CACHE_BASE_ADDR_ = cacheBaseAddr_.to_uint64();
+        CACHE_MASK_ = ~cacheAddrMask_.to_uint64();
+        if (cacheAddrMask_.to_uint64() == 0) {
+            CACHE_BASE_ADDR_ = ~0ull;   // odd address is never cached
+        }
     }
+    dblock_ = new DecodedBlockType[DBLOCK_TABLE_SIZE];
+    memset(dblock_, 0, DBLOCK_TABLE_SIZE*sizeof(DecodedBlockType));
 
     // Get global settings:
     const AttributeType *glb = RISCV_get_global_settings();
@@ -184,29 +222,81 @@ void CpuGeneric::postinitService() {
             return;
         }
         if (generateTraceFile_.is_string() && generateTraceFile_.size()) {
-            trace_file_ = new std::ofstream(generateTraceFile_.to_string());
+            if (traceBinary_.to_bool()) {
+                trace_writer_ = new TraceWriterType();
+                if (!trace_writer_->open(generateTraceFile_.to_string())) {
+                    RISCV_error("Can't open trace file %s",
+                                generateTraceFile_.to_string());
+                    delete trace_writer_;
+                    trace_writer_ = 0;
+                }
+            } else {
+                trace_file_ =
+                    new std::ofstream(generateTraceFile_.to_string());
+            }
         }
     }
 }
 
+void CpuGeneric::predeleteService() {
+    if (trace_writer_) {
+        // Store all buffered records before exit
+        trace_writer_->close();
+    }
+}
+
 void CpuGeneric::hapTriggered(IFace *isrc, EHapType type,
                                        const char *descr) {
+    RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &icpulist_);
+    for (unsigned i = 0; i < icpulist_.size(); i++) {
+        if (icpulist_[i].to_iface()
+            == static_cast<ICpuFunctional *>(this)) {
+            icpulist_.remove_from_list(i);
+            break;
+        }
+    }
     RISCV_event_set(&eventConfigDone_);
 }
 
 void CpuGeneric::busyLoop() {
     RISCV_event_wait(&eventConfigDone_);
 
+    if (ext_scheduler_) {
+        return;
+    }
     while (isEnabled()) {
         updatePipeline();
     }
 }
 
+void CpuGeneric::executeUntil(uint64_t t) {
+    if (estate_ != CORE_Normal && estate_ != CORE_Stepping) {
+        // Debug port requests and clock queue of halted core
+        updatePipeline();
+        return;
+    }
+    quantum_end_ = t;
+    while (step_cnt_ < t
+        && (estate_ == CORE_Normal || estate_ == CORE_Stepping)) {
+        updatePipeline();
+    }
+    quantum_end_ = ~0ull;
+}
+
 void CpuGeneric::updatePipeline() {
+    if (host_rdcnt_ | host_wrcnt_) {
+        isysbus_->reportHostAccess(sysBusMasterID_.to_int(),
+                                   host_rdcnt_, host_wrcnt_);
+        host_rdcnt_ = 0;
+        host_wrcnt_ = 0;
+    }
     if (dport_.valid) {
         dport_.valid = 0;
         updateDebugPort();
     }
+    if (flush_pending_) {
+        applyFlush();
+    }
 
     if (!updateState()) {
         return;
@@ -226,6 +316,9 @@ void CpuGeneric::updatePipeline() {
         trackContextStart();
         if (instr_) {
             oplen_ = instr_->exec(cacheline_);
+            if (branch_) {
+                checkIdleLoop();
+            }
         } else {
             generateIllegalOpcode();
         }
@@ -238,11 +331,13 @@ void CpuGeneric::updatePipeline() {
         setNPC(getPC() + oplen_);
     }
 
+    executeBlock();
+
     updateQueue();
 
     handleTrap();
 
-    if (trace_file_) {
+    if (isTraceEnabled()) {
         traceOutput();
     }
 }
@@ -279,17 +374,265 @@ void CpuGeneric::updateQueue() {
     }
 }
 
+void CpuGeneric::setPending(int word, uint64_t mask) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    InterlockedOr64(reinterpret_cast<volatile LONG64 *>(
+                    &interrupt_pending_[word]), static_cast<LONG64>(mask));
+#else
+    __sync_fetch_and_or(&interrupt_pending_[word], mask);
+#endif
+}
+
+void CpuGeneric::clearPending(int word, uint64_t mask) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    InterlockedAnd64(reinterpret_cast<volatile LONG64 *>(
+                    &interrupt_pending_[word]), ~static_cast<LONG64>(mask));
+#else
+    __sync_fetch_and_and(&interrupt_pending_[word], ~mask);
+#endif
+}
+
+/**
+ * Continue execution using the decoded blocks while nothing is scheduled
+ * on the current step. Breakpoints, clock queue and traps are checked only
+ * on exit, so the result is the same as after the step-by-step execution.
+ */
+void CpuGeneric::executeBlock() {
+    if (!dblock_ || isTraceEnabled() || skip_sw_breakpoint_
+        || queue_.isModified() || flush_pending_) {
+        return;
+    }
+    DecodedBlockType *blk;
+    DecodedBlockType::DecodedInstrType *e;
+    uint64_t step_limit = queue_.getNextTime();
+    if (step_limit > step_cnt_ + DBLOCK_STEPS_MAX) {
+        step_limit = step_cnt_ + DBLOCK_STEPS_MAX;
+    }
+    if (step_limit > quantum_end_) {
+        step_limit = quantum_end_;
+    }
+    if (estate_ == CORE_Stepping && hw_stepping_break_ < step_limit) {
+        step_limit = hw_stepping_break_;
+    }
+
+    while (step_cnt_ < step_limit) {
+        if ((blk = getDecodedBlock(getNPC())) == 0) {
+            return;
+        }
+        for (int i = 0; i < blk->size; i++) {
+            if (step_cnt_ >= step_limit
+                || (interrupt_pending_[0] | interrupt_pending_[1])
+                || dport_.valid
+                || queue_.isModified()
+                || flush_pending_
+                || blk->gen != dblock_gen_
+                || (estate_ != CORE_Normal && estate_ != CORE_Stepping)) {
+                return;
+            }
+            e = &blk->e[i];
+            step_cnt_++;
+            setPC(getNPC());
+            branch_ = false;
+            hw_breakpoint_ = false;
+
+            fetch_addr_ = getPC();
+            cachable_pc_ = true;
+            pcache_ = e->pcache;
+            cacheline_[0].buf32[0] = e->buf;
+            instr_ = e->instr;
+
+            oplen_ = instr_->exec(cacheline_);
+            trackContextEnd();
+            pc_z_ = getPC();
+
+            if (branch_) {
+                checkIdleLoop();
+                break;
+            }
+            setNPC(getPC() + oplen_);
+            if (oplen_ != e->oplen) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Step when something may change the state of the idle core: the nearest
+ * clock event or the end of the scheduler quantum. Zero means that steps
+ * cannot be skipped.
+ */
+uint64_t CpuGeneric::idleStepLimit() {
+    if (!idleFastForward_.to_bool()
+        || estate_ != CORE_Normal
+        || isTraceEnabled()
+        || (interrupt_pending_[0] | interrupt_pending_[1])
+        || dport_.valid
+        || queue_.isModified()) {
+        return 0;
+    }
+    uint64_t t = queue_.getNextTime();
+    if (t > quantum_end_) {
+        t = quantum_end_;
+    }
+    if (t == ~0ull) {
+        return 0;   // nothing scheduled, nothing to wait for
+    }
+    return t;
+}
+
+/**
+ * Called on each taken branch. Steps are skipped by the whole loop
+ * iterations so the state at the next clock event is the same as after
+ * the step-by-step execution, including the step counter visible by the
+ * devices (mtime, timers).
+ *
+ * Registers are stored only when the same backward branch repeats without
+ * memory writes. The stored copy is kept while the loop modifies registers,
+ * so the compared state may be several iterations old: the equal state
+ * means that the loop repeats with the period of 'steps' anyway. The
+ * register modified on the previous check is compared first, so the
+ * working loops are rejected with a single compare.
+ */
+void CpuGeneric::checkIdleLoop() {
+    if (!idleFastForward_.to_bool()) {
+        return;
+    }
+    uint64_t npc = getNPC();
+    if (npc > getPC()) {
+        return;
+    }
+    uint64_t steps = step_cnt_ - idle_.step;
+    if (npc != idle_.addr
+        || steps == 0 || steps > IDLE_LOOP_STEPS_MAX
+        || memwr_cnt_ != idle_.memwr_cnt) {
+        idle_.addr = npc;
+        idle_.step = step_cnt_;
+        idle_.memwr_cnt = memwr_cnt_;
+        idle_.regs_valid = false;
+        return;
+    }
+    if (!idle_.regs_valid) {
+        memcpy(idle_.regs, R, sizeof(idle_.regs));
+        idle_.regs_valid = true;
+        idle_.step = step_cnt_;
+        return;
+    }
+    if (idle_.regs[idle_.diff_idx] != R[idle_.diff_idx]) {
+        return;
+    }
+    for (int i = 0; i < IDLE_LOOP_REGS_TOTAL; i++) {
+        if (idle_.regs[i] != R[i]) {
+            idle_.diff_idx = i;
+            return;
+        }
+    }
+    uint64_t t = idleStepLimit();
+    if (t > step_cnt_ + steps) {
+        step_cnt_ += ((t - step_cnt_) / steps) * steps;
+    }
+    idle_.step = step_cnt_;
+}
+
+/**
+ * WFI may be resumed by any event, so the core sleeps until the nearest
+ * clock event and continues with the next instruction.
+ */
+void CpuGeneric::waitForInterrupt() {
+    uint64_t t = idleStepLimit();
+    if (t > step_cnt_) {
+        step_cnt_ = t;
+    }
+}
+
+/**
+ * Decoded block starting from the specified address. Block is built from
+ * the instruction cache entries and never contains HW breakpoints.
+ */
+CpuGeneric::DecodedBlockType *CpuGeneric::getDecodedBlock(uint64_t addr) {
+    DecodedBlockType *blk = &dblock_[(addr >> 1) & (DBLOCK_TABLE_SIZE - 1)];
+    if (blk->addr == addr && blk->gen == dblock_gen_ && blk->size) {
+        return blk;
+    }
+
+    ICacheType *pcache;
+    blk->addr = addr;
+    blk->gen = dblock_gen_;
+    blk->size = 0;
+    while (blk->size < DBLOCK_LENGTH_MAX) {
+        pcache = getICache(addr, false);
+        if (pcache == 0 || pcache->instr == 0 || pcache->oplen == 0) {
+            break;
+        }
+        if (isHwBreakpointAddr(addr)) {
+            break;
+        }
+        blk->e[blk->size].pcache = pcache;
+        blk->e[blk->size].instr = pcache->instr;
+        blk->e[blk->size].buf = pcache->buf;
+        blk->e[blk->size].oplen = pcache->oplen;
+        blk->size++;
+        addr += pcache->oplen;
+    }
+    if (blk->size == 0) {
+        return 0;
+    }
+    return blk;
+}
+
+/**
+ * Page of the decoded instructions. New pages are linked into the hash
+ * table only after initialization and never removed until destruction, so
+ * the table can be searched from the other threads (see flush()).
+ */
+CpuGeneric::DecodedPageType *CpuGeneric::getDecodedPage(uint64_t addr,
+                                                        bool alloc) {
+    uint64_t page_addr = addr & ~(DPAGE_SIZE - 1);
+    DecodedPageType *page = dpage_last_;
+    if (page && page->addr == page_addr) {
+        return page;
+    }
+    int hidx = static_cast<int>((addr >> DPAGE_BITS) & (DPAGE_HASH_SIZE - 1));
+    page = dpage_hash_[hidx];
+    while (page && page->addr != page_addr) {
+        page = page->next;
+    }
+    if (page == 0 && alloc) {
+        int midx = static_cast<int>((addr >> DPAGE_BITS)
+                                    & (DPAGE_MAP_SIZE - 1));
+        dpage_map_[midx >> 6] |= 1ull << (midx & 0x3F);
+        page = new DecodedPageType;
+        memset(page->e, 0, sizeof(page->e));
+        page->addr = page_addr;
+        page->next = dpage_hash_[hidx];
+        dpage_hash_[hidx] = page;
+    }
+    if (page) {
+        dpage_last_ = page;
+    }
+    return page;
+}
+
+CpuGeneric::ICacheType *CpuGeneric::getICache(uint64_t addr, bool alloc) {
+    if ((addr & CACHE_MASK_) != CACHE_BASE_ADDR_ || (addr & 0x1)) {
+        return 0;
+    }
+    DecodedPageType *page = getDecodedPage(addr, alloc);
+    if (page == 0) {
+        return 0;
+    }
+    return &page->e[(addr & (DPAGE_SIZE - 1)) >> 1];
+}
+
 void CpuGeneric::fetchILine() {
     fetch_addr_ = fetchingAddress();
-    cachable_pc_ = false;
     instr_ = 0;
-    if ((fetch_addr_ & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-        cachable_pc_ = true;
-        cache_offset_ = fetch_addr_ - CACHE_BASE_ADDR_;
-        instr_ = icache_[cache_offset_].instr;
-        cacheline_[0].buf32[0] = icache_[cache_offset_].buf;  // for tracer
+    pcache_ = getICache(fetch_addr_, true);
+    cachable_pc_ = pcache_ != 0;
+    if (cachable_pc_) {
+        instr_ = pcache_->instr;
+        cacheline_[0].buf32[0] = pcache_->buf;  // for tracer
     }
-    
 
     if (!instr_) {
         trans_.action = MemAction_Read;
@@ -308,22 +651,79 @@ void CpuGeneric::fetchILine() {
     }
 }
 
+/**
+ * Request to clear decoded instructions of the page containing the address
+ * or the whole cache and host memory regions when addr = ~0. Called on SW
+ * breakpoint insertion and on any write transaction into memory (see
+ * BusGeneric) from any thread, so it should be fast when the page wasn't
+ * executed.
+ */
 void CpuGeneric::flush(uint64_t addr) {
-    if (icache_ == 0) {
-        return;
+    if (addr != ~0ull) {
+        if (!isDecodedPage(addr)) {
+            return;
+        }
+        uint64_t page_addr = addr & ~(DPAGE_SIZE - 1);
+        int hidx = static_cast<int>((addr >> DPAGE_BITS)
+                                    & (DPAGE_HASH_SIZE - 1));
+        DecodedPageType *page = dpage_hash_[hidx];
+        while (page && page->addr != page_addr) {
+            page = page->next;
+        }
+        if (page == 0) {
+            return;
+        }
+    }
+    RISCV_mutex_lock(&mutex_flush_);
+    if (addr == ~0ull || flush_cnt_ >= FLUSH_QUEUE_SIZE) {
+        flush_cnt_ = FLUSH_QUEUE_SIZE + 1;
+    } else {
+        flush_queue_[flush_cnt_++] = addr;
+    }
+    flush_pending_ = true;
+    RISCV_mutex_unlock(&mutex_flush_);
+}
+
+void CpuGeneric::applyFlush() {
+    RISCV_mutex_lock(&mutex_flush_);
+    if (flush_cnt_ > FLUSH_QUEUE_SIZE) {
+        flushDecoded(~0ull);
+    } else {
+        for (int i = 0; i < flush_cnt_; i++) {
+            flushDecoded(flush_queue_[i]);
+        }
     }
+    flush_cnt_ = 0;
+    flush_pending_ = false;
+    RISCV_mutex_unlock(&mutex_flush_);
+}
+
+void CpuGeneric::flushDecoded(uint64_t addr) {
+    DecodedPageType *page;
     if (addr == ~0ull) {
-        memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
-    } else if ((addr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-        /** SW breakpoint manager must call this flush operation */
-        if ((addr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-            icache_[addr - CACHE_BASE_ADDR_].instr = 0;
+        for (int i = 0; i < DPAGE_HASH_SIZE; i++) {
+            for (page = dpage_hash_[i]; page; page = page->next) {
+                memset(page->e, 0, sizeof(page->e));
+            }
+        }
+        dblock_gen_++;
+        host_tlb_cnt_ = 0;
+        host_tlb_next_ = 0;
+        return;
+    }
+    uint64_t page_addr = addr & ~(DPAGE_SIZE - 1);
+    int hidx = static_cast<int>((addr >> DPAGE_BITS) & (DPAGE_HASH_SIZE - 1));
+    for (page = dpage_hash_[hidx]; page; page = page->next) {
+        if (page->addr == page_addr) {
+            memset(page->e, 0, sizeof(page->e));
+            dblock_gen_++;
+            break;
         }
     }
 }
 
 void CpuGeneric::trackContextStart() {
-    if (!trace_file_) {
+    if (!isTraceEnabled()) {
         return;
     }
     trace_data_.action_cnt = 0;
@@ -335,23 +735,71 @@ void CpuGeneric::trackContextStart() {
 void CpuGeneric::trackContextEnd() {
     if (do_not_cache_) {
         if (cachable_pc_) {
-            icache_[cache_offset_].instr = 0;
+            pcache_->instr = 0;
+            dblock_gen_++;
         }
     } else {
-        if (icovtracker_) {
+        // Address is reported once while the decoded entry is valid,
+        // the tracker flushes CPUs when its bitmaps are cleared.
+        if (icovtracker_ && !(cachable_pc_ && pcache_->covered)) {
             icovtracker_->markAddress(fetch_addr_,
                                       static_cast<uint8_t>(oplen_));
+            if (cachable_pc_) {
+                pcache_->covered = 1;
+            }
         }
-        if (cachable_pc_) {
-            icache_[cache_offset_].instr = instr_;
-            icache_[cache_offset_].buf = cacheline_[0].buf32[0];
+        // Instruction crossing the page boundary isn't cached because
+        // it won't be invalidated on write into the next page
+        if (cachable_pc_
+            && (fetch_addr_ & (DPAGE_SIZE - 1)) + oplen_ <= DPAGE_SIZE) {
+            pcache_->instr = instr_;
+            pcache_->buf = cacheline_[0].buf32[0];
+            pcache_->oplen = oplen_;
         }
     }
     do_not_cache_ = false;
 }
 
+void CpuGeneric::traceOutput() {
+    if (itrace_) {
+        itrace_->instrRetired(&trace_data_);
+    }
+    if (trace_writer_) {
+        trace_writer_->write(&trace_data_);
+    } else if (trace_file_) {
+        traceText(&trace_data_, trace_file_);
+        trace_file_->flush();
+    }
+}
+
+int64_t CpuGeneric::renderTrace(const char *binfile, const char *txtfile) {
+    TraceReaderType reader;
+    TraceRecordType *rec;
+    std::ofstream out;
+    int64_t cnt = 0;
+
+    if (!reader.open(binfile, traceRegsTotal())) {
+        RISCV_error("Can't open binary trace file %s", binfile);
+        return -1;
+    }
+    out.open(txtfile);
+    if (!out.is_open()) {
+        RISCV_error("Can't open output file %s", txtfile);
+        return -1;
+    }
+
+    rec = new TraceRecordType;
+    while (reader.read(rec)) {
+        traceText(rec, &out);
+        cnt++;
+    }
+    delete rec;
+    out.close();
+    return cnt;
+}
+
 void CpuGeneric::traceRegister(int idx, uint64_t v) {
-    if (trace_data_.action_cnt >= 64) {
+    if (trace_data_.action_cnt >= TRACE_ACTIONS_MAX) {
         return;
     }
     trace_action_type *p = &trace_data_.action[trace_data_.action_cnt++];
@@ -361,7 +809,7 @@ void CpuGeneric::traceRegister(int idx, uint64_t v) {
 }
 
 void CpuGeneric::traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz) {
-    if (trace_data_.action_cnt >= 64) {
+    if (trace_data_.action_cnt >= TRACE_ACTIONS_MAX) {
         return;
     }
     trace_action_type *p = &trace_data_.action[trace_data_.action_cnt++];
@@ -391,7 +839,7 @@ bool CpuGeneric::moveStepCallback(IClockListener *cb, uint64_t t) {
 
 void CpuGeneric::setReg(int idx, uint64_t val) {
     R[idx] = val;
-    if (trace_file_) {
+    if (isTraceEnabled()) {
         traceRegister(idx, val);
     }
 }
@@ -421,7 +869,12 @@ void CpuGeneric::popStackTrace() {
 ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr) {
     ETransStatus ret = TRANS_OK;
     tr->source_idx = sysBusMasterID_.to_int();
-    if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
+    if (tr->action == MemAction_Write) {
+        memwr_cnt_++;
+    }
+    if (hostMemop(tr)) {
+        ret = TRANS_OK;
+    } else if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
         ret = isysbus_->b_transport(tr);
     } else {
         // 1-byte access for HC08
@@ -441,7 +894,7 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr) {
         }
     }
 
-    if (trace_file_) {
+    if (isTraceEnabled()) {
         int we = tr->action == MemAction_Write ? 1 : 0;
         Reg64Type memop_data;
         memop_data.val = 0;
@@ -455,6 +908,73 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr) {
     return ret;
 }
 
+/**
+ * Direct access to the plain memory bypassing the system bus. MMIO devices
+ * and memory with DPI mirroring don't provide host regions and go through
+ * the bus. Accesses are counted and reported to the bus utilization
+ * statistic on the next pipeline update. Stores flush own decoded page
+ * only if it was ever decoded, the other CPUs filter it the same way.
+ */
+bool CpuGeneric::hostMemop(Axi4TransactionType *tr) {
+    HostMemoryRegionType *r = 0;
+    HostMemoryRegionType t1;
+    uint64_t end = tr->addr + tr->xsize;
+    for (int i = 0; i < host_tlb_cnt_; i++) {
+        if (host_tlb_[i].addr <= tr->addr
+            && end <= host_tlb_[i].addr + host_tlb_[i].size) {
+            r = &host_tlb_[i];
+            break;
+        }
+    }
+    if (r == 0) {
+        if (!isysbus_->getHostRegion(tr->addr, &t1)
+            || end > t1.addr + t1.size) {
+            return false;
+        }
+        r = &host_tlb_[host_tlb_next_];
+        *r = t1;
+        host_tlb_next_ = (host_tlb_next_ + 1) % HOST_TLB_SIZE;
+        if (host_tlb_cnt_ < HOST_TLB_SIZE) {
+            host_tlb_cnt_++;
+        }
+    }
+
+    uint8_t *p = &r->ptr[tr->addr - r->addr];
+    if (tr->action == MemAction_Read) {
+        tr->rpayload.b64[0] = 0;
+        switch (tr->xsize) {
+        case 1: tr->rpayload.b8[0] = p[0]; break;
+        case 2: memcpy(tr->rpayload.b8, p, 2); break;
+        case 4: memcpy(tr->rpayload.b8, p, 4); break;
+        case 8: memcpy(tr->rpayload.b8, p, 8); break;
+        default: memcpy(tr->rpayload.b8, p, tr->xsize);
+        }
+        host_rdcnt_++;
+    } else {
+        uint32_t wmask = (1u << tr->xsize) - 1;
+        if (!r->writable || (tr->wstrb & wmask) != wmask) {
+            return false;
+        }
+        switch (tr->xsize) {
+        case 1: p[0] = tr->wpayload.b8[0]; break;
+        case 2: memcpy(p, tr->wpayload.b8, 2); break;
+        case 4: memcpy(p, tr->wpayload.b8, 4); break;
+        case 8: memcpy(p, tr->wpayload.b8, 8); break;
+        default: memcpy(p, tr->wpayload.b8, tr->xsize);
+        }
+        host_wrcnt_++;
+        if (isDecodedPage(tr->addr)) {
+            flush(tr->addr);
+        }
+        for (unsigned i = 0; i < icpulist_.size(); i++) {
+            static_cast<ICpuFunctional *>(
+                icpulist_[i].to_iface())->flush(tr->addr);
+        }
+    }
+    tr->response = MemResp_Valid;
+    return true;
+}
+
 void CpuGeneric::go() {
     if (estate_ == CORE_OFF) {
         RISCV_error("CPU is turned-off", 0);
@@ -536,6 +1056,139 @@ void CpuGeneric::reset(IFace *isource) {
     do_not_cache_ = false;
 }
 
+uint64_t CpuGeneric::getSnapshotSize() {
+    // Saved events count should be the same as the reserved one
+    snapshot_evt_total_ = queue_.getItemsTotal();
+    return sizeof(snapshot_type) + portRegs_.getLength()
+        + stackTraceBuf_.getLength() + getSnapshotExtSize()
+        + snapshot_evt_total_ * sizeof(snapshot_event_type);
+}
+
+void CpuGeneric::saveSnapshot(uint8_t *buf) {
+    snapshot_type *p = reinterpret_cast<snapshot_type *>(buf);
+    int evt_total = snapshot_evt_total_;
+    int evt_cnt;
+    uint64_t *evt_time = new uint64_t[evt_total + 1];
+    IFace **evt_cb = new IFace *[evt_total + 1];
+    AttributeType listeners;
+    uint64_t off = sizeof(snapshot_type);
+
+    p->step_cnt = step_cnt_;
+    p->pc_z = pc_z_;
+    p->interrupt_pending[0] = interrupt_pending_[0];
+    p->interrupt_pending[1] = interrupt_pending_[1];
+    p->stack_trace_cnt = stackTraceCnt_.getValue().val;
+    p->prv_level = cur_prv_level;
+    p->regs_size = static_cast<uint32_t>(portRegs_.getLength());
+    p->stack_trace_size = static_cast<uint32_t>(stackTraceBuf_.getLength());
+    p->ext_size = static_cast<uint32_t>(getSnapshotExtSize());
+
+    memcpy(&buf[off], portRegs_.getp(), p->regs_size);
+    off += p->regs_size;
+    memcpy(&buf[off], stackTraceBuf_.getp(), p->stack_trace_size);
+    off += p->stack_trace_size;
+    saveSnapshotExt(&buf[off]);
+    off += p->ext_size;
+
+    // Clock events are stored with the names of the listener services
+    evt_cnt = queue_.getItems(evt_time, evt_cb, evt_total);
+    if (queue_.getItemsTotal() > evt_total) {
+        RISCV_error("Clock events registered after the size request "
+                    "aren't stored", NULL);
+    }
+    p->event_total = evt_total;
+    RISCV_get_services_with_iface(IFACE_CLOCK_LISTENER, &listeners);
+    for (int i = 0; i < evt_total; i++) {
+        snapshot_event_type *pevt =
+            reinterpret_cast<snapshot_event_type *>(&buf[off]);
+        off += sizeof(snapshot_event_type);
+        pevt->listener[0] = '\0';
+        if (i >= evt_cnt) {
+            // Reserved entry without listener is skipped on restore
+            pevt->time = 0;
+            continue;
+        }
+        pevt->time = evt_time[i];
+        for (unsigned n = 0; n < listeners.size(); n++) {
+            IService *iserv =
+                static_cast<IService *>(listeners[n].to_iface());
+            if (iserv->getInterface(IFACE_CLOCK_LISTENER) == evt_cb[i]) {
+                RISCV_sprintf(pevt->listener, sizeof(pevt->listener),
+                              "%s", iserv->getObjName());
+                break;
+            }
+        }
+        if (pevt->listener[0] == '\0') {
+            RISCV_error("Clock event at %" RV_PRI64 "d isn't stored",
+                        evt_time[i]);
+        }
+    }
+    delete [] evt_time;
+    delete [] evt_cb;
+}
+
+/** Events count of the saved state may differ from the current one */
+bool CpuGeneric::checkSnapshotSize(uint64_t sz) {
+    uint64_t fixsz = sizeof(snapshot_type) + portRegs_.getLength()
+        + stackTraceBuf_.getLength() + getSnapshotExtSize();
+    return sz >= fixsz && (sz - fixsz) % sizeof(snapshot_event_type) == 0;
+}
+
+ESnapshotStatus CpuGeneric::restoreSnapshot(uint8_t *buf, uint64_t sz) {
+    snapshot_type *p = reinterpret_cast<snapshot_type *>(buf);
+    uint64_t off = sizeof(snapshot_type);
+    if (sz < sizeof(snapshot_type)
+        || p->regs_size != portRegs_.getLength()
+        || p->stack_trace_size != stackTraceBuf_.getLength()
+        || p->ext_size != getSnapshotExtSize()
+        || sz != off + p->regs_size + p->stack_trace_size + p->ext_size
+                + p->event_total * sizeof(snapshot_event_type)) {
+        RISCV_error("Wrong snapshot format", NULL);
+        return SNAPSHOT_ERROR;
+    }
+
+    step_cnt_ = p->step_cnt;
+    pc_z_ = p->pc_z;
+    memset(&idle_, 0, sizeof(idle_));
+    interrupt_pending_[0] = p->interrupt_pending[0];
+    interrupt_pending_[1] = p->interrupt_pending[1];
+    stackTraceCnt_.setValue(p->stack_trace_cnt);
+    cur_prv_level = p->prv_level;
+
+    memcpy(portRegs_.getp(), &buf[off], p->regs_size);
+    off += p->regs_size;
+    memcpy(stackTraceBuf_.getp(), &buf[off], p->stack_trace_size);
+    off += p->stack_trace_size;
+    restoreSnapshotExt(&buf[off]);
+    off += p->ext_size;
+
+    uint64_t *evt_time = new uint64_t[p->event_total + 1];
+    IFace **evt_cb = new IFace *[p->event_total + 1];
+    int evt_total = 0;
+    for (unsigned i = 0; i < p->event_total; i++) {
+        snapshot_event_type *pevt =
+            reinterpret_cast<snapshot_event_type *>(&buf[off]);
+        off += sizeof(snapshot_event_type);
+        evt_cb[evt_total] = RISCV_get_service_iface(pevt->listener,
+                                                    IFACE_CLOCK_LISTENER);
+        if (evt_cb[evt_total] == 0) {
+            continue;
+        }
+        evt_time[evt_total++] = pevt->time;
+    }
+    queue_.setItems(evt_time, evt_cb, evt_total);
+    delete [] evt_time;
+    delete [] evt_cb;
+
+    hw_breakpoint_ = false;
+    sw_breakpoint_ = false;
+    skip_sw_breakpoint_ = false;
+    do_not_cache_ = false;
+    // Memory content and host mapping were changed
+    flush(~0ull);
+    return SNAPSHOT_COPIED;
+}
+
 void CpuGeneric::updateDebugPort() {
     DebugPortTransactionType *trans = dport_.trans;
     Axi4TransactionType tr;
@@ -580,9 +1233,10 @@ void CpuGeneric::removeHwBreakpoint(uint64_t addr) {
         if (addr == hwBreakpoints_[i].to_uint64()) {
             hwBreakpoints_.remove_from_list(i);
             hwBreakpoints_.sort();
-            return;
+            break;
         }
     }
+    // Blocks decoded while the breakpoint was set are truncated on it
     flush(addr);
 }
 
@@ -610,6 +1264,15 @@ bool CpuGeneric::checkHwBreakpoint() {
     return false;
 }
 
+bool CpuGeneric::isHwBreakpointAddr(uint64_t addr) {
+    for (unsigned i = 0; i < hwBreakpoints_.size(); i++) {
+        if (addr == hwBreakpoints_[i].to_uint64()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void CpuGeneric::skipBreakpoint() {
     skip_sw_breakpoint_ = true;
     sw_breakpoint_ = false;
@@ -31,7 +31,9 @@
 #include "coreservices/icmdexec.h"
 #include "coreservices/itap.h"
 #include "coreservices/icoveragetracker.h"
+#include "coreservices/isnapshot.h"
 #include "generic/mapreg.h"
+#include "generic/trace_writer.h"
 #include <fstream>
 
 namespace debugger {
@@ -118,13 +120,15 @@ class CpuGeneric : public IService,
                    public IClock,
                    public IPower,
                    public IResetListener,
-                   public IHap {
+                   public IHap,
+                   public ISnapshot {
  public:
     explicit CpuGeneric(const char *name);
     virtual ~CpuGeneric();
 
     /** IService interface */
     virtual void postinitService();
+    virtual void predeleteService();
 
     /** ICpuGeneric interface */
     virtual void raiseSignal(int idx) = 0;
@@ -160,6 +164,16 @@ class CpuGeneric : public IService,
     virtual void skipBreakpoint();
     virtual void flush(uint64_t addr);
     virtual void doNotCache(uint64_t addr) { do_not_cache_ = true; }
+    /** Text representation of the trace record used by offline rendering */
+    virtual void traceText(TraceRecordType *rec, std::ofstream *out) {}
+    /** Number of register names known to traceText */
+    virtual int traceRegsTotal() { return 0; }
+    virtual void attachScheduler() { ext_scheduler_ = true; }
+    virtual void executeUntil(uint64_t t);
+    virtual void setInstrTrace(IInstrTrace *itrace) { itrace_ = itrace; }
+    virtual int64_t renderTrace(const char *binfile, const char *txtfile);
+    /** Wait for interrupt: skip steps until the next clock event */
+    void waitForInterrupt();
  protected:
     virtual uint64_t getResetAddress() { return resetVector_.to_uint64(); }
     virtual EEndianessType endianess() = 0;
@@ -170,7 +184,11 @@ class CpuGeneric : public IService,
     virtual void trackContextEnd();
     virtual void traceRegister(int idx, uint64_t v);
     virtual void traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz);
-    virtual void traceOutput() {}
+    /** Write trace record into text or binary trace file */
+    void traceOutput();
+    bool isTraceEnabled() {
+        return trace_file_ || trace_writer_ || itrace_;
+    }
 
  public:
     /** IClock */
@@ -194,10 +212,21 @@ class CpuGeneric : public IService,
     /** IHap */
     virtual void hapTriggered(IFace *isrc, EHapType type, const char *descr);
 
+    /** ISnapshot */
+    virtual uint64_t getSnapshotSize();
+    virtual bool checkSnapshotSize(uint64_t sz);
+    virtual void saveSnapshot(uint8_t *buf);
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz);
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
 
+    /** Model specific state stored after the generic CPU registers */
+    virtual uint64_t getSnapshotExtSize() { return 0; }
+    virtual void saveSnapshotExt(uint8_t *buf) {}
+    virtual void restoreSnapshotExt(uint8_t *buf) {}
+
     virtual void updatePipeline();
     virtual bool updateState();
     virtual uint64_t fetchingAddress() { return getPC(); }
@@ -205,6 +234,14 @@ class CpuGeneric : public IService,
     virtual void updateDebugPort();
     virtual void updateQueue();
     virtual bool checkHwBreakpoint();
+    virtual void executeBlock();
+    uint64_t idleStepLimit();
+    void checkIdleLoop();
+    bool isHwBreakpointAddr(uint64_t addr);
+    bool hostMemop(Axi4TransactionType *tr);
+    /** Signals could be raised and lowered from the devices threads */
+    void setPending(int word, uint64_t mask);
+    void clearPending(int word, uint64_t mask);
 
  protected:
     AttributeType isEnable_;
@@ -217,6 +254,7 @@ class CpuGeneric : public IService,
     AttributeType sourceCode_;
     AttributeType stackTraceSize_;
     AttributeType generateTraceFile_;
+    AttributeType traceBinary_;
     AttributeType resetVector_;
     AttributeType sysBusMasterID_;
     AttributeType hwBreakpoints_;
@@ -224,6 +262,7 @@ class CpuGeneric : public IService,
     AttributeType cacheAddrMask_;
     AttributeType coverageTracker_;
     AttributeType resetState_;
+    AttributeType idleFastForward_;
 
     ISourceCode *isrc_;
     ICoverageTracker *icovtracker_;
@@ -265,6 +304,8 @@ class CpuGeneric : public IService,
     bool hw_breakpoint_;
     uint64_t hw_break_addr_;    // Last hit breakpoint to skip it on next step
     bool do_not_cache_;         // Do not put instruction into ICache
+    bool ext_scheduler_;        // Thread loop is replaced by scheduler
+    uint64_t quantum_end_;      // Block execution limit of the scheduler
 
     event_def eventConfigDone_;
     ClockAsyncTQueueType queue_;
@@ -279,18 +320,109 @@ class CpuGeneric : public IService,
     Axi4TransactionType trans_;
     Reg64Type cacheline_[512/4];
     
-    // Simple memory cache to avoid access to sysbus and speed-up simulation
+    /**
+     * Decoded instructions cache to avoid access to sysbus and speed-up
+     * simulation. Pages are allocated on the first fetch from the page and
+     * cleared on write into the page, so any executable region is cached.
+     */
+    static const int DPAGE_BITS = 12;
+    static const uint64_t DPAGE_SIZE = 1ull << DPAGE_BITS;
+    static const int DPAGE_HASH_SIZE = 1 << 10;
     struct ICacheType {
         GenericInstruction *instr;
         uint32_t buf;
-    } *icache_;            // parsed instructions storage
-    int memcache_sz_;               // allocated size
+        uint16_t oplen;
+        uint16_t covered;                   // reported to coverage tracker
+    };
+    struct DecodedPageType {
+        uint64_t addr;
+        DecodedPageType *next;              // next page with the same hash
+        ICacheType e[DPAGE_SIZE / 2];       // one entry per halfword
+    };
+    DecodedPageType *dpage_hash_[DPAGE_HASH_SIZE];
+    DecodedPageType *dpage_last_;           // last accessed page
+    /** Pages ever decoded, aliased modulo DPAGE_MAP_SIZE and never cleared */
+    static const int DPAGE_MAP_SIZE = 1 << 15;
+    uint64_t dpage_map_[DPAGE_MAP_SIZE / 64];
+    bool isDecodedPage(uint64_t addr) {
+        int idx = static_cast<int>((addr >> DPAGE_BITS) & (DPAGE_MAP_SIZE - 1));
+        return ((dpage_map_[idx >> 6] >> (idx & 0x3F)) & 0x1) != 0;
+    }
+    DecodedPageType *getDecodedPage(uint64_t addr, bool alloc);
+    ICacheType *getICache(uint64_t addr, bool alloc);
+
     uint64_t CACHE_BASE_ADDR_;
     uint64_t CACHE_MASK_;
     uint64_t fetch_addr_;
-    uint64_t cache_offset_;         // instruction pointer - CACHE_BASE_ADDR
+    ICacheType *pcache_;            // cache entry of the fetched_pc
     bool cachable_pc_;              // fetched_pc hit into cachable region
 
+    /**
+     * Straight runs of the already decoded instructions. Executed in a tight
+     * loop without breakpoint/queue/trap checking after each instruction.
+     */
+    static const int DBLOCK_TABLE_SIZE = 1 << 12;
+    static const int DBLOCK_LENGTH_MAX = 32;
+    static const uint64_t DBLOCK_STEPS_MAX = 4096;
+    struct DecodedBlockType {
+        uint64_t addr;
+        uint64_t gen;
+        int size;
+        struct DecodedInstrType {
+            ICacheType *pcache;
+            GenericInstruction *instr;
+            uint32_t buf;
+            uint32_t oplen;
+        } e[DBLOCK_LENGTH_MAX];
+    } *dblock_;
+    uint64_t dblock_gen_;           // incremented on each cache flush
+    DecodedBlockType *getDecodedBlock(uint64_t addr);
+
+    /**
+     * Flush requests may come from the other threads (bus snooping of the
+     * other CPUs, debugger). They are posted here and applied by the CPU
+     * thread on the next step or decoded block boundary, so the decoded
+     * pages and blocks are modified only by their owner.
+     */
+    static const int FLUSH_QUEUE_SIZE = 16;
+    mutex_def mutex_flush_;
+    volatile bool flush_pending_;
+    int flush_cnt_;                 // above FLUSH_QUEUE_SIZE flushes all
+    uint64_t flush_queue_[FLUSH_QUEUE_SIZE];
+    void applyFlush();
+    void flushDecoded(uint64_t addr);
+
+    /**
+     * Idle loop detector. Backward branch which repeats the previous loop
+     * iteration without any change of the registers and without memory
+     * writes means that the loop waits for an event (timer, interrupt or
+     * device status), so the whole iterations up to the next clock event
+     * are skipped without changing the simulation result.
+     */
+    static const uint64_t IDLE_LOOP_STEPS_MAX = 16;
+    static const int IDLE_LOOP_REGS_TOTAL = 96;     // integer, pc and fpu
+    struct IdleLoopType {
+        uint64_t addr;              // branch target
+        uint64_t step;              // step counter at the iteration start
+        uint64_t memwr_cnt;         // memory writes at the iteration start
+        bool regs_valid;            // regs[] stored at the iteration start
+        int diff_idx;               // register modified by the loop
+        uint64_t regs[IDLE_LOOP_REGS_TOTAL];
+    } idle_;
+    uint64_t memwr_cnt_;            // memory writes counter
+
+    /**
+     * Memory regions accessible without system bus transactions. Stores
+     * into them are snooped by all CPUs the same way as BusGeneric does.
+     */
+    static const int HOST_TLB_SIZE = 4;
+    HostMemoryRegionType host_tlb_[HOST_TLB_SIZE];
+    int host_tlb_cnt_;
+    int host_tlb_next_;             // entry to replace on miss
+    uint64_t host_rdcnt_;           // reported to the bus utilization
+    uint64_t host_wrcnt_;
+    AttributeType icpulist_;        // the other CPUs snooping host stores
+
     struct DebugPortType {
         bool valid;
         DebugPortTransactionType *trans;
@@ -299,26 +431,32 @@ class CpuGeneric : public IService,
 
     uint64_t cur_prv_level;
 
-    struct trace_action_type {
-        bool memop;             // 0=register; 1=memop
-        int waddr;              // register addr
-        uint64_t wdata;         // register data
-        int memop_write;        // 0=read
-        uint64_t memop_addr;
-        Reg64Type memop_data;
-        int memop_size;
+    /**
+     * Snapshot: header, register bank, stack trace buffer, model specific
+     * state and the pending clock events stored with the listener names.
+     */
+    struct snapshot_type {
+        uint64_t step_cnt;
+        uint64_t pc_z;
+        uint64_t interrupt_pending[2];
+        uint64_t stack_trace_cnt;
+        uint64_t prv_level;
+        uint32_t regs_size;
+        uint32_t stack_trace_size;
+        uint32_t ext_size;
+        uint32_t event_total;
+    };
+    struct snapshot_event_type {
+        uint64_t time;
+        char listener[64];
     };
 
-    struct trace_type {
-        uint64_t step_cnt;
-        uint64_t pc;
-        uint32_t instr;
-        char disasm[256];
-        // 1 instruction several actions
-        trace_action_type action[64];
-        int action_cnt;
-    } trace_data_;
+    typedef TraceActionType trace_action_type;
+    TraceRecordType trace_data_;
     std::ofstream *trace_file_;
+    TraceWriterType *trace_writer_;     // binary trace
+    IInstrTrace *itrace_;               // retired instructions listener
+    int snapshot_evt_total_;            // events reserved by getSnapshotSize
 };
 
 }  // namespace debugger
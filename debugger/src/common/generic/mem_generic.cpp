@@ -21,18 +21,22 @@ namespace debugger {
 
 MemoryGeneric::MemoryGeneric(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("ReadOnly", &readOnly_);
     registerAttribute("DpiClient", &dpiClient_);
     registerAttribute("DpiRoutes", &dpiRoutes_);
 
     readOnly_.make_boolean(false);
     mem_ = NULL;
+    mapped_ = false;
     idpi_ = 0;
 }
 
 MemoryGeneric::~MemoryGeneric() {
-    if (mem_) {
-        delete mem_;
+    if (mapped_) {
+        RISCV_file_unmap(mem_, getLength());
+    } else if (mem_) {
+        delete [] mem_;
     }
 }
 
@@ -68,8 +72,8 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
 
         /** Access to SystemVerilog */
         if (idpi_ && dpiRoutes_[trans->source_idx].to_bool()) {
-            idpi_->axi4_write(off, static_cast<int>(trans->xsize),
-                              trans->wpayload.b64[0]);
+            idpi_->axi4_post_write(off, static_cast<int>(trans->xsize),
+                                   trans->wpayload.b64[0]);
         }
     } else {
         trans->rpayload.b64[0] = 0;
@@ -77,16 +81,8 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
 
         /** Access to SystemVerilog and auto-comparision */
         if (idpi_ && dpiRoutes_[trans->source_idx].to_bool()) {
-            Reg64Type t1;
-            idpi_->axi4_read(off, static_cast<int>(trans->xsize), &t1.val);
-
-            if (t1.val != trans->rpayload.b64[0]) {
-                RISCV_error("DPI diff [%08x]: %016" RV_PRI64 "x != %016" RV_PRI64 "x",
-                    static_cast<unsigned>(off),
-                    t1.val,
-                    trans->rpayload.b64[0]
-                    );
-            }
+            idpi_->axi4_post_read(off, static_cast<int>(trans->xsize),
+                                  trans->rpayload.b64[0]);
         }
     }
 
@@ -99,4 +95,39 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+bool MemoryGeneric::getHostRegion(uint64_t addr, HostMemoryRegionType *r) {
+    if (mem_ == 0 || idpi_) {
+        // Each access should be mirrored into SystemVerilog
+        return false;
+    }
+    r->addr = getBaseAddress();
+    r->size = getLength();
+    r->ptr = mem_;
+    r->writable = !readOnly_.to_bool();
+    return true;
+}
+
+void MemoryGeneric::saveSnapshot(uint8_t *buf) {
+    memcpy(buf, mem_, static_cast<size_t>(getLength()));
+}
+
+/**
+ * Memory content is replaced by the file mapping, so pages are loaded on
+ * the first access. CPUs drop cached host pointers after restore.
+ */
+ESnapshotStatus MemoryGeneric::restoreSnapshot(uint8_t *buf, uint64_t sz) {
+    if (sz != getLength()) {
+        RISCV_error("Wrong snapshot size %" RV_PRI64 "d", sz);
+        return SNAPSHOT_ERROR;
+    }
+    if (mapped_) {
+        RISCV_file_unmap(mem_, getLength());
+    } else if (mem_) {
+        delete [] mem_;
+    }
+    mem_ = buf;
+    mapped_ = true;
+    return SNAPSHOT_MAPPED;
+}
+
 }  // namespace debugger
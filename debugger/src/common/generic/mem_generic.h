@@ -20,12 +20,14 @@
 #include "iclass.h"
 #include "iservice.h"
 #include "coreservices/imemop.h"
+#include "coreservices/isnapshot.h"
 #include <coreservices/idpi.h>
 
 namespace debugger {
 
 class MemoryGeneric : public IService, 
-                      public IMemoryOperation {
+                      public IMemoryOperation,
+                      public ISnapshot {
  public:
     MemoryGeneric(const char *name);
     ~MemoryGeneric();
@@ -35,6 +37,13 @@ class MemoryGeneric : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual bool getHostRegion(uint64_t addr, HostMemoryRegionType *r);
+
+    /** ISnapshot */
+    virtual uint64_t getSnapshotSize() { return getLength(); }
+    virtual bool checkSnapshotSize(uint64_t sz) { return sz == getLength(); }
+    virtual void saveSnapshot(uint8_t *buf);
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz);
 
  protected:
     AttributeType readOnly_;
@@ -44,6 +53,7 @@ class MemoryGeneric : public IService,
     IDpi *idpi_;
 
     uint8_t *mem_;
+    bool mapped_;       // mem_ is the mapped snapshot
 };
 
 }  // namespace debugger
@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "symbol_index.h"
+#include "coreservices/isrccode.h"
+
+namespace debugger {
+
+SymbolIndexType::SymbolIndexType() {
+    items_ = 0;
+    cnt_ = 0;
+    pool_ = 0;
+    htbl_ = 0;
+    hmask_ = 0;
+}
+
+SymbolIndexType::~SymbolIndexType() {
+    clear();
+}
+
+void SymbolIndexType::clear() {
+    if (items_) {
+        delete [] items_;
+        delete [] pool_;
+        delete [] htbl_;
+    }
+    items_ = 0;
+    pool_ = 0;
+    htbl_ = 0;
+    cnt_ = 0;
+    hmask_ = 0;
+}
+
+/** FNV-1a */
+uint32_t SymbolIndexType::hashName(const char *name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h = (h ^ static_cast<uint8_t>(*name++)) * 16777619u;
+    }
+    return h;
+}
+
+const char *SymbolIndexType::symbolName(AttributeType *symb, unsigned *len) {
+    if (!(*symb)[Symbol_Name].is_string()) {
+        *len = 0;
+        return "";
+    }
+    *len = (*symb)[Symbol_Name].size();
+    return (*symb)[Symbol_Name].to_string();
+}
+
+void SymbolIndexType::build(AttributeType *sortByAddr) {
+    unsigned pool_sz = 0;
+    unsigned len;
+    clear();
+    if (sortByAddr->size() == 0) {
+        return;
+    }
+    for (unsigned i = 0; i < sortByAddr->size(); i++) {
+        symbolName(&(*sortByAddr)[i], &len);
+        pool_sz += len + 1;
+    }
+    cnt_ = sortByAddr->size();
+    items_ = new SymbolIndexItemType[cnt_];
+    pool_ = new char[pool_sz];
+
+    // Hash table is at least half empty
+    unsigned htbl_sz = 2;
+    while (htbl_sz < 2 * cnt_) {
+        htbl_sz <<= 1;
+    }
+    hmask_ = htbl_sz - 1;
+    htbl_ = new int[htbl_sz];
+    memset(htbl_, 0xff, htbl_sz * sizeof(int));
+
+    unsigned off = 0;
+    for (unsigned i = 0; i < cnt_; i++) {
+        AttributeType &symb = (*sortByAddr)[i];
+        SymbolIndexItemType *p = &items_[i];
+        const char *name = symbolName(&symb, &len);
+        p->addr = symb[Symbol_Addr].to_uint64();
+        p->size = symb[Symbol_Size].to_uint64();
+        p->name = off;
+        p->hash = hashName(name);
+        memcpy(&pool_[off], name, len + 1);
+        off += len + 1;
+
+        // Duplicated names resolve into the lowest address
+        unsigned h = p->hash & hmask_;
+        while (htbl_[h] >= 0) {
+            SymbolIndexItemType *t = &items_[htbl_[h]];
+            if (t->hash == p->hash && strcmp(&pool_[t->name], name) == 0) {
+                break;
+            }
+            h = (h + 1) & hmask_;
+        }
+        if (htbl_[h] < 0) {
+            htbl_[h] = static_cast<int>(i);
+        }
+    }
+}
+
+int SymbolIndexType::findAddress(uint64_t addr) {
+    if (cnt_ == 0) {
+        return -1;
+    }
+    // Branchless search of the last item with item.addr <= addr
+    const SymbolIndexItemType *base = items_;
+    unsigned n = cnt_;
+    while (n > 1) {
+        unsigned half = n >> 1;
+        base = base[half].addr <= addr ? &base[half] : base;
+        n -= half;
+    }
+    if (addr < base->addr) {
+        return -1;
+    }
+    int idx = static_cast<int>(base - items_);
+    uint64_t end = base->addr + base->size;
+    if (static_cast<unsigned>(idx) < cnt_ - 1) {
+        end = base[1].addr;
+    }
+    return addr < end ? idx : -1;
+}
+
+int SymbolIndexType::findName(const char *name) {
+    if (cnt_ == 0) {
+        return -1;
+    }
+    uint32_t hash = hashName(name);
+    unsigned h = hash & hmask_;
+    while (htbl_[h] >= 0) {
+        SymbolIndexItemType *t = &items_[htbl_[h]];
+        if (t->hash == hash && strcmp(&pool_[t->name], name) == 0) {
+            return htbl_[h];
+        }
+        h = (h + 1) & hmask_;
+    }
+    return -1;
+}
+
+}  // namespace debugger
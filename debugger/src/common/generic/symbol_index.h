@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef __DEBUGGER_SRC_COMMON_GENERIC_SYMBOL_INDEX_H__
+#define __DEBUGGER_SRC_COMMON_GENERIC_SYMBOL_INDEX_H__
+
+#include <api_types.h>
+#include <attribute.h>
+
+namespace debugger {
+
+struct SymbolIndexItemType {
+    uint64_t addr;
+    uint64_t size;
+    uint32_t name;          // offset in the names pool
+    uint32_t hash;
+};
+
+/**
+ * Flat copy of the symbol list used for the lookups from disassembler and
+ * commands: items are sorted by address, names are stored in the single
+ * pool and indexed by the open addressing hash table.
+ */
+class SymbolIndexType {
+ public:
+    SymbolIndexType();
+    ~SymbolIndexType();
+
+    /** Rebuild from the list of ESymbolInfoListItem sorted by address */
+    void build(AttributeType *sortByAddr);
+    void clear();
+
+    /**
+     * Symbol containing the address, symbol ends on the next symbol
+     * address or on its own size for the last one.
+     * @return item index or -1
+     */
+    int findAddress(uint64_t addr);
+
+    /** @return index of the symbol with the lowest address or -1 */
+    int findName(const char *name);
+
+    unsigned size() { return cnt_; }
+    uint64_t address(int idx) { return items_[idx].addr; }
+    const char *name(int idx) { return &pool_[items_[idx].name]; }
+
+ private:
+    static uint32_t hashName(const char *name);
+    static const char *symbolName(AttributeType *symb, unsigned *len);
+
+ private:
+    SymbolIndexItemType *items_;
+    unsigned cnt_;
+    char *pool_;
+    int *htbl_;
+    unsigned hmask_;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_COMMON_GENERIC_SYMBOL_INDEX_H__
@@ -0,0 +1,280 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "trace_writer.h"
+
+namespace debugger {
+
+static const char TRACE_MAGIC[8] = {'R', 'V', 'T', 'R', 'A', 'C', 'E', '1'};
+
+enum ETraceActionType {
+    TraceAction_Register,
+    TraceAction_Read,
+    TraceAction_Write
+};
+
+static int putVarint(uint8_t *buf, uint64_t v) {
+    int cnt = 0;
+    while (v >= 0x80) {
+        buf[cnt++] = static_cast<uint8_t>(v) | 0x80;
+        v >>= 7;
+    }
+    buf[cnt++] = static_cast<uint8_t>(v);
+    return cnt;
+}
+
+TraceWriterType::TraceWriterType() : IThread() {
+    f_ = 0;
+    ring_ = 0;
+    wr_pos_ = 0;
+    rd_pos_ = 0;
+    prev_step_ = 0;
+    prev_pc_ = 0;
+    write_error_ = false;
+}
+
+TraceWriterType::~TraceWriterType() {
+    close();
+}
+
+bool TraceWriterType::open(const char *filename) {
+    f_ = fopen(filename, "wb");
+    if (!f_) {
+        return false;
+    }
+    if (fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), f_)
+        != sizeof(TRACE_MAGIC)) {
+        fclose(f_);
+        f_ = 0;
+        return false;
+    }
+    ring_ = new uint8_t[RING_SIZE];
+    wr_pos_ = 0;
+    rd_pos_ = 0;
+    prev_step_ = 0;
+    prev_pc_ = 0;
+    write_error_ = false;
+    if (!run()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TraceWriterType::close() {
+    if (!f_) {
+        return;
+    }
+    stop();     // writer thread stores the rest of the ring on exit
+    fclose(f_);
+    f_ = 0;
+    delete [] ring_;
+    ring_ = 0;
+}
+
+void TraceWriterType::write(TraceRecordType *rec) {
+    uint8_t buf[16 + 1 + TRACE_ACTIONS_MAX * 24];
+    int len = 0;
+    int64_t dpc = static_cast<int64_t>(rec->pc - prev_pc_);
+
+    if (write_error_) {
+        return;
+    }
+    len += putVarint(&buf[len], rec->step_cnt - prev_step_);
+    len += putVarint(&buf[len], static_cast<uint64_t>((dpc << 1) ^ (dpc >> 63)));
+    memcpy(&buf[len], &rec->instr, 4);
+    len += 4;
+    buf[len++] = static_cast<uint8_t>(rec->action_cnt);
+    for (int i = 0; i < rec->action_cnt; i++) {
+        TraceActionType *pa = &rec->action[i];
+        if (!pa->memop) {
+            buf[len++] = TraceAction_Register;
+            buf[len++] = static_cast<uint8_t>(pa->waddr);
+            len += putVarint(&buf[len], pa->wdata);
+        } else {
+            buf[len++] = pa->memop_write ? TraceAction_Write : TraceAction_Read;
+            len += putVarint(&buf[len], pa->memop_addr);
+            buf[len++] = static_cast<uint8_t>(pa->memop_size);
+            len += putVarint(&buf[len], pa->memop_data.val);
+        }
+    }
+    prev_step_ = rec->step_cnt;
+    prev_pc_ = rec->pc;
+
+    // Wait for the writer thread if the ring is full, drop the record
+    // if the thread doesn't consume data anymore
+    while (RING_SIZE - (wr_pos_ - rd_pos_) < static_cast<uint64_t>(len)) {
+        if (write_error_ || !isEnabled()) {
+            return;
+        }
+        RISCV_sleep_ms(1);
+    }
+    uint64_t off = wr_pos_ & (RING_SIZE - 1);
+    uint64_t sz1 = RING_SIZE - off;
+    if (sz1 >= static_cast<uint64_t>(len)) {
+        memcpy(&ring_[off], buf, len);
+    } else {
+        memcpy(&ring_[off], buf, sz1);
+        memcpy(ring_, &buf[sz1], len - sz1);
+    }
+    RISCV_memory_barrier();
+    wr_pos_ += len;
+}
+
+void TraceWriterType::busyLoop() {
+    uint64_t wr, off, len;
+    int idle_ms = 0;
+    while (1) {
+        wr = wr_pos_;
+        RISCV_memory_barrier();
+        len = wr - rd_pos_;
+        if (len == 0) {
+            if (!isEnabled()) {
+                break;
+            }
+            RISCV_sleep_ms(1);
+            continue;
+        }
+        // Accumulate large chunk but do not hold the tail when CPU is halted
+        if (isEnabled() && len < WRITE_CHUNK && idle_ms < FLUSH_TIMEOUT_MS) {
+            RISCV_sleep_ms(1);
+            idle_ms++;
+            continue;
+        }
+        idle_ms = 0;
+        off = rd_pos_ & (RING_SIZE - 1);
+        if (off + len > RING_SIZE) {
+            len = RING_SIZE - off;
+        }
+        if (fwrite(&ring_[off], 1, static_cast<size_t>(len), f_)
+            != static_cast<size_t>(len)) {
+            RISCV_printf(NULL, LOG_ERROR,
+                         "Trace file write error, tracing stopped");
+            write_error_ = true;
+            break;
+        }
+        RISCV_memory_barrier();
+        rd_pos_ += len;
+        if (wr_pos_ == rd_pos_) {
+            fflush(f_);
+        }
+    }
+    fflush(f_);
+}
+
+
+TraceReaderType::TraceReaderType() {
+    f_ = 0;
+    regs_total_ = 0;
+    prev_step_ = 0;
+    prev_pc_ = 0;
+}
+
+TraceReaderType::~TraceReaderType() {
+    close();
+}
+
+bool TraceReaderType::open(const char *filename, int regs_total) {
+    char magic[sizeof(TRACE_MAGIC)];
+    regs_total_ = regs_total;
+    f_ = fopen(filename, "rb");
+    if (!f_) {
+        return false;
+    }
+    if (fread(magic, 1, sizeof(magic), f_) != sizeof(magic)
+        || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+        close();
+        return false;
+    }
+    prev_step_ = 0;
+    prev_pc_ = 0;
+    return true;
+}
+
+void TraceReaderType::close() {
+    if (f_) {
+        fclose(f_);
+        f_ = 0;
+    }
+}
+
+bool TraceReaderType::readVarint(uint64_t *v) {
+    int c;
+    int shift = 0;
+    *v = 0;
+    do {
+        if ((c = fgetc(f_)) == EOF || shift > 63) {
+            return false;
+        }
+        *v |= static_cast<uint64_t>(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return true;
+}
+
+bool TraceReaderType::read(TraceRecordType *rec) {
+    uint64_t dstep, zpc, t1;
+    int64_t dpc;
+    int c;
+    if (!f_ || !readVarint(&dstep) || !readVarint(&zpc)) {
+        return false;
+    }
+    dpc = static_cast<int64_t>(zpc >> 1) ^ -static_cast<int64_t>(zpc & 1);
+    rec->step_cnt = prev_step_ + dstep;
+    rec->pc = prev_pc_ + static_cast<uint64_t>(dpc);
+    prev_step_ = rec->step_cnt;
+    prev_pc_ = rec->pc;
+    if (fread(&rec->instr, 1, 4, f_) != 4 || (c = fgetc(f_)) == EOF) {
+        return false;
+    }
+    if (c > TRACE_ACTIONS_MAX) {
+        RISCV_printf(NULL, LOG_ERROR, "Trace record at pc=%08" RV_PRI64 "x: "
+                     "%d actions", rec->pc, c);
+        return false;
+    }
+    rec->action_cnt = c;
+    for (int i = 0; i < rec->action_cnt; i++) {
+        TraceActionType *pa = &rec->action[i];
+        c = fgetc(f_);
+        if (c == TraceAction_Register) {
+            pa->memop = false;
+            if ((c = fgetc(f_)) == EOF || !readVarint(&pa->wdata)) {
+                return false;
+            }
+            if (c >= regs_total_) {
+                RISCV_printf(NULL, LOG_ERROR, "Trace record at pc=%08"
+                             RV_PRI64 "x: register %d", rec->pc, c);
+                return false;
+            }
+            pa->waddr = c;
+        } else if (c == TraceAction_Read || c == TraceAction_Write) {
+            pa->memop = true;
+            pa->memop_write = c == TraceAction_Write ? 1 : 0;
+            if (!readVarint(&pa->memop_addr) || (c = fgetc(f_)) == EOF
+                || !readVarint(&t1)) {
+                return false;
+            }
+            pa->memop_size = c;
+            pa->memop_data.val = t1;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace debugger
@@ -0,0 +1,92 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_COMMON_GENERIC_TRACE_WRITER_H__
+#define __DEBUGGER_SRC_COMMON_GENERIC_TRACE_WRITER_H__
+
+#include <stdio.h>
+#include <api_types.h>
+#include "coreservices/ithread.h"
+#include "coreservices/iinstrtrace.h"
+
+namespace debugger {
+
+/**
+ * Binary trace file:
+ *      header:  "RVTRACE1"
+ *      record:  step delta (varint), zigzag pc delta (varint),
+ *               instr (4 bytes), actions count (1 byte), actions
+ *      action:  type (1 byte: 0=register, 1=read, 2=write)
+ *               register: index (1 byte), value (varint)
+ *               memop:    address (varint), size (1 byte), value (varint)
+ *
+ * Records are encoded in the CPU thread into the single producer/single
+ * consumer ring buffer and stored into file by the writer thread with
+ * large sequential writes.
+ */
+class TraceWriterType : public IThread {
+ public:
+    TraceWriterType();
+    virtual ~TraceWriterType();
+
+    bool open(const char *filename);
+    void close();
+    void write(TraceRecordType *rec);
+
+ protected:
+    /** IThread interface */
+    virtual void busyLoop();
+
+ private:
+    static const int RING_BITS = 23;             // 8 MB
+    static const uint64_t RING_SIZE = 1ull << RING_BITS;
+    static const uint64_t WRITE_CHUNK = 1ull << 16;
+    static const int FLUSH_TIMEOUT_MS = 100;
+
+    FILE *f_;
+    uint8_t *ring_;
+    volatile uint64_t wr_pos_;
+    volatile uint64_t rd_pos_;
+    uint64_t prev_step_;
+    uint64_t prev_pc_;
+    volatile bool write_error_;     // writer thread failed and exited
+};
+
+/** Sequential reader of the binary trace used by the offline rendering */
+class TraceReaderType {
+ public:
+    TraceReaderType();
+    ~TraceReaderType();
+
+    /** Register indexes of records are checked against regs_total */
+    bool open(const char *filename, int regs_total);
+    void close();
+    /** Returns false at the end of file or on corrupted record */
+    bool read(TraceRecordType *rec);
+
+ private:
+    bool readVarint(uint64_t *v);
+
+ private:
+    FILE *f_;
+    int regs_total_;
+    uint64_t prev_step_;
+    uint64_t prev_pc_;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_COMMON_GENERIC_TRACE_WRITER_H__
@@ -149,6 +149,7 @@ class IService : public IFace {
     }
 
     virtual const char *getObjName() { return obj_name_.to_string(); }
+    int getLogLevel() { return logLevel_.to_int(); }
 
     virtual AttributeType getConfiguration() {
         AttributeType ret(Attr_Dict);
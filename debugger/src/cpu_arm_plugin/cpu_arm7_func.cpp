@@ -25,6 +25,8 @@ CpuCortex_Functional::CpuCortex_Functional(const char *name) :
     registerInterface(static_cast<ICpuArm *>(this));
     registerAttribute("VectorTable", &vectorTable_);
     registerAttribute("DefaultMode", &defaultMode_);
+    registerAttribute("IrqController", &irqController_);
+    iirqctrl_ = 0;
     p_psr_ = reinterpret_cast<ProgramStatusRegsiterType *>(
             &R[Reg_cpsr]);
     PC_ = &R[Reg_pc];   // redefine location of PC register in bank
@@ -55,6 +57,16 @@ void CpuCortex_Functional::postinitService() {
     if (defaultMode_.is_equal("Thumb")) {
         setInstrMode(THUMB_mode);
     }
+
+    if (irqController_.is_string() && irqController_.size()) {
+        iirqctrl_ = static_cast<IIrqController *>(
+            RISCV_get_service_iface(irqController_.to_string(),
+                                    IFACE_IRQ_CONTROLLER));
+        if (!iirqctrl_) {
+            RISCV_error("Can't find IIrqController interface %s",
+                        irqController_.to_string());
+        }
+    }
 }
 
 void CpuCortex_Functional::predeleteService() {
@@ -96,7 +108,7 @@ void CpuCortex_Functional::handleTrap() {
         t1.val = br_control_.getValue().val;
         if (t1.bits.trap_on_break == 0) {
             sw_breakpoint_ = true;
-            interrupt_pending_[0] &= ~(1ull << Interrupt_SoftwareIdx);
+            clearPending(0, 1ull << Interrupt_SoftwareIdx);
             setNPC(getPC());
             halt("SWI Breakpoint");
             return;
@@ -115,25 +127,23 @@ void CpuCortex_Functional::handleTrap() {
     }
 
     int irq_idx;
+    uint64_t pending;
     for (int i = 0; i < 2; i++) {
-        if (interrupt_pending_[i] == 0) {
+        pending = interrupt_pending_[i];
+        if (pending == 0) {
             continue;
         }
 
         for (int n = 0; n < 64; n++) {
-            if ((interrupt_pending_[i] & (1ull << n)) == 0) {
+            if ((pending & (1ull << n)) == 0) {
                 continue;
             }
+            // External interrupts from NVIC are placed after 16 exceptions
             irq_idx = 64*i + n;
-            if (irq_idx < 16) {
-                enterException(irq_idx);
-            } else {
-                RISCV_error("Interrupts from NVIC not supported %d", irq_idx);
-            }
+            enterException(irq_idx);
         }
-        interrupt_pending_[i] = 0;
+        clearPending(i, pending);
     }
-    interrupt_pending_[0] = 0;
 }
 
 void CpuCortex_Functional::enterException(int idx) {
@@ -179,6 +189,11 @@ void CpuCortex_Functional::enterException(int idx) {
     setReg(Reg_sp, static_cast<uint32_t>(trans_.addr));
     setReg(Reg_lr, 0xFFFFFFF9);     // EXC_RETURN
 
+    // Pending state is cleared when the exception becomes active
+    if (iirqctrl_) {
+        iirqctrl_->acknowledgeInterrupt(idx);
+    }
+
     // Load vector address:
     trans_.action = MemAction_Read;
     trans_.addr = 4*idx;
@@ -269,6 +284,20 @@ void CpuCortex_Functional::reset(IFace *isource) {
     estate_ = CORE_Halted;
 }
 
+void CpuCortex_Functional::saveSnapshotExt(uint8_t *buf) {
+    buf[0] = ITBlockEnabled ? 1 : 0;
+    buf[1] = static_cast<uint8_t>(ITBlockCondition_);
+    buf[2] = static_cast<uint8_t>(ITBlockBaseCond_);
+    buf[3] = static_cast<uint8_t>(ITBlockMask_);
+}
+
+void CpuCortex_Functional::restoreSnapshotExt(uint8_t *buf) {
+    ITBlockEnabled = buf[0] != 0;
+    ITBlockCondition_ = buf[1];
+    ITBlockBaseCond_ = buf[2];
+    ITBlockMask_ = buf[3];
+}
+
 void CpuCortex_Functional::StartITBlock(uint32_t firstcond, uint32_t mask) {
     // bf0c  : ite eq => eq ne
     // bf14  : ite ne => ne eq
@@ -343,24 +372,25 @@ void CpuCortex_Functional::generateIllegalOpcode() {
     RISCV_error("Illegal instruction at 0x%08" RV_PRI64 "x", getPC());
 }
 
-void CpuCortex_Functional::traceOutput() {
+void CpuCortex_Functional::traceText(TraceRecordType *rec,
+                                     std::ofstream *out) {
     char tstr[1024];
     trace_action_type *pa;
 
-    disasm_thumb(trace_data_.pc,
-                 trace_data_.instr,
-                 trace_data_.disasm,
-                 sizeof(trace_data_.disasm));
+    disasm_thumb(rec->pc,
+                 rec->instr,
+                 rec->disasm,
+                 sizeof(rec->disasm));
 
     RISCV_sprintf(tstr, sizeof(tstr),
         "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \n",
-            trace_data_.step_cnt - 1,
-            trace_data_.pc,
-            trace_data_.disasm);
-    (*trace_file_) << tstr;
+            rec->step_cnt - 1,
+            rec->pc,
+            rec->disasm);
+    (*out) << tstr;
 
-    for (int i = 0; i < trace_data_.action_cnt; i++) {
-        pa = &trace_data_.action[i];
+    for (int i = 0; i < rec->action_cnt; i++) {
+        pa = &rec->action[i];
         if (!pa->memop) {
             RISCV_sprintf(tstr, sizeof(tstr),
                 "%21s %10s <= %08x\n",
@@ -380,27 +410,29 @@ void CpuCortex_Functional::traceOutput() {
                     pa->memop_addr,
                     pa->memop_data.buf32[0]);
         }
-        (*trace_file_) << tstr;
+        (*out) << tstr;
     }
-
-    trace_file_->flush();
 }
 
 void CpuCortex_Functional::raiseSignal(int idx) {
     if (idx >= 128) {
         RISCV_error("Raise unsupported signal %d", idx);
+        return;
     }
     RISCV_debug("Request Interrupt %d", idx);
-    interrupt_pending_[idx >> 6] |= (1ull << (idx & 0x3F));
+    setPending(idx >> 6, 1ull << (idx & 0x3F));
 }
 
 void CpuCortex_Functional::lowerSignal(int idx) {
-    interrupt_pending_[idx >> 6] &= ~(1ull << (idx & 0x3F));
-    RISCV_error("Lower unsupported signal %d", idx);
+    if (idx >= 128) {
+        RISCV_error("Lower unsupported signal %d", idx);
+        return;
+    }
+    clearPending(idx >> 6, 1ull << (idx & 0x3F));
 }
 
 void CpuCortex_Functional::raiseSoftwareIrq() {
-    interrupt_pending_[0] |= (1ull << Interrupt_SoftwareIdx);
+    setPending(0, 1ull << Interrupt_SoftwareIdx);
 }
 
 }  // namespace debugger
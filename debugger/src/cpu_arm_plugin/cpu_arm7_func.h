@@ -21,6 +21,7 @@
 #include "instructions.h"
 #include "generic/cpu_generic.h"
 #include "coreservices/icpuarm.h"
+#include "coreservices/iirqctrl.h"
 #include "cmds/cmd_br_arm7.h"
 #include "cmds/cmd_reg_arm7.h"
 #include "cmds/cmd_regs_arm7.h"
@@ -49,6 +50,12 @@ class CpuCortex_Functional : public CpuGeneric,
     virtual void raiseSoftwareIrq();
     virtual uint64_t getIrqAddress(int idx) { return 0; }
 
+    /** CpuGeneric common methods */
+    virtual void traceText(TraceRecordType *rec, std::ofstream *out) override;
+    virtual int traceRegsTotal() override {
+        return static_cast<int>(sizeof(IREGS_NAMES) / sizeof(IREGS_NAMES[0]));
+    }
+
     /** ICpuArm */
     virtual void setInstrMode(EInstructionModes mode) {
         const uint32_t MODE[InstrModes_Total] = {0u, 1u};
@@ -92,7 +99,10 @@ class CpuCortex_Functional : public CpuGeneric,
     virtual void generateIllegalOpcode();
     virtual void handleTrap();
     virtual void trackContextEnd() override;
-    virtual void traceOutput() override;
+    /** IT block state is stored into snapshot */
+    virtual uint64_t getSnapshotExtSize() override { return 4; }
+    virtual void saveSnapshotExt(uint8_t *buf) override;
+    virtual void restoreSnapshotExt(uint8_t *buf) override;
     
     void addArm7tmdiIsa();
     void addThumb2Isa();
@@ -103,6 +113,8 @@ class CpuCortex_Functional : public CpuGeneric,
     AttributeType defaultMode_;
     AttributeType vendorID_;
     AttributeType vectorTable_;
+    AttributeType irqController_;
+    IIrqController *iirqctrl_;
 
     static const int INSTR_HASH_TABLE_SIZE = 1 << 4;
     AttributeType listInstr_[INSTR_HASH_TABLE_SIZE];
@@ -65,6 +65,7 @@ void ArmSourceService::addFileSymbol(const char *name, uint64_t addr,
 
     symbolListSortByAddr_.add_to_list(&symb);
     symbolListSortByAddr_.sort(Symbol_Addr);
+    symbolIndex_.build(&symbolListSortByAddr_);
 }
 
 void ArmSourceService::addFunctionSymbol(const char *name,
@@ -80,6 +81,7 @@ void ArmSourceService::addDataSymbol(const char *name, uint64_t addr,
 void ArmSourceService::clearSymbols() {
     symbolListSortByName_.make_list(0);
     symbolListSortByAddr_.make_list(0);
+    symbolIndex_.clear();
 }
 
 void ArmSourceService::addSymbols(AttributeType *list) {
@@ -90,81 +92,28 @@ void ArmSourceService::addSymbols(AttributeType *list) {
     }
     symbolListSortByName_.sort(Symbol_Name);
     symbolListSortByAddr_.sort(Symbol_Addr);
+    symbolIndex_.build(&symbolListSortByAddr_);
 }
 
 void ArmSourceService::addressToSymbol(uint64_t addr, AttributeType *info) {
-    uint64_t sadr, send;
-    int sz = static_cast<int>(symbolListSortByAddr_.size());
-
+    int idx = symbolIndex_.findAddress(addr);
     info->make_list(SymbInfo_Total);
-    (*info)[SymbInfo_Name].make_string("");
-    (*info)[SymbInfo_Address].make_uint64(0);
-    if (sz == 0) {
-        return;
-    }
-    sadr = symbolListSortByAddr_[0u][Symbol_Addr].to_uint64();
-    if (addr < sadr) {
+    if (idx < 0) {
+        (*info)[SymbInfo_Name].make_string("");
+        (*info)[SymbInfo_Address].make_uint64(0);
         return;
     }
-
-    bool search = true;
-    int dist, pos = sz / 2;
-    dist = pos;
-    while (search) {
-        AttributeType &symb = symbolListSortByAddr_[pos];
-        sadr = symb[Symbol_Addr].to_uint64();
-        if (pos < static_cast<int>(symbolListSortByAddr_.size()) - 1) {
-            send = symbolListSortByAddr_[pos + 1][Symbol_Addr].to_uint64();
-        } else {
-            send = sadr + symb[Symbol_Size].to_uint64();
-        }
-        if (sadr <= addr && addr < send) {
-            (*info)[SymbInfo_Name] = symb[Symbol_Name];
-            (*info)[SymbInfo_Address].make_uint64(addr - sadr);
-            return;
-        }
-        
-        if (addr < sadr) {
-            if (dist == 0 || pos == 0) {
-                search = false;
-            } else if (dist == 1) {
-                dist = 0;
-                pos--;
-            } else {
-                int incr = dist / 2;
-                pos -= incr;
-                dist = (dist / 2) + (dist & 0x1);
-                if (pos < 0) {
-                    pos = 0;
-                }
-            }
-        } else {
-            if (dist == 0 || pos == (sz - 1)) {
-                search = false;
-            } else if (dist == 1) {
-                dist = 0;
-                pos++;
-            } else {
-                int incr = dist / 2;
-                pos += incr;
-                dist = (dist / 2) + (dist & 0x1);
-                if (pos >= sz) {
-                    pos = sz - 1;
-                }
-            }
-        }
-    }
+    (*info)[SymbInfo_Name].make_string(symbolIndex_.name(idx));
+    (*info)[SymbInfo_Address].make_uint64(addr - symbolIndex_.address(idx));
 }
 
 int ArmSourceService::symbol2Address(const char *name, uint64_t *addr) {
-    for (unsigned i = 0; i < symbolListSortByName_.size(); i++) {
-        AttributeType &item = symbolListSortByName_[i];
-        if (item[Symbol_Name].is_equal(name)) {
-            *addr = item[Symbol_Addr].to_uint64();
-            return 0;
-        }
+    int idx = symbolIndex_.findName(name);
+    if (idx < 0) {
+        return -1;
     }
-    return -1;
+    *addr = symbolIndex_.address(idx);
+    return 0;
 }
 
 void ArmSourceService::registerBreakpoint(uint64_t addr, uint64_t flags,
@@ -20,6 +20,7 @@
 #include <iclass.h>
 #include <iservice.h>
 #include "coreservices/isrccode.h"
+#include "generic/symbol_index.h"
 #include "coreservices/icpuarm.h"
 
 namespace debugger {
@@ -112,6 +113,7 @@ class ArmSourceService : public IService,
     AttributeType brList_;
     AttributeType symbolListSortByName_;
     AttributeType symbolListSortByAddr_;
+    SymbolIndexType symbolIndex_;
 
     ICpuArm *iarm_;
 };
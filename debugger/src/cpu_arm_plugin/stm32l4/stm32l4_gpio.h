@@ -49,7 +49,6 @@ class STM32L4_GPIO : public RegMemBankGeneric,
     void modifyOutput(uint32_t v);
 
  protected:
-    int getLogLevel() { return logLevel_.to_int(); }
     void setLogLevel(int level) { return logLevel_.make_int64(level); }
 
  protected:
@@ -21,6 +21,11 @@ namespace debugger {
 
 STM32L4_NVIC::STM32L4_NVIC(const char *name) : IService(name),
     NVIC_STIR(this, "NVIC_STIR", 0xF00) {
+    registerInterface(static_cast<IIrqController *>(this));
+    registerAttribute("CPU", &cpu_);
+    icpu_ = 0;
+    RISCV_mutex_init(&mutex_);
+
     char tstr[64];
     for (int i = 0; i < 8; i++) {
         RISCV_sprintf(tstr, sizeof(tstr), "NVIC_ISER%d", i);
@@ -55,6 +60,7 @@ STM32L4_NVIC::~STM32L4_NVIC() {
     for (int i = 0; i < 61; i++) {
         delete NVIC_IPRx[i];
     }
+    RISCV_mutex_destroy(&mutex_);
 }
 
 void STM32L4_NVIC::postinitService() {
@@ -69,28 +75,97 @@ void STM32L4_NVIC::postinitService() {
     for (int i = 0; i < 61; i++) {
         NVIC_IPRx[i]->setBaseAddress(baseaddr + 0x400 + 4*i);
     }
+
+    if (!cpu_.is_string()) {
+        // Registers only model without connection to the core
+        return;
+    }
+    icpu_ = static_cast<ICpuGeneric *>(
+        RISCV_get_service_iface(cpu_.to_string(), IFACE_CPU_GENERIC));
+    if (!icpu_) {
+        RISCV_error("Can't find ICpuGeneric interface %s", cpu_.to_string());
+    }
 }
 
 void STM32L4_NVIC::enableInterrupt(int idx) {
     int regidx = idx >> 5;
     int regoff = idx & 0x1F;
-    uint32_t t = NVIC_IABRx[regidx]->getValue().val;
 
     // 29  TIM3_IRQn
     // 54  TIM6_DAC_IRQn
     RISCV_info("Enabling Interrupt %d", idx);
+    RISCV_mutex_lock(&mutex_);
+    uint32_t t = NVIC_ISERx[regidx]->getValue().val;
     t |= (1ul << regoff);
-    NVIC_IABRx[regidx]->setValue(t);
+    NVIC_ISERx[regidx]->setValue(t);
+    NVIC_ICERx[regidx]->setValue(t);
+    updateInterruptLine(idx);
+    RISCV_mutex_unlock(&mutex_);
 }
 
 void STM32L4_NVIC::disableInterrupt(int idx) {
     int regidx = idx >> 5;
     int regoff = idx & 0x1F;
-    uint32_t t = NVIC_IABRx[regidx]->getValue().val;
 
     RISCV_info("Disabling Interrupt %d", idx);
+    RISCV_mutex_lock(&mutex_);
+    uint32_t t = NVIC_ISERx[regidx]->getValue().val;
+    t &= ~(1ul << regoff);
+    NVIC_ISERx[regidx]->setValue(t);
+    NVIC_ICERx[regidx]->setValue(t);
+    updateInterruptLine(idx);
+    RISCV_mutex_unlock(&mutex_);
+}
+
+void STM32L4_NVIC::setPendingInterrupt(int idx) {
+    int regidx = idx >> 5;
+    int regoff = idx & 0x1F;
+
+    RISCV_mutex_lock(&mutex_);
+    uint32_t t = NVIC_ISPRx[regidx]->getValue().val;
+    t |= (1ul << regoff);
+    NVIC_ISPRx[regidx]->setValue(t);
+    NVIC_ICPRx[regidx]->setValue(t);
+    updateInterruptLine(idx);
+    RISCV_mutex_unlock(&mutex_);
+}
+
+void STM32L4_NVIC::clearPendingInterrupt(int idx) {
+    int regidx = idx >> 5;
+    int regoff = idx & 0x1F;
+
+    RISCV_mutex_lock(&mutex_);
+    uint32_t t = NVIC_ISPRx[regidx]->getValue().val;
     t &= ~(1ul << regoff);
-    NVIC_IABRx[regidx]->setValue(t);
+    NVIC_ISPRx[regidx]->setValue(t);
+    NVIC_ICPRx[regidx]->setValue(t);
+    updateInterruptLine(idx);
+    RISCV_mutex_unlock(&mutex_);
+}
+
+void STM32L4_NVIC::acknowledgeInterrupt(int idx) {
+    if (idx >= 16 && idx < 16 + 240) {
+        clearPendingInterrupt(idx - 16);
+    }
+}
+
+/**
+ * External interrupts follow the 16 system exceptions in the vector table.
+ * Line is recomputed only on register or peripheral events so no per-step
+ * polling is needed.
+ */
+void STM32L4_NVIC::updateInterruptLine(int idx) {
+    int regidx = idx >> 5;
+    uint32_t mask = 1ul << (idx & 0x1F);
+    if (!icpu_ || (16 + idx) >= 128) {
+        return;
+    }
+    if (NVIC_ISERx[regidx]->getValue().val
+        & NVIC_ISPRx[regidx]->getValue().val & mask) {
+        icpu_->raiseSignal(16 + idx);
+    } else {
+        icpu_->lowerSignal(16 + idx);
+    }
 }
 
 
@@ -101,7 +176,7 @@ uint32_t STM32L4_NVIC::ISER_TYPE::aboutToWrite(uint32_t cur_val) {
             p->enableInterrupt(startidx_ + i);
         }
     }
-    return cur_val;
+    return getValue().val;
 }
 
 uint32_t STM32L4_NVIC::ICER_TYPE::aboutToWrite(uint32_t cur_val) {
@@ -111,15 +186,27 @@ uint32_t STM32L4_NVIC::ICER_TYPE::aboutToWrite(uint32_t cur_val) {
             p->disableInterrupt(startidx_ + i);
         }
     }
-    return cur_val;
+    return getValue().val;
 }
 
 uint32_t STM32L4_NVIC::ISPR_TYPE::aboutToWrite(uint32_t cur_val) {
-    return cur_val;
+    STM32L4_NVIC *p = static_cast<STM32L4_NVIC *>(parent_);
+    for (int i = 0; i < 32; i++) {
+        if (cur_val & (1 << i)) {
+            p->setPendingInterrupt(startidx_ + i);
+        }
+    }
+    return getValue().val;
 }
 
 uint32_t STM32L4_NVIC::ICPR_TYPE::aboutToWrite(uint32_t cur_val) {
-    return cur_val;
+    STM32L4_NVIC *p = static_cast<STM32L4_NVIC *>(parent_);
+    for (int i = 0; i < 32; i++) {
+        if (cur_val & (1 << i)) {
+            p->clearPendingInterrupt(startidx_ + i);
+        }
+    }
+    return getValue().val;
 }
 
 uint32_t STM32L4_NVIC::IABR_TYPE::aboutToWrite(uint32_t cur_val) {
@@ -20,12 +20,15 @@
 #include "iclass.h"
 #include "iservice.h"
 #include "coreservices/imemop.h"
+#include "coreservices/icpugen.h"
+#include "coreservices/iirqctrl.h"
 #include "generic/mapreg.h"
 #include "generic/rmembank_gen1.h"
 
 namespace debugger {
 
-class STM32L4_NVIC : public IService {
+class STM32L4_NVIC : public IService,
+                     public IIrqController {
  public:
     explicit STM32L4_NVIC(const char *name);
     virtual ~STM32L4_NVIC();
@@ -33,9 +36,22 @@ class STM32L4_NVIC : public IService {
     /** IService interface */
     virtual void postinitService() override;
 
+    /** IIrqController: external interrupts follow 16 system exceptions */
+    virtual void acknowledgeInterrupt(int idx) override;
+
     /** Common methods */
     void enableInterrupt(int idx);
     void disableInterrupt(int idx);
+    void setPendingInterrupt(int idx);
+    void clearPendingInterrupt(int idx);
+
+ protected:
+    /**
+     * Signal CPU when enable or pending state of the line was changed.
+     * Called with mutex_ locked: pending state is changed by the CPU thread
+     * on exception entry and by the peripherals.
+     */
+    void updateInterruptLine(int idx);
 
  protected:
     class ONEBITS_TYPE : public MappedReg32Type {
@@ -143,6 +159,10 @@ class STM32L4_NVIC : public IService {
     };
 
 
+    AttributeType cpu_;
+    ICpuGeneric *icpu_;
+    mutex_def mutex_;
+
     ISER_TYPE *NVIC_ISERx[8];     // interrupt 0 to 239
     ICER_TYPE *NVIC_ICERx[8];     // interrupt 0 to 239
     ISPR_TYPE *NVIC_ISPRx[8];     // interrupt 0 to 239
@@ -24,6 +24,7 @@ STM32L4_SysTick::STM32L4_SysTick(const char *name) : IService(name),
     STK_LOAD(this, "STK_LOAD", 0x04),
     STK_VAL(this, "STK_VAL", 0x08),
     STK_CALIB(this, "STK_CALIB", 0x0C) {
+    registerInterface(static_cast<IClockListener *>(this));
     registerAttribute("CPU", &cpu_);
     registerAttribute("IrqLine", &irqLine_);
 
@@ -31,6 +31,7 @@ CpuRiver_Functional::CpuRiver_Functional(const char *name) :
     registerAttribute("ListExtISA", &listExtISA_);
     registerAttribute("VectorTable", &vectorTable_);
     registerAttribute("ExceptionTable", &exceptionTable_);
+    memset(mpu_, 0, sizeof(mpu_));
 }
 
 CpuRiver_Functional::~CpuRiver_Functional() {
@@ -122,12 +123,13 @@ void CpuRiver_Functional::handleTrap() {
         mstatus.bits.MIE == 0 && cur_prv_level == PRV_M) {
         return;
     }
-    if (mcause.value == EXCEPTION_Breakpoint) {
+    if ((interrupt_pending_[0] & exception_mask)
+        && mcause.value == EXCEPTION_Breakpoint) {
         DsuMapType::udbg_type::debug_region_type::breakpoint_control_reg t1;
         t1.val = br_control_.getValue().val;
         if (t1.bits.trap_on_break == 0) {
             sw_breakpoint_ = true;
-            interrupt_pending_[0] &= ~(1ull << EXCEPTION_Breakpoint);
+            clearPending(0, 1ull << EXCEPTION_Breakpoint);
             setNPC(getPC());
             halt("EBREAK Breakpoint");
             return;
@@ -150,11 +152,22 @@ void CpuRiver_Functional::handleTrap() {
         int entry_idx = 2*static_cast<int>(mcause.value) + 1;
         uint64_t trap = exceptionTable_[entry_idx].to_uint64();
         setNPC(trap);
+        clearPending(0, exception_mask);
     } else {
-        // Software interrupt handled after instruction was executed
+        // Software interrupt handled after instruction was executed.
+        // Interrupt lines are level sensitive and stay pending until the
+        // source lowers them, so the cause is latched here on trap entry.
+        int irq_idx = INTERRUPT_USoftware;
+        while (irq_idx < INTERRUPT_MExternal
+            && !(interrupt_pending_[0] & (1ull << irq_idx))) {
+            irq_idx++;
+        }
+        mcause.value     = 0;
+        mcause.bits.irq  = 1;
+        mcause.bits.code = irq_idx - INTERRUPT_USoftware;
+        portCSR_.write(CSR_mcause, mcause.value);
         setNPC(portCSR_.read(CSR_mtvec).val);
     }
-    interrupt_pending_[0] = 0;
 }
 
 void CpuRiver_Functional::reset(IFace *isource) {
@@ -165,6 +178,7 @@ void CpuRiver_Functional::reset(IFace *isource) {
     portCSR_.write(CSR_mimplementationid, implementationid_.to_uint64());
     portCSR_.write(CSR_mhartid, hartid_.to_uint64());
     portCSR_.write(CSR_mtvec, vectorTable_.to_uint64());
+    memset(mpu_, 0, sizeof(mpu_));
 
     cur_prv_level = PRV_M;           // Current privilege level
 }
@@ -207,23 +221,32 @@ void CpuRiver_Functional::trackContextStart() {
     }
 }
 
-void CpuRiver_Functional::traceOutput() {
+void CpuRiver_Functional::saveSnapshotExt(uint8_t *buf) {
+    memcpy(buf, portCSR_.getp(), portCSR_.getLength());
+}
+
+void CpuRiver_Functional::restoreSnapshotExt(uint8_t *buf) {
+    memcpy(portCSR_.getp(), buf, portCSR_.getLength());
+}
+
+void CpuRiver_Functional::traceText(TraceRecordType *rec,
+                                    std::ofstream *out) {
     char tstr[1024];
 
-    riscv_disassembler(trace_data_.instr,
-                       trace_data_.disasm,
-                       sizeof(trace_data_.disasm));
+    riscv_disassembler(rec->instr,
+                       rec->disasm,
+                       sizeof(rec->disasm));
 
     RISCV_sprintf(tstr, sizeof(tstr),
         "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \n",
-            trace_data_.step_cnt - 1,
-            trace_data_.pc,
-            trace_data_.disasm);
-    (*trace_file_) << tstr;
+            rec->step_cnt - 1,
+            rec->pc,
+            rec->disasm);
+    (*out) << tstr;
 
 
-    for (int i = 0; i < trace_data_.action_cnt; i++) {
-        trace_action_type *pa = &trace_data_.action[i];
+    for (int i = 0; i < rec->action_cnt; i++) {
+        trace_action_type *pa = &rec->action[i];
         if (!pa->memop) {
             RISCV_sprintf(tstr, sizeof(tstr),
                 "%20s %10s <= %016" RV_PRI64 "x\n",
@@ -243,10 +266,8 @@ void CpuRiver_Functional::traceOutput() {
                     pa->memop_addr,
                     pa->memop_data.val);
         }
-        (*trace_file_) << tstr;
+        (*out) << tstr;
     }
-
-    trace_file_->flush();
 }
 
 void CpuRiver_Functional::raiseSignal(int idx) {
@@ -259,15 +280,11 @@ void CpuRiver_Functional::raiseSignal(int idx) {
         if ((interrupt_pending_[0] & (1ull << EXCEPTION_InstrFault)) == 0) {
             // Wrong instruction address can generate others exceptions, ignore them
             portCSR_.write(CSR_mcause, cause.value);
-            interrupt_pending_[idx >> 6] |= 1LL << (idx & 0x3F);
+            setPending(0, 1ull << idx);
         }
     } else if (idx < SIGNAL_HardReset) {
-        csr_mcause_type cause;
-        cause.value     = 0;
-        cause.bits.irq  = 1;
-        cause.bits.code = idx - INTERRUPT_USoftware;
-        portCSR_.write(CSR_mcause, cause.value);
-        interrupt_pending_[idx >> 6] |= 1LL << (idx & 0x3F);
+        // May be called from the device threads
+        setPending(0, 1ull << idx);
     } else if (idx == SIGNAL_HardReset) {
     } else {
         RISCV_error("Raise unsupported signal %d", idx);
@@ -277,7 +294,7 @@ void CpuRiver_Functional::raiseSignal(int idx) {
 void CpuRiver_Functional::lowerSignal(int idx) {
     if (idx == SIGNAL_HardReset) {
     } else if (idx < SIGNAL_HardReset) {
-        interrupt_pending_[idx >> 6] &= ~(1ull << (idx & 0x3F));
+        clearPending(0, 1ull << idx);
     } else {
         RISCV_error("Lower unsupported signal %d", idx);
     }
@@ -316,10 +333,31 @@ void CpuRiver_Functional::writeCSR(int idx, uint64_t val) {
         break;
     case CSR_mtime:
         break;
+    case CSR_mpu_ctrl: {
+        // Region is latched on control write using previous addr/mask
+        MpuRegionType *p = &mpu_[(val >> 8) & (MPU_TBL_SIZE - 1)];
+        p->valid = true;
+        p->addr = portCSR_.read(CSR_mpu_addr).val;
+        p->mask = portCSR_.read(CSR_mpu_mask).val;
+        p->ctrl = val;
+        portCSR_.write(idx, val);
+        break;
+    }
     default:
         portCSR_.write(idx, val);
     }
 }
 
+bool CpuRiver_Functional::getMpuRegion(int idx, uint64_t *addr,
+                                       uint64_t *mask, uint64_t *ctrl) {
+    if (idx < 0 || idx >= MPU_TBL_SIZE || !mpu_[idx].valid) {
+        return false;
+    }
+    *addr = mpu_[idx].addr;
+    *mask = mpu_[idx].mask;
+    *ctrl = mpu_[idx].ctrl;
+    return true;
+}
+
 }  // namespace debugger
 
@@ -61,6 +61,14 @@ class CpuRiver_Functional : public CpuGeneric,
     /** ICpuRiscV interface */
     virtual uint64_t readCSR(int idx) override;
     virtual void writeCSR(int idx, uint64_t val) override;
+    virtual bool getMpuRegion(int idx, uint64_t *addr, uint64_t *mask,
+                              uint64_t *ctrl) override;
+
+    /** CpuGeneric common methods */
+    virtual void traceText(TraceRecordType *rec, std::ofstream *out) override;
+    virtual int traceRegsTotal() override {
+        return static_cast<int>(sizeof(IREGS_NAMES) / sizeof(IREGS_NAMES[0]));
+    }
 
  protected:
     /** CpuGeneric common methods */
@@ -70,8 +78,10 @@ class CpuRiver_Functional : public CpuGeneric,
     virtual void handleTrap();
     /** Tack Registers changes during execution */
     virtual void trackContextStart();
-    /** // Stop tracking and write trace file */
-    virtual void traceOutput() override;
+    /** CSR bank is stored into snapshot */
+    virtual uint64_t getSnapshotExtSize() { return portCSR_.getLength(); }
+    virtual void saveSnapshotExt(uint8_t *buf);
+    virtual void restoreSnapshotExt(uint8_t *buf);
 
     void addIsaUserRV64I();
     void addIsaPrivilegedRV64I();
@@ -101,6 +111,16 @@ class CpuRiver_Functional : public CpuGeneric,
 
     GenericReg64Bank portCSR_;
 
+    /** Regions written via CSR_mpu_ctrl (8-bits index field) */
+    struct MpuRegionType {
+        bool valid;
+        uint64_t addr;
+        uint64_t mask;
+        uint64_t ctrl;
+    };
+    static const int MPU_TBL_SIZE = 1 << 8;
+    MpuRegionType mpu_[MPU_TBL_SIZE];
+
     CmdBrRiscv *pcmd_br_;
     CmdRegRiscv *pcmd_reg_;
     CmdRegsRiscv *pcmd_regs_;
@@ -0,0 +1,215 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "hart_scheduler.h"
+
+namespace debugger {
+
+HartScheduler::HartScheduler(const char *name) : IService(name),
+    IHap(HAP_ConfigDone) {
+    registerInterface(static_cast<IThread *>(this));
+    registerInterface(static_cast<IHap *>(this));
+    registerAttribute("CpuList", &cpuList_);
+    registerAttribute("QuantumSteps", &quantumSteps_);
+    registerAttribute("Parallel", &parallel_);
+
+    char tstr[256];
+    RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
+    RISCV_event_create(&eventConfigDone_, tstr);
+    RISCV_register_hap(static_cast<IHap *>(this));
+
+    cpuList_.make_list(0);
+    quantumSteps_.make_uint64(1000);
+    parallel_.make_boolean(false);
+    harts_total_ = 0;
+    time_ = 0;
+}
+
+HartScheduler::~HartScheduler() {
+    for (int i = 0; i < harts_total_; i++) {
+        if (hart_thread_[i]) {
+            delete hart_thread_[i];
+        }
+    }
+    RISCV_event_close(&eventConfigDone_);
+}
+
+void HartScheduler::postinitService() {
+    if (cpuList_.size() > HARTS_MAX) {
+        RISCV_error("Harts number %d exceeds limit %d",
+                    cpuList_.size(), HARTS_MAX);
+        return;
+    }
+    if (quantumSteps_.to_uint64() == 0) {
+        quantumSteps_.make_uint64(1);
+    }
+
+    for (unsigned i = 0; i < cpuList_.size(); i++) {
+        const char *cpuname = cpuList_[i].to_string();
+        icpu_[i] = static_cast<ICpuFunctional *>(
+            RISCV_get_service_iface(cpuname, IFACE_CPU_FUNCTIONAL));
+        iclk_[i] = static_cast<IClock *>(
+            RISCV_get_service_iface(cpuname, IFACE_CLOCK));
+        if (!icpu_[i] || !iclk_[i]) {
+            RISCV_error("Can't find ICpuFunctional interface %s", cpuname);
+            return;
+        }
+        hart_thread_[i] = 0;
+        harts_total_++;
+    }
+
+    // Harts don't run their own loops since this moment
+    for (int i = 0; i < harts_total_; i++) {
+        icpu_[i]->attachScheduler();
+        if (parallel_.to_bool()) {
+            hart_thread_[i] = new HartThread(icpu_[i]);
+        }
+    }
+
+    const AttributeType *glb = RISCV_get_global_settings();
+    if (!(*glb)["SimEnable"].to_bool()) {
+        return;
+    }
+    for (int i = 0; i < harts_total_; i++) {
+        if (hart_thread_[i] && !hart_thread_[i]->run()) {
+            RISCV_error("Can't create thread for hart %d", i);
+            return;
+        }
+    }
+    if (!run()) {
+        RISCV_error("Can't create thread.", NULL);
+    }
+}
+
+void HartScheduler::stop() {
+    IThread::stop();
+    for (int i = 0; i < harts_total_; i++) {
+        if (hart_thread_[i]) {
+            hart_thread_[i]->stop();
+        }
+    }
+}
+
+void HartScheduler::hapTriggered(IFace *isrc, EHapType type,
+                                 const char *descr) {
+    RISCV_event_set(&eventConfigDone_);
+}
+
+void HartScheduler::busyLoop() {
+    RISCV_event_wait(&eventConfigDone_);
+
+    uint64_t quantum = quantumSteps_.to_uint64();
+    uint64_t quantum_end;
+    while (isEnabled()) {
+        time_ = syncTime();
+        quantum_end = time_ + quantum;
+
+        // Halted harts only process debug port requests and do not
+        // hold the global time, lagged harts catch it up on resume.
+        if (parallel_.to_bool()) {
+            for (int i = 0; i < harts_total_; i++) {
+                hart_thread_[i]->start(quantum_end);
+            }
+            for (int i = 0; i < harts_total_; i++) {
+                hart_thread_[i]->waitDone();
+            }
+        } else {
+            for (int i = 0; i < harts_total_; i++) {
+                icpu_[i]->executeUntil(quantum_end);
+            }
+        }
+    }
+}
+
+bool HartScheduler::isHartRunning(int idx) {
+    return icpu_[idx]->isOn() && !icpu_[idx]->isHalt();
+}
+
+/**
+ * Minimal step counter of the running harts, or of all harts when every
+ * hart is halted. Counters may be changed by snapshot restore or reset
+ * between quantums, so the time is re-read on each quantum start.
+ */
+uint64_t HartScheduler::syncTime() {
+    uint64_t t = ~0ull;
+    uint64_t tall = ~0ull;
+    uint64_t cnt;
+    for (int i = 0; i < harts_total_; i++) {
+        cnt = iclk_[i]->getStepCounter();
+        if (cnt < tall) {
+            tall = cnt;
+        }
+        if (isHartRunning(i) && cnt < t) {
+            t = cnt;
+        }
+    }
+    if (t == ~0ull) {
+        t = tall;
+    }
+    if (t == ~0ull) {
+        t = time_;
+    }
+    return t;
+}
+
+
+HartScheduler::HartThread::HartThread(ICpuFunctional *icpu) : IThread() {
+    AttributeType t1;
+    icpu_ = icpu;
+    quantum_end_ = 0;
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventStart_, t1.to_string());
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventDone_, t1.to_string());
+}
+
+HartScheduler::HartThread::~HartThread() {
+    RISCV_event_close(&eventStart_);
+    RISCV_event_close(&eventDone_);
+}
+
+void HartScheduler::HartThread::stop() {
+    RISCV_event_clear(&loopEnable_);
+    RISCV_event_set(&eventStart_);
+    IThread::stop();
+}
+
+void HartScheduler::HartThread::start(uint64_t t) {
+    quantum_end_ = t;
+    RISCV_event_set(&eventStart_);
+}
+
+void HartScheduler::HartThread::waitDone() {
+    RISCV_event_wait(&eventDone_);
+    RISCV_event_clear(&eventDone_);
+}
+
+void HartScheduler::HartThread::busyLoop() {
+    while (isEnabled()) {
+        RISCV_event_wait(&eventStart_);
+        RISCV_event_clear(&eventStart_);
+        if (!isEnabled()) {
+            break;
+        }
+        icpu_->executeUntil(quantum_end_);
+        RISCV_event_set(&eventDone_);
+    }
+    // Release barrier if the scheduler still waits
+    RISCV_event_set(&eventDone_);
+}
+
+}  // namespace debugger
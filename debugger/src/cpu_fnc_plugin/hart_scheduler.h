@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_CPU_FNC_PLUGIN_HART_SCHEDULER_H__
+#define __DEBUGGER_SRC_CPU_FNC_PLUGIN_HART_SCHEDULER_H__
+
+#include <iclass.h>
+#include <iservice.h>
+#include <ihap.h>
+#include "coreservices/ithread.h"
+#include "coreservices/iclock.h"
+#include "coreservices/icpufunctional.h"
+
+namespace debugger {
+
+/**
+ * Multi-hart scheduler of the functional CPUs. Harts are executed by
+ * quantums of 'QuantumSteps' instructions: either round-robin in the
+ * scheduler thread (fully deterministic) or in parallel, one host thread
+ * per hart with the barrier at each quantum boundary. Global timebase is
+ * the step counter of the slowest running hart, so it isn't stored
+ * separately and follows the harts on snapshot restore and reset.
+ */
+class HartScheduler : public IService,
+                      public IThread,
+                      public IHap {
+ public:
+    explicit HartScheduler(const char *name);
+    virtual ~HartScheduler();
+
+    /** IService interface */
+    virtual void postinitService();
+
+    /** IThread interface */
+    virtual void stop();
+
+    /** IHap */
+    virtual void hapTriggered(IFace *isrc, EHapType type, const char *descr);
+
+ protected:
+    /** IThread interface */
+    virtual void busyLoop();
+
+ private:
+    class HartThread : public IThread {
+     public:
+        explicit HartThread(ICpuFunctional *icpu);
+        virtual ~HartThread();
+
+        virtual void stop();
+        /** Start execution up to the quantum end 't' */
+        void start(uint64_t t);
+        /** Barrier: wait until the quantum was executed */
+        void waitDone();
+
+     protected:
+        virtual void busyLoop();
+
+     private:
+        ICpuFunctional *icpu_;
+        uint64_t quantum_end_;
+        event_def eventStart_;
+        event_def eventDone_;
+    };
+
+    bool isHartRunning(int idx);
+    uint64_t syncTime();
+
+ private:
+    AttributeType cpuList_;
+    AttributeType quantumSteps_;
+    AttributeType parallel_;
+
+    static const int HARTS_MAX = 64;
+    ICpuFunctional *icpu_[HARTS_MAX];
+    IClock *iclk_[HARTS_MAX];
+    HartThread *hart_thread_[HARTS_MAX];
+    int harts_total_;
+
+    uint64_t time_;
+    event_def eventConfigDone_;
+};
+
+DECLARE_CLASS(HartScheduler)
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_CPU_FNC_PLUGIN_HART_SCHEDULER_H__
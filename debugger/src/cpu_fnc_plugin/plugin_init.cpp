@@ -17,6 +17,7 @@
 #include "cpu_riscv_func.h"
 #include "cpu_stub_fpga.h"
 #include "icache_func.h"
+#include "hart_scheduler.h"
 #include "srcproc/srcproc.h"
 
 namespace debugger {
@@ -26,6 +27,7 @@ extern "C" void plugin_init(void) {
     REGISTER_CLASS_IDX(RiscvSourceService, 2);
     REGISTER_CLASS_IDX(CpuStubRiscVFpga, 3);
     REGISTER_CLASS_IDX(ICacheFunctional, 4);
+    REGISTER_CLASS_IDX(HartScheduler, 5);
 }
 
 }  // namespace debugger
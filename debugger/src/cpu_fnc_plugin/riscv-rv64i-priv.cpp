@@ -392,6 +392,24 @@ public:
     }
 };
 
+/**
+ * @brief WFI (wait for interrupt)
+ *
+ * Stall the hart until an interrupt might need servicing. Execution is
+ * resumed from the next instruction, so the simulator skips steps up to
+ * the nearest clock event instead of the real stall.
+ */
+class WFI : public RiscvInstruction {
+public:
+    WFI(CpuRiver_Functional *icpu) :
+        RiscvInstruction(icpu, "WFI", "00010000010100000000000001110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        icpu_->waitForInterrupt();
+        return 4;
+    }
+};
+
 
 void CpuRiver_Functional::addIsaPrivilegedRV64I() {
     addSupportedInstruction(new CSRRC(this));
@@ -408,12 +426,12 @@ void CpuRiver_Functional::addIsaPrivilegedRV64I() {
     addSupportedInstruction(new FENCE_I(this));
     addSupportedInstruction(new ECALL(this));
     addSupportedInstruction(new EBREAK(this));
+    addSupportedInstruction(new WFI(this));
 
     // TODO:
     /*
   def DRET               = BitPat("b01111011001000000000000001110011")
   def SFENCE_VMA         = BitPat("b0001001??????????000000001110011")
-  def WFI                = BitPat("b00010000010100000000000001110011")  // wait for interrupt
 
     def RDCYCLE            = BitPat("b11000000000000000010?????1110011")
     def RDTIME             = BitPat("b11000000000100000010?????1110011")
@@ -20,6 +20,7 @@
 #include <iclass.h>
 #include <iservice.h>
 #include "coreservices/isrccode.h"
+#include "generic/symbol_index.h"
 
 namespace debugger {
 
@@ -83,6 +84,7 @@ private:
     AttributeType brList_;
     AttributeType symbolListSortByName_;
     AttributeType symbolListSortByAddr_;
+    SymbolIndexType symbolIndex_;
 };
 
 DECLARE_CLASS(RiscvSourceService)
@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "cmd_smpstat.h"
+#include <string.h>
+
+namespace debugger {
+
+CmdSmpStat::CmdSmpStat(ITap *tap, SmpStatistic *stat)
+    : ICommand ("smpstat", tap) {
+
+    briefDescr_.make_string("Read per hart and L2-cache throughput of "
+                            "the SystemC River platform");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Read throughput counters of the SMP platform accumulated\n"
+        "    since the previous call of this command.\n"
+        "Output format:\n"
+        "    [c,[[f,d,d,d]*],[d,d,f,f]]\n"
+        "         c - Clocks since the previous call.\n"
+        "         f - Instructions per clock of hart[0].\n"
+        "         d - L1 read requests of hart[0].\n"
+        "         d - L1 write requests of hart[0].\n"
+        "         d - Snoop requests from L2 to hart[0].\n"
+        "         * - For each hart.\n"
+        "         d - L2 read requests to the system bus.\n"
+        "         d - L2 write requests to the system bus.\n"
+        "         f - L2 read bytes per clock.\n"
+        "         f - L2 written bytes per clock.\n"
+        "Example:\n"
+        "    smpstat\n");
+
+    stat_ = stat;
+    clock_cnt_z_ = 0;
+    memset(hart_z_, 0, sizeof(hart_z_));
+    memset(&l2_z_, 0, sizeof(l2_z_));
+}
+
+int CmdSmpStat::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdSmpStat::exec(AttributeType *args, AttributeType *res) {
+    SmpStatistic::HartCounterType hart;
+    SmpStatistic::L2CounterType l2;
+    int harts = stat_->getHartsTotal();
+    uint64_t clock_cnt = stat_->getClockCnt();
+    double dt = static_cast<double>(clock_cnt - clock_cnt_z_);
+
+    res->make_list(3);
+    (*res)[0u].make_uint64(clock_cnt - clock_cnt_z_);
+    (*res)[1].make_list(harts);
+    for (int i = 0; i < harts; i++) {
+        AttributeType &item = (*res)[1][i];
+        stat_->getHartCounters(i, &hart);
+        item.make_list(4);
+        item[0u].make_floating(dt == 0 ? 0 :
+            static_cast<double>(hart.exec_cnt - hart_z_[i].exec_cnt) / dt);
+        item[1].make_uint64(hart.rd_cnt - hart_z_[i].rd_cnt);
+        item[2].make_uint64(hart.wr_cnt - hart_z_[i].wr_cnt);
+        item[3].make_uint64(hart.snoop_cnt - hart_z_[i].snoop_cnt);
+        hart_z_[i] = hart;
+    }
+
+    AttributeType &l2item = (*res)[2];
+    stat_->getL2Counters(&l2);
+    l2item.make_list(4);
+    l2item[0u].make_uint64(l2.rd_cnt - l2_z_.rd_cnt);
+    l2item[1].make_uint64(l2.wr_cnt - l2_z_.wr_cnt);
+    l2item[2].make_floating(dt == 0 ? 0 : BUS_DATA_BYTES *
+        static_cast<double>(l2.rd_beats - l2_z_.rd_beats) / dt);
+    l2item[3].make_floating(dt == 0 ? 0 : BUS_DATA_BYTES *
+        static_cast<double>(l2.wr_beats - l2_z_.wr_beats) / dt);
+    l2_z_ = l2;
+    clock_cnt_z_ = clock_cnt;
+}
+
+}  // namespace debugger
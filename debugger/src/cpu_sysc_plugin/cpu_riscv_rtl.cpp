@@ -16,15 +16,17 @@
 
 #include "api_core.h"
 #include "cpu_riscv_rtl.h"
+#include <riscv-isa.h>
 
 namespace debugger {
 
 CpuRiscV_RTL::CpuRiscV_RTL(const char *name)  
-    : IService(name), IHap(HAP_ConfigDone) {
+    : IService(name), IHap(HAP_ConfigDone), ffListener_(this) {
     registerInterface(static_cast<IThread *>(this));
     registerInterface(static_cast<IClock *>(this));
     registerInterface(static_cast<IHap *>(this));
     registerAttribute("HartID", &hartid_);
+    registerAttribute("HartsTotal", &hartsTotal_);
     registerAttribute("AsyncReset", &asyncReset_);
     registerAttribute("FpuEnable", &fpuEnable_);
     registerAttribute("TracerEnable", &tracerEnable_);
@@ -36,13 +38,35 @@ CpuRiscV_RTL::CpuRiscV_RTL(const char *name)
     registerAttribute("FreqHz", &freqHz_);
     registerAttribute("InVcdFile", &InVcdFile_);
     registerAttribute("OutVcdFile", &OutVcdFile_);
+    registerAttribute("FastForwardCpu", &fastForwardCpu_);
+    registerAttribute("FastForwardSteps", &fastForwardSteps_);
+    registerAttribute("FastForwardSymbol", &fastForwardSymbol_);
+    registerAttribute("SourceCode", &sourceCode_);
+    registerAttribute("InstrTrace", &instrTrace_);
 
+    hartsTotal_.make_uint64(1);
     bus_.make_string("");
     freqHz_.make_uint64(1);
     fpuEnable_.make_boolean(true);
     InVcdFile_.make_string("");
     OutVcdFile_.make_string("");
+    fastForwardCpu_.make_string("");
+    fastForwardSteps_.make_uint64(0);
+    fastForwardSymbol_.make_string("");
+    sourceCode_.make_string("");
+    instrTrace_.make_string("");
+    iffserv_ = 0;
+    iffcpu_ = 0;
+    ffBreakAddr_ = REG_INVALID;
+    initCnt_ = 0;
+    core_ = 0;
+    smpstat_ = 0;
+    for (int i = 0; i < CFG_TOTAL_CPU_MAX; i++) {
+        cores_[i] = 0;
+        hartport_[i] = 0;
+    }
     RISCV_event_create(&config_done_, "riscv_sysc_config_done");
+    RISCV_event_create(&eventHandoff_, "riscv_sysc_handoff");
     RISCV_register_hap(static_cast<IHap *>(this));
 
     //createSystemC();
@@ -51,6 +75,7 @@ CpuRiscV_RTL::CpuRiscV_RTL(const char *name)
 CpuRiscV_RTL::~CpuRiscV_RTL() {
     deleteSystemC();
     RISCV_event_close(&config_done_);
+    RISCV_event_close(&eventHandoff_);
 }
 
 void CpuRiscV_RTL::postinitService() {
@@ -78,6 +103,35 @@ void CpuRiscV_RTL::postinitService() {
         return;
     }
 
+    if (fastForwardCpu_.size()) {
+        iffserv_ = RISCV_get_service(fastForwardCpu_.to_string());
+        iffcpu_ = static_cast<ICpuFunctional *>(
+            RISCV_get_service_iface(fastForwardCpu_.to_string(),
+                                    IFACE_CPU_FUNCTIONAL));
+        if (!iffcpu_) {
+            RISCV_error("ICpuFunctional interface '%s' not found",
+                        fastForwardCpu_.to_string());
+            return;
+        }
+        AttributeType *ffbus = static_cast<AttributeType *>(
+            static_cast<IService *>(iffserv_)->getAttribute("SysBus"));
+        if (ffbus && ffbus->is_string()
+            && strcmp(ffbus->to_string(), bus_.to_string()) != 0) {
+            RISCV_error("Fast-forward CPU '%s' isn't connected to '%s', "
+                        "memory won't be shared",
+                        fastForwardCpu_.to_string(), bus_.to_string());
+        }
+        RISCV_register_hap(static_cast<IHap *>(&ffListener_));
+    }
+
+    if (hartsTotal_.to_int() < 1 || hartsTotal_.to_int() > CFG_TOTAL_CPU_MAX) {
+        RISCV_error("HartsTotal must be in range 1..%d", CFG_TOTAL_CPU_MAX);
+        hartsTotal_.make_uint64(1);
+    } else if (hartsTotal_.to_int() > 1 && !l2CacheEnable_.to_bool()) {
+        RISCV_error("SMP configuration requires L2-cache", NULL);
+        hartsTotal_.make_uint64(1);
+    }
+
     createSystemC();
 
     if (InVcdFile_.size()) {
@@ -103,7 +157,21 @@ void CpuRiscV_RTL::postinitService() {
     if (l1serdes_) {
         l1serdes_->generateVCD(i_vcd_, o_vcd_);
     }
-    core_->generateVCD(i_vcd_, o_vcd_);
+    for (int i = 0; i < hartsTotal_.to_int(); i++) {
+        cores_[i]->generateVCD(i_vcd_, o_vcd_);
+    }
+
+    if (instrTrace_.size()) {
+        IInstrTrace *itrace = static_cast<IInstrTrace *>(
+            RISCV_get_service_iface(instrTrace_.to_string(),
+                                    IFACE_INSTR_TRACE));
+        if (!itrace) {
+            RISCV_error("IInstrTrace interface '%s' not found",
+                        instrTrace_.to_string());
+        } else {
+            core_->setInstrTrace(itrace);
+        }
+    }
 
     pcmd_br_ = new CmdBrRiscv(itap_);
     icmdexec_->registerCommand(static_cast<ICommand *>(pcmd_br_));
@@ -117,6 +185,9 @@ void CpuRiscV_RTL::postinitService() {
     pcmd_regs_ = new CmdRegsRiscv(itap_);
     icmdexec_->registerCommand(static_cast<ICommand *>(pcmd_regs_));
 
+    pcmd_smpstat_ = new CmdSmpStat(itap_, smpstat_);
+    icmdexec_->registerCommand(static_cast<ICommand *>(pcmd_smpstat_));
+
     if (!run()) {
         RISCV_error("Can't create thread.", NULL);
         return;
@@ -128,10 +199,12 @@ void CpuRiscV_RTL::predeleteService() {
     icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_csr_));
     icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_reg_));
     icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_regs_));
+    icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_smpstat_));
     delete pcmd_br_;
     delete pcmd_csr_;
     delete pcmd_reg_;
     delete pcmd_regs_;
+    delete pcmd_smpstat_;
 }
 
 void CpuRiscV_RTL::createSystemC() {
@@ -191,7 +264,8 @@ void CpuRiscV_RTL::createSystemC() {
                                asyncReset_.to_bool(),
                                fpuEnable_.to_bool(),
                                coherenceEnable_.to_bool(),
-                               tracerEnable_.to_bool());
+                               tracerEnable_.to_bool()
+                               || instrTrace_.size() != 0);
     core_->i_clk(wrapper_->o_clk);
     core_->i_nrst(w_nrst);
     core_->i_msti(corei0);
@@ -207,6 +281,70 @@ void CpuRiscV_RTL::createSystemC() {
     core_->o_dport_ready(w_dport_ready);
     core_->o_dport_rdata(wb_dport_rdata);
     core_->o_halted(w_halted);
+    cores_[0] = core_;
+
+    /** Secondary harts on the L2 ports 1..3 clocked by the wrapper */
+    sc_signal<axi4_l1_in_type> *corei[CFG_TOTAL_CPU_MAX] = {
+        &corei0, &corei1, &corei2, &corei3
+    };
+    sc_signal<axi4_l1_out_type> *coreo[CFG_TOTAL_CPU_MAX] = {
+        &coreo0, &coreo1, &coreo2, &coreo3
+    };
+    char tstr[64];
+    for (int i = 1; i < hartsTotal_.to_int(); i++) {
+        HartSignalsType &h = hart_[i];
+        RISCV_sprintf(tstr, sizeof(tstr), "hart%d", i);
+        hartport_[i] = new HartPort(static_cast<IService *>(this), tstr);
+        registerPortInterface(tstr,
+                              static_cast<ICpuGeneric *>(hartport_[i]));
+        hartport_[i]->i_clk(wrapper_->o_clk);
+        hartport_[i]->i_nrst(w_nrst);
+        hartport_[i]->o_interrupt(h.w_interrupt);
+        hartport_[i]->o_dport_valid(h.w_dport_valid);
+        hartport_[i]->o_dport_write(h.w_dport_write);
+        hartport_[i]->o_dport_region(h.wb_dport_region);
+        hartport_[i]->o_dport_addr(h.wb_dport_addr);
+        hartport_[i]->o_dport_wdata(h.wb_dport_wdata);
+        hartport_[i]->i_dport_ready(h.w_dport_ready);
+        hartport_[i]->i_dport_rdata(h.wb_dport_rdata);
+        hartport_[i]->i_halted(h.w_halted);
+
+        RISCV_sprintf(tstr, sizeof(tstr), "core%d", i);
+        cores_[i] = new RiverAmba(tstr, hartid_.to_uint32() + i,
+                                  asyncReset_.to_bool(),
+                                  fpuEnable_.to_bool(),
+                                  coherenceEnable_.to_bool(),
+                                  tracerEnable_.to_bool());
+        cores_[i]->i_clk(wrapper_->o_clk);
+        cores_[i]->i_nrst(w_nrst);
+        cores_[i]->i_msti(*corei[i]);
+        cores_[i]->o_msto(*coreo[i]);
+        cores_[i]->i_ext_irq(h.w_interrupt);
+        cores_[i]->o_time(h.wb_time);
+        cores_[i]->o_exec_cnt(h.wb_exec_cnt);
+        cores_[i]->i_dport_valid(h.w_dport_valid);
+        cores_[i]->i_dport_write(h.w_dport_write);
+        cores_[i]->i_dport_region(h.wb_dport_region);
+        cores_[i]->i_dport_addr(h.wb_dport_addr);
+        cores_[i]->i_dport_wdata(h.wb_dport_wdata);
+        cores_[i]->o_dport_ready(h.w_dport_ready);
+        cores_[i]->o_dport_rdata(h.wb_dport_rdata);
+        cores_[i]->o_halted(h.w_halted);
+    }
+
+    smpstat_ = new SmpStatistic("smpstat", hartsTotal_.to_int());
+    smpstat_->i_clk(wrapper_->o_clk);
+    smpstat_->i_nrst(w_nrst);
+    smpstat_->i_msti(msti);
+    smpstat_->i_msto(msto);
+    smpstat_->i_exec_cnt[0](wb_exec_cnt);
+    for (int i = 0; i < CFG_TOTAL_CPU_MAX; i++) {
+        smpstat_->i_l1i[i](*corei[i]);
+        smpstat_->i_l1o[i](*coreo[i]);
+        if (i != 0) {
+            smpstat_->i_exec_cnt[i](hart_[i].wb_exec_cnt);
+        }
+    }
 
 #ifdef DBG_ICACHE_LRU_TB
     ICacheLru_tb *tb = new ICacheLru_tb("tb");
@@ -224,7 +362,17 @@ void CpuRiscV_RTL::createSystemC() {
 
 void CpuRiscV_RTL::deleteSystemC() {
     delete wrapper_;
-    delete core_;
+    for (int i = 0; i < CFG_TOTAL_CPU_MAX; i++) {
+        if (cores_[i]) {
+            delete cores_[i];
+        }
+        if (hartport_[i]) {
+            delete hartport_[i];
+        }
+    }
+    if (smpstat_) {
+        delete smpstat_;
+    }
     if (l1serdes_) {
         delete l1serdes_;
     }
@@ -235,10 +383,15 @@ void CpuRiscV_RTL::deleteSystemC() {
 
 void CpuRiscV_RTL::hapTriggered(IFace *isrc, EHapType type,
                                 const char *descr) {
+    if (iffcpu_) {
+        armFastForward();
+    }
     RISCV_event_set(&config_done_);
 }
 
 void CpuRiscV_RTL::stop() {
+    RISCV_event_clear(&loopEnable_);
+    RISCV_event_set(&eventHandoff_);
     sc_stop();
     IThread::stop();
 }
@@ -246,7 +399,17 @@ void CpuRiscV_RTL::stop() {
 void CpuRiscV_RTL::busyLoop() {
     RISCV_event_wait(&config_done_);
 
-    sc_start();
+    if (iffcpu_) {
+        /** RTL model isn't clocked until the functional CPU halts */
+        RISCV_event_wait(&eventHandoff_);
+        if (isEnabled()) {
+            handoffState();
+        }
+    }
+
+    if (isEnabled()) {
+        sc_start();
+    }
 
     if (i_vcd_) {
         sc_close_vcd_trace_file(i_vcd_);
@@ -256,5 +419,127 @@ void CpuRiscV_RTL::busyLoop() {
     }
 }
 
+void CpuRiscV_RTL::armFastForward() {
+    /** Symbols are available only when the ELF-file was loaded */
+    if (fastForwardSymbol_.size()) {
+        ISourceCode *isrc = static_cast<ISourceCode *>(
+            RISCV_get_service_iface(sourceCode_.to_string(),
+                                    IFACE_SOURCE_CODE));
+        uint64_t addr;
+        if (!isrc) {
+            RISCV_error("ISourceCode interface '%s' not found",
+                        sourceCode_.to_string());
+        } else if (isrc->symbol2Address(fastForwardSymbol_.to_string(),
+                                        &addr) < 0) {
+            RISCV_error("Fast-forward symbol '%s' not found",
+                        fastForwardSymbol_.to_string());
+        } else {
+            ffBreakAddr_ = addr;
+            iffcpu_->addHwBreakpoint(addr);
+        }
+    }
+
+    if (fastForwardSteps_.to_uint64()) {
+        IClock *iclk = static_cast<IClock *>(
+            RISCV_get_service_iface(fastForwardCpu_.to_string(),
+                                    IFACE_CLOCK));
+        if (iclk) {
+            iclk->registerStepCallback(
+                static_cast<IClockListener *>(&ffListener_),
+                fastForwardSteps_.to_uint64());
+        }
+    }
+    /** Boot doesn't wait for the debugger 'c' command */
+    iffcpu_->go();
+}
+
+void CpuRiscV_RTL::fastForwardHalted(IFace *isrc) {
+    if (isrc != iffserv_) {
+        return;
+    }
+    RISCV_event_set(&eventHandoff_);
+}
+
+void CpuRiscV_RTL::addInitWrite(int region, int idx, uint64_t val) {
+    DebugPortTransactionType *p = &initSeq_[initCnt_++];
+    p->write = true;
+    p->region = static_cast<uint8_t>(region);
+    p->addr = static_cast<uint16_t>(idx << 3);
+    p->bytes = 8;
+    p->wdata = val;
+    p->rdata = 0;
+}
+
+void CpuRiscV_RTL::handoffState() {
+    static const uint16_t CSR_LIST[] = {
+        CSR_mstatus, CSR_mie, CSR_mtvec, CSR_mscratch, CSR_mepc,
+        CSR_mcause, CSR_mbadaddr, CSR_mstackovr, CSR_mstackund
+    };
+    uint64_t mpu_addr, mpu_mask, mpu_ctrl;
+    ICpuRiscV *iriscv = static_cast<ICpuRiscV *>(
+            RISCV_get_service_iface(fastForwardCpu_.to_string(),
+                                    IFACE_CPU_RISCV));
+    uint64_t *R = iffcpu_->getpRegs();
+    uint64_t pc = iffcpu_->getPC();
+
+    if (ffBreakAddr_ != REG_INVALID) {
+        iffcpu_->removeHwBreakpoint(ffBreakAddr_);
+    }
+    if (iffcpu_->getPrvLevel() != PRV_M) {
+        RISCV_error("Hand-off in privilege level %" RV_PRI64 "d, "
+                    "RTL core continues in machine mode",
+                    iffcpu_->getPrvLevel());
+    }
+
+    /** Region 0 = CSR, 1 = IREGS (npc = 33, fpu = 64..95), 2 = Control */
+    initCnt_ = 0;
+    addInitWrite(2, 0, 0x1);                // halt
+    for (int i = 1; i < 32; i++) {
+        addInitWrite(1, i, R[i]);
+    }
+    if (fpuEnable_.to_bool()) {
+        for (int i = 0; i < 32; i++) {
+            addInitWrite(1, 64 + i, R[64 + i]);
+        }
+    }
+    if (iriscv) {
+        for (unsigned i = 0; i < sizeof(CSR_LIST)/sizeof(CSR_LIST[0]); i++) {
+            addInitWrite(0, CSR_LIST[i], iriscv->readCSR(CSR_LIST[i]));
+        }
+        if (fpuEnable_.to_bool()) {
+            addInitWrite(0, CSR_fcsr, iriscv->readCSR(CSR_fcsr));
+        }
+        // MPU CSRs are write-only: replay regions programmed by software
+        for (int i = 0; i < CFG_MPU_TBL_SIZE; i++) {
+            if (!iriscv->getMpuRegion(i, &mpu_addr, &mpu_mask, &mpu_ctrl)) {
+                continue;
+            }
+            addInitWrite(0, CSR_mpu_addr, mpu_addr);
+            addInitWrite(0, CSR_mpu_mask, mpu_mask);
+            addInitWrite(0, CSR_mpu_ctrl, mpu_ctrl);
+        }
+    }
+    addInitWrite(1, 33, pc);                // npc
+    addInitWrite(2, 0, 0x0);                // resume
+    wrapper_->setInitSequence(initSeq_, initCnt_);
+
+    RISCV_info("Hand-off to RTL at pc=%08" RV_PRI64 "x", pc);
+}
+
+CpuRiscV_RTL::FastForwardListener::FastForwardListener(CpuRiscV_RTL *parent)
+    : IHap(HAP_Halt) {
+    parent_ = parent;
+}
+
+void CpuRiscV_RTL::FastForwardListener::hapTriggered(IFace *isrc,
+                                                     EHapType type,
+                                                     const char *descr) {
+    parent_->fastForwardHalted(isrc);
+}
+
+void CpuRiscV_RTL::FastForwardListener::stepCallback(uint64_t t) {
+    parent_->iffcpu_->halt("Fast-forward steps limit");
+}
+
 }  // namespace debugger
 
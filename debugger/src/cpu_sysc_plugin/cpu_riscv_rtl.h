@@ -21,6 +21,32 @@
  *
  * @note       When GenerateRef is true Core uses step counter instead 
  *             of clock counter to generate callbacks.
+ *
+ *             Hybrid fast-forward mode:
+ *             FastForwardCpu    - Functional CPU that executes the code
+ *                                 before the hand-off (boot, OS init)
+ *             FastForwardSteps  - Hand-off after this number of steps
+ *             FastForwardSymbol - Hand-off on the entry into the symbol
+ *             The functional CPU starts on configuration done. Any its
+ *             halt (breakpoint included) hands off the execution:
+ *             integer/FPU registers, CSRs, MPU regions and PC are loaded
+ *             into RTL core through the debug port. Memory is shared when
+ *             both CPUs are connected to the same bus, see
+ *             targets/sysc_river_fastfwd.json.
+ *
+ *             InstrTrace        - Service receiving retired instructions
+ *                                 instead of the Tracer output file, see
+ *                                 LockstepChecker
+ *
+ *             SMP platform:
+ *             HartsTotal        - Number of River cores (1..4) connected to
+ *                                 the shared L2-cache (L2CacheEnable must be
+ *                                 true when more than one). Hart 0 is the
+ *                                 service itself, other harts are the ports
+ *                                 'hart1'..'hart3' implementing ICpuGeneric:
+ *                                 DSU 'CPU' list ['core0',['core0','hart1']]
+ *                                 selects them via cpu_context register.
+ *                                 Throughput: 'smpstat' command.
  */
 
 #ifndef __DEBUGGER_CPU_RISCV_RTL_H__
@@ -32,6 +58,9 @@
 #include "async_tqueue.h"
 #include "coreservices/ithread.h"
 #include "coreservices/icpuriscv.h"
+#include "coreservices/icpufunctional.h"
+#include "coreservices/isrccode.h"
+#include "coreservices/iinstrtrace.h"
 #include "coreservices/imemop.h"
 #include "coreservices/iclock.h"
 #include "coreservices/icmdexec.h"
@@ -42,6 +71,9 @@
 #include "cmds/cmd_csr.h"
 #include "rtl_wrapper.h"
 #include "l1serdes.h"
+#include "hart_port.h"
+#include "smp_statistic.h"
+#include "cmds/cmd_smpstat.h"
 #include "ambalib/types_amba.h"
 #include "riverlib/river_amba.h"
 #include "riverlib/l2cache/l2_top.h"
@@ -96,9 +128,29 @@ class CpuRiscV_RTL : public IService,
  private:
     void createSystemC();
     void deleteSystemC();
+    void armFastForward();
+    void fastForwardHalted(IFace *isrc);
+    void handoffState();
+    void addInitWrite(int region, int idx, uint64_t val);
+
+    class FastForwardListener : public IHap,
+                                public IClockListener {
+     public:
+        explicit FastForwardListener(CpuRiscV_RTL *parent);
+
+        /** IHap: halt of the functional CPU */
+        virtual void hapTriggered(IFace *isrc, EHapType type,
+                                  const char *descr);
+        /** IClockListener: steps limit of the functional CPU */
+        virtual void stepCallback(uint64_t t);
+
+     private:
+        CpuRiscV_RTL *parent_;
+    };
 
  private:
     AttributeType hartid_;
+    AttributeType hartsTotal_;
     AttributeType asyncReset_;
     AttributeType fpuEnable_;
     AttributeType tracerEnable_;
@@ -110,11 +162,26 @@ class CpuRiscV_RTL : public IService,
     AttributeType freqHz_;
     AttributeType InVcdFile_;
     AttributeType OutVcdFile_;
+    AttributeType fastForwardCpu_;
+    AttributeType fastForwardSteps_;
+    AttributeType fastForwardSymbol_;
+    AttributeType sourceCode_;
+    AttributeType instrTrace_;
     event_def config_done_;
+    event_def eventHandoff_;
 
     ICmdExecutor *icmdexec_;
     ITap *itap_;
     IMemoryOperation *ibus_;
+    IFace *iffserv_;
+    ICpuFunctional *iffcpu_;
+    FastForwardListener ffListener_;
+    uint64_t ffBreakAddr_;
+
+    /** halt, x1..x31, f0..f31, CSRs, MPU regions, npc, resume */
+    static const int INIT_SEQ_MAX = 96;
+    DebugPortTransactionType initSeq_[INIT_SEQ_MAX];
+    int initCnt_;
 
     sc_signal<bool> w_clk;
     sc_signal<bool> w_nrst;
@@ -149,9 +216,27 @@ class CpuRiscV_RTL : public IService,
     sc_signal<axi4_master_in_type> msti;
     sc_signal<axi4_master_out_type> msto;
 
+    /** Secondary harts signals, index 0 isn't used (see signals above) */
+    struct HartSignalsType {
+        sc_signal<bool> w_interrupt;
+        sc_signal<bool> w_dport_valid;
+        sc_signal<bool> w_dport_write;
+        sc_signal<sc_uint<2>> wb_dport_region;
+        sc_signal<sc_uint<12>> wb_dport_addr;
+        sc_signal<sc_uint<RISCV_ARCH>> wb_dport_wdata;
+        sc_signal<bool> w_dport_ready;
+        sc_signal<sc_uint<RISCV_ARCH>> wb_dport_rdata;
+        sc_signal<bool> w_halted;
+        sc_signal<sc_uint<64>> wb_time;
+        sc_signal<sc_uint<64>> wb_exec_cnt;
+    } hart_[CFG_TOTAL_CPU_MAX];
+
     sc_trace_file *i_vcd_;      // stimulus pattern
     sc_trace_file *o_vcd_;      // reference pattern for comparision
     RiverAmba *core_;
+    RiverAmba *cores_[CFG_TOTAL_CPU_MAX];   // cores_[0] = core_
+    HartPort *hartport_[CFG_TOTAL_CPU_MAX];
+    SmpStatistic *smpstat_;
     RtlWrapper *wrapper_;
     L1SerDes *l1serdes_;
     L2Top *l2cache_;
@@ -160,6 +245,7 @@ class CpuRiscV_RTL : public IService,
     CmdRegRiscv *pcmd_reg_;
     CmdRegsRiscv *pcmd_regs_;
     CmdCsr *pcmd_csr_;
+    CmdSmpStat *pcmd_smpstat_;
 };
 
 DECLARE_CLASS(CpuRiscV_RTL)
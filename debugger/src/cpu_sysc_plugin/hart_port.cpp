@@ -0,0 +1,107 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "api_core.h"
+#include "hart_port.h"
+#include "iservice.h"
+#include "ihap.h"
+#include <riscv-isa.h>
+
+namespace debugger {
+
+HartPort::HartPort(IFace *parent, sc_module_name name) : sc_module(name),
+    i_clk("i_clk"),
+    i_nrst("i_nrst"),
+    o_interrupt("o_interrupt"),
+    o_dport_valid("o_dport_valid"),
+    o_dport_write("o_dport_write"),
+    o_dport_region("o_dport_region"),
+    o_dport_addr("o_dport_addr"),
+    o_dport_wdata("o_dport_wdata"),
+    i_dport_ready("i_dport_ready"),
+    i_dport_rdata("i_dport_rdata"),
+    i_halted("i_halted") {
+    iparent_ = parent;
+    async_interrupt_ = false;
+    RISCV_event_create(&dport_.valid, "hart_dport_valid");
+    dport_.trans = 0;
+    dport_.cb = 0;
+    dport_.busy = false;
+
+    SC_METHOD(registers);
+    sensitive << i_clk.posedge_event();
+
+    SC_METHOD(halted_proc);
+    sensitive << i_halted;
+    dont_initialize();
+}
+
+HartPort::~HartPort() {
+    RISCV_event_close(&dport_.valid);
+}
+
+/**
+ * Valid strobe is held one clock, the response is returned on the clock
+ * the hart sets ready (the same handshake as RtlWrapper uses).
+ */
+void HartPort::registers() {
+    o_interrupt = async_interrupt_;
+
+    o_dport_valid = 0;
+    if (i_nrst.read() && !dport_.busy
+        && RISCV_event_is_set(&dport_.valid)) {
+        RISCV_event_clear(&dport_.valid);
+        dport_.busy = true;
+        o_dport_valid = 1;
+        o_dport_write = dport_.trans->write;
+        o_dport_region = dport_.trans->region;
+        o_dport_addr = dport_.trans->addr >> 3;
+        o_dport_wdata = dport_.trans->wdata;
+    } else if (i_dport_ready.read() && dport_.busy) {
+        dport_.busy = false;
+        dport_.trans->rdata = i_dport_rdata.read().to_uint64();
+        dport_.cb->nb_response_debug_port(dport_.trans);
+    }
+}
+
+void HartPort::halted_proc() {
+    // Hart is the source so that listeners of hart 0 ignore it
+    if (i_halted.read()) {
+        RISCV_trigger_hap(static_cast<ICpuGeneric *>(this), HAP_Halt,
+                          name());
+    }
+}
+
+void HartPort::raiseSignal(int idx) {
+    if (idx == INTERRUPT_MExternal) {
+        async_interrupt_ = true;
+    }
+}
+
+void HartPort::lowerSignal(int idx) {
+    if (idx == INTERRUPT_MExternal) {
+        async_interrupt_ = false;
+    }
+}
+
+void HartPort::nb_transport_debug_port(DebugPortTransactionType *trans,
+                                       IDbgNbResponse *cb) {
+    dport_.trans = trans;
+    dport_.cb = cb;
+    RISCV_event_set(&dport_.valid);
+}
+
+}  // namespace debugger
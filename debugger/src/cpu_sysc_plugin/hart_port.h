@@ -0,0 +1,81 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_HART_PORT_H__
+#define __DEBUGGER_HART_PORT_H__
+
+#include "api_core.h"
+#include "coreservices/icpugen.h"
+#include "riverlib/river_cfg.h"
+#include <systemc.h>
+
+namespace debugger {
+
+/**
+ * Debug port and interrupt line of the secondary hart in SMP configuration.
+ * Hart 0 is served by RtlWrapper that also owns clock, reset and system bus,
+ * other harts are clocked by the wrapper and accessed through this module
+ * registered as the CPU service port 'hart<n>' (see DSU 'CPU' attribute).
+ */
+class HartPort : public sc_module,
+                 public ICpuGeneric {
+ public:
+    sc_in<bool> i_clk;
+    sc_in<bool> i_nrst;
+    /** Interrupt line from external interrupts controller. */
+    sc_out<bool> o_interrupt;
+    // Debug interface
+    sc_out<bool> o_dport_valid;                          // Debug access from DSU is valid
+    sc_out<bool> o_dport_write;                          // Write value
+    sc_out<sc_uint<2>> o_dport_region;                   // Registers region ID: 0=CSR; 1=IREGS; 2=Control
+    sc_out<sc_uint<12>> o_dport_addr;                    // Register index
+    sc_out<sc_uint<RISCV_ARCH>> o_dport_wdata;           // Write value
+    sc_in<bool> i_dport_ready;                           // Response is ready
+    sc_in<sc_uint<RISCV_ARCH>> i_dport_rdata;            // Response value
+    sc_in<bool> i_halted;
+
+    void registers();
+    void halted_proc();
+
+    SC_HAS_PROCESS(HartPort);
+
+    HartPort(IFace *parent, sc_module_name name);
+    virtual ~HartPort();
+
+    /** ICpuGeneric interface */
+    virtual void raiseSignal(int idx);
+    virtual void lowerSignal(int idx);
+    virtual void nb_transport_debug_port(DebugPortTransactionType *trans,
+                                        IDbgNbResponse *cb);
+
+ private:
+    IFace *getInterface(const char *name) { return iparent_; }
+
+ private:
+    IFace *iparent_;    // pointer on parent module object (used for logging)
+    bool async_interrupt_;
+
+    struct DebugPortType {
+        event_def valid;
+        DebugPortTransactionType *trans;
+        IDbgNbResponse *cb;
+        bool busy;              // waiting response
+    } dport_;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_HART_PORT_H__
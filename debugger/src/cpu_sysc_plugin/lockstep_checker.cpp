@@ -0,0 +1,286 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "api_core.h"
+#include "lockstep_checker.h"
+
+namespace debugger {
+
+LockstepChecker::LockstepChecker(const char *name)
+    : IService(name), refTrace_(this) {
+    registerInterface(static_cast<IInstrTrace *>(this));
+    registerInterface(static_cast<IDbgNbResponse *>(this));
+    registerAttribute("RefCpu", &refCpu_);
+    registerAttribute("DutCpu", &dutCpu_);
+    registerAttribute("ContextSize", &contextSize_);
+
+    refCpu_.make_string("");
+    dutCpu_.make_string("");
+    contextSize_.make_int64(16);
+
+    iref_ = 0;
+    irefclk_ = 0;
+    idut_ = 0;
+    dutrec_ = 0;
+    ref_retired_ = false;
+    mismatch_ = false;
+    checked_cnt_ = 0;
+    context_sz_ = 0;
+    context_wcnt_ = 0;
+    context_total_ = 0;
+}
+
+void LockstepChecker::postinitService() {
+    iref_ = static_cast<ICpuFunctional *>(
+        RISCV_get_service_iface(refCpu_.to_string(), IFACE_CPU_FUNCTIONAL));
+    if (!iref_) {
+        RISCV_error("ICpuFunctional interface '%s' not found",
+                    refCpu_.to_string());
+        return;
+    }
+
+    irefclk_ = static_cast<IClock *>(
+        RISCV_get_service_iface(refCpu_.to_string(), IFACE_CLOCK));
+    if (!irefclk_) {
+        RISCV_error("IClock interface '%s' not found", refCpu_.to_string());
+        iref_ = 0;
+        return;
+    }
+
+    /**
+     * CpuRiscV_RTL registers ICpuGeneric when SystemC model is created
+     * that could be after this call, so interface is requested on halt.
+     */
+    if (!RISCV_get_service(dutCpu_.to_string())) {
+        RISCV_error("Service '%s' not found", dutCpu_.to_string());
+        iref_ = 0;
+        return;
+    }
+
+    context_sz_ = contextSize_.to_int();
+    if (context_sz_ > CONTEXT_MAX) {
+        context_sz_ = CONTEXT_MAX;
+    }
+
+    /** Reference CPU steps only when the checked CPU retires instruction */
+    iref_->attachScheduler();
+    iref_->setInstrTrace(static_cast<IInstrTrace *>(&refTrace_));
+}
+
+void LockstepChecker::instrRetired(TraceRecordType *rec) {
+    if (!iref_ || mismatch_) {
+        return;
+    }
+    pushContext(rec);
+
+    if (iref_->isHalt()) {
+        iref_->go();
+    }
+    dutrec_ = rec;
+    ref_retired_ = false;
+    iref_->executeUntil(irefclk_->getStepCounter() + 1);
+    dutrec_ = 0;
+
+    if (!ref_retired_ && !mismatch_) {
+        mismatch_ = true;
+        RISCV_error("Lockstep: reference CPU didn't execute pc=%08"
+                    RV_PRI64 "x", rec->pc);
+        printContext();
+        haltDut();
+    }
+    checked_cnt_++;
+}
+
+void LockstepChecker::refRetired(TraceRecordType *ref) {
+    char descr[256];
+    ref_retired_ = true;
+    if (!dutrec_ || mismatch_) {
+        return;
+    }
+    if (compare(ref, dutrec_, descr, sizeof(descr))) {
+        return;
+    }
+    mismatch_ = true;
+    RISCV_error("Lockstep mismatch after %" RV_PRI64 "d instructions: %s",
+                checked_cnt_, descr);
+    printContext();
+    haltDut();
+}
+
+bool LockstepChecker::compare(TraceRecordType *ref, TraceRecordType *dut,
+                              char *descr, int descrsz) {
+    TraceActionType *a;
+    TraceActionType *r;
+    uint64_t *R = iref_->getpRegs();
+    uint32_t instr_mask = 0xFFFFFFFF;
+    uint64_t data_mask;
+    int ridx;
+
+    if (dut->pc != ref->pc) {
+        RISCV_sprintf(descr, descrsz,
+                      "pc %08" RV_PRI64 "x, reference %08" RV_PRI64 "x",
+                      dut->pc, ref->pc);
+        return false;
+    }
+    if ((ref->instr & 0x3) != 0x3) {
+        instr_mask = 0xFFFF;        // compressed
+    }
+    if ((dut->instr ^ ref->instr) & instr_mask) {
+        RISCV_sprintf(descr, descrsz,
+                      "pc %08" RV_PRI64 "x: instr %08x, reference %08x",
+                      dut->pc, dut->instr & instr_mask,
+                      ref->instr & instr_mask);
+        return false;
+    }
+
+    bool dut_memop = false;
+    for (int i = 0; i < dut->action_cnt; i++) {
+        a = &dut->action[i];
+        if (!a->memop) {
+            // Integer registers 0..31, FPU registers 32..63
+            ridx = a->waddr < 32 ? a->waddr : a->waddr + 32;
+            if (R[ridx] != a->wdata) {
+                RISCV_sprintf(descr, descrsz,
+                    "pc %08" RV_PRI64 "x: %c%d <= %016" RV_PRI64 "x, "
+                    "reference %016" RV_PRI64 "x",
+                    dut->pc, a->waddr < 32 ? 'x' : 'f', a->waddr & 0x1f,
+                    a->wdata, R[ridx]);
+                return false;
+            }
+            continue;
+        }
+
+        dut_memop = true;
+        r = 0;
+        for (int n = 0; n < ref->action_cnt; n++) {
+            if (ref->action[n].memop
+                && ref->action[n].memop_write == a->memop_write) {
+                r = &ref->action[n];
+                break;
+            }
+        }
+        if (!r) {
+            RISCV_sprintf(descr, descrsz,
+                "pc %08" RV_PRI64 "x: unexpected %s [%08" RV_PRI64 "x]",
+                dut->pc, a->memop_write ? "write" : "read", a->memop_addr);
+            return false;
+        }
+        if (r->memop_addr != a->memop_addr) {
+            RISCV_sprintf(descr, descrsz,
+                "pc %08" RV_PRI64 "x: %s [%08" RV_PRI64 "x], "
+                "reference [%08" RV_PRI64 "x]",
+                dut->pc, a->memop_write ? "write" : "read",
+                a->memop_addr, r->memop_addr);
+            return false;
+        }
+        data_mask = ~0ull;
+        if (r->memop_size < 8) {
+            data_mask = (1ull << (8 * r->memop_size)) - 1;
+        }
+        if (a->memop_write
+            && ((r->memop_data.val ^ a->memop_data.val) & data_mask)) {
+            RISCV_sprintf(descr, descrsz,
+                "pc %08" RV_PRI64 "x: [%08" RV_PRI64 "x] <= %016" RV_PRI64
+                "x, reference %016" RV_PRI64 "x",
+                dut->pc, a->memop_addr, a->memop_data.val & data_mask,
+                r->memop_data.val & data_mask);
+            return false;
+        }
+    }
+
+    if (!dut_memop) {
+        for (int n = 0; n < ref->action_cnt; n++) {
+            if (ref->action[n].memop) {
+                RISCV_sprintf(descr, descrsz,
+                    "pc %08" RV_PRI64 "x: missed memory access "
+                    "[%08" RV_PRI64 "x]",
+                    dut->pc, ref->action[n].memop_addr);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void LockstepChecker::pushContext(TraceRecordType *dut) {
+    if (context_sz_ == 0) {
+        return;
+    }
+    ContextType *p = &context_[context_wcnt_];
+    p->cnt = dut->step_cnt;
+    p->pc = dut->pc;
+    p->instr = dut->instr;
+    p->waddr = 0;
+    p->wdata = 0;
+    for (int i = 0; i < dut->action_cnt; i++) {
+        if (!dut->action[i].memop) {
+            p->waddr = dut->action[i].waddr;
+            p->wdata = dut->action[i].wdata;
+        }
+    }
+    if (++context_wcnt_ >= context_sz_) {
+        context_wcnt_ = 0;
+    }
+    if (context_total_ < context_sz_) {
+        context_total_++;
+    }
+}
+
+void LockstepChecker::printContext() {
+    int idx = context_wcnt_ - context_total_;
+    if (idx < 0) {
+        idx += context_sz_;
+    }
+    for (int i = 0; i < context_total_; i++) {
+        ContextType *p = &context_[idx];
+        if (p->waddr) {
+            RISCV_info("%9" RV_PRI64 "d: %08" RV_PRI64 "x: %08x "
+                       "%c%d <= %016" RV_PRI64 "x",
+                       p->cnt, p->pc, p->instr,
+                       p->waddr < 32 ? 'x' : 'f', p->waddr & 0x1f,
+                       p->wdata);
+        } else {
+            RISCV_info("%9" RV_PRI64 "d: %08" RV_PRI64 "x: %08x",
+                       p->cnt, p->pc, p->instr);
+        }
+        if (++idx >= context_sz_) {
+            idx = 0;
+        }
+    }
+}
+
+void LockstepChecker::haltDut() {
+    if (!idut_) {
+        idut_ = static_cast<ICpuGeneric *>(
+            RISCV_get_service_iface(dutCpu_.to_string(), IFACE_CPU_GENERIC));
+    }
+    if (!idut_) {
+        RISCV_error("ICpuGeneric interface '%s' not found",
+                    dutCpu_.to_string());
+        return;
+    }
+    // Control region, halt bit
+    trans_.write = true;
+    trans_.region = 2;
+    trans_.addr = 0;
+    trans_.bytes = 8;
+    trans_.wdata = 0x1;
+    trans_.rdata = 0;
+    idut_->nb_transport_debug_port(&trans_,
+                                   static_cast<IDbgNbResponse *>(this));
+}
+
+}  // namespace debugger
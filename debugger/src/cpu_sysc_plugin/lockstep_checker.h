@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_CPU_SYSC_PLUGIN_LOCKSTEP_CHECKER_H__
+#define __DEBUGGER_CPU_SYSC_PLUGIN_LOCKSTEP_CHECKER_H__
+
+#include "iclass.h"
+#include "iservice.h"
+#include "coreservices/iclock.h"
+#include "coreservices/icpugen.h"
+#include "coreservices/icpufunctional.h"
+#include "coreservices/iinstrtrace.h"
+
+namespace debugger {
+
+/**
+ * Online co-simulation checker. Reference functional CPU ('RefCpu') is
+ * driven by the checked CPU ('DutCpu', CpuRiscV_RTL with 'InstrTrace'
+ * pointing to this service): one step per retired instruction, then pc,
+ * instruction, destination register and memory operation are compared.
+ * The first divergence halts the checked CPU and prints the last
+ * 'ContextSize' retired instructions.
+ *
+ * Devices with side effects are accessed by both CPUs when they share the
+ * same bus, so the reference CPU should have its own copy of memory map
+ * (see targets/sysc_river_lockstep.json).
+ *
+ * Limitation: asynchronous interrupts taken by the checked CPU aren't
+ * replayed into the reference CPU, so the first trap entry on interrupt
+ * is reported as pc mismatch. Timer and other clock dependent reads
+ * diverge the same way because the reference CPU counts retired
+ * instructions instead of clock cycles. The check is intended for code
+ * running with interrupts disabled (boot, ISA tests).
+ */
+class LockstepChecker : public IService,
+                        public IInstrTrace,
+                        public IDbgNbResponse {
+ public:
+    explicit LockstepChecker(const char *name);
+
+    /** IService interface */
+    virtual void postinitService();
+
+    /** IInstrTrace: instruction retired by the checked CPU */
+    virtual void instrRetired(TraceRecordType *rec);
+
+    /** IDbgNbResponse */
+    virtual void nb_response_debug_port(DebugPortTransactionType *trans) {}
+
+ private:
+    class RefTrace : public IInstrTrace {
+     public:
+        explicit RefTrace(LockstepChecker *parent) : parent_(parent) {}
+
+        /** IInstrTrace: instruction retired by the reference CPU */
+        virtual void instrRetired(TraceRecordType *rec) {
+            parent_->refRetired(rec);
+        }
+
+     private:
+        LockstepChecker *parent_;
+    };
+
+    void refRetired(TraceRecordType *ref);
+    bool compare(TraceRecordType *ref, TraceRecordType *dut,
+                 char *descr, int descrsz);
+    void pushContext(TraceRecordType *dut);
+    void printContext();
+    void haltDut();
+
+ private:
+    AttributeType refCpu_;
+    AttributeType dutCpu_;
+    AttributeType contextSize_;
+
+    ICpuFunctional *iref_;
+    IClock *irefclk_;
+    ICpuGeneric *idut_;
+    RefTrace refTrace_;
+
+    TraceRecordType *dutrec_;       // checked record while reference steps
+    bool ref_retired_;
+    bool mismatch_;
+    uint64_t checked_cnt_;
+
+    struct ContextType {
+        uint64_t cnt;
+        uint64_t pc;
+        uint32_t instr;
+        int waddr;                  // 0 = no register write
+        uint64_t wdata;
+    };
+    static const int CONTEXT_MAX = 256;
+    ContextType context_[CONTEXT_MAX];
+    int context_sz_;
+    int context_wcnt_;
+    int context_total_;
+
+    DebugPortTransactionType trans_;
+};
+
+DECLARE_CLASS(LockstepChecker)
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_CPU_SYSC_PLUGIN_LOCKSTEP_CHECKER_H__
@@ -15,11 +15,13 @@
  */
 
 #include "cpu_riscv_rtl.h"
+#include "lockstep_checker.h"
 
 namespace debugger {
 
 extern "C" void plugin_init(void) {
     REGISTER_CLASS(CpuRiscV_RTL);
+    REGISTER_CLASS(LockstepChecker);
 }
 
 }  // namespace debugger
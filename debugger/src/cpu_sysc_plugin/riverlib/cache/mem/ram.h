@@ -37,6 +37,9 @@ SC_MODULE(ram) {
     SC_HAS_PROCESS(ram);
 
     ram(sc_module_name name_) : sc_module(name_) {
+        v.wena = 0;
+        r.wena = 0;
+
         SC_METHOD(comb);
         sensitive << i_adr;
         sensitive << i_wena;
@@ -50,10 +53,19 @@ SC_MODULE(ram) {
 
 
  private:
+    /**
+     * Memory array isn't a part of the registers struct so that it isn't
+     * copied on each 'v = r' and 'r = v', only the written word is stored
+     * on clock edge (the same as lrunway).
+     */
+    sc_uint<dbits> mem[1 << abits];
+
     struct RegistersType {
         sc_signal<bool> update;  // To generate SystemC delta event only.
         sc_signal<sc_uint<abits>> adr;
-        sc_uint<dbits> mem[1 << abits];
+        bool wena;
+        sc_uint<abits> wadr;
+        sc_uint<dbits> wdata;
     } v, r;
 };
 
@@ -62,17 +74,20 @@ void ram<abits, dbits>::comb() {
     v = r;
     v.adr = i_adr.read();
 
-    if (i_wena.read()) {
-        v.mem[i_adr.read().to_int()] = i_wdata;
-    }
-    /** v.mem[] is not a signals, so use update register to trigger process */
+    v.wena = i_wena.read();
+    v.wadr = i_adr.read();
+    v.wdata = i_wdata.read();
+    /** mem[] is not a signals, so use update register to trigger process */
     v.update = !r.update.read();
 
-    o_rdata = r.mem[r.adr.read().to_int()];
+    o_rdata = mem[r.adr.read().to_int()];
 }
 
 template <int abits, int dbits>
 void ram<abits, dbits>::registers() {
+    if (v.wena) {
+        mem[v.wadr.to_int()] = v.wdata;
+    }
     r = v;
 }
 
@@ -331,9 +331,16 @@ void CsrRegs::procedure_RegAccess(uint64_t iaddr, bool iwena,
         (*ordata) = 0;
         (*ordata)[63] = ir.trap_irq;
         (*ordata)(4, 0) = ir.trap_code;
+        if (iwena) {
+            ov->trap_irq = iwdata[63];
+            ov->trap_code = iwdata(4, 0);
+        }
         break;
     case CSR_mbadaddr:// - Machine bad address
         (*ordata) = ir.mbadaddr;
+        if (iwena) {
+            ov->mbadaddr = iwdata(CFG_CPU_ADDR_BITS-1, 0);
+        }
         break;
     case CSR_mip:// - Machine interrupt pending
         break;
@@ -93,6 +93,11 @@ SC_MODULE(Processor) {
 
     void comb();
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
+    void setInstrTrace(IInstrTrace *itrace) {
+        if (trace0) {
+            trace0->setInstrTrace(itrace);
+        }
+    }
 
     SC_HAS_PROCESS(Processor);
 
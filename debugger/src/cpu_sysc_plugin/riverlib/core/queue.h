@@ -57,9 +57,7 @@ SC_MODULE(Queue) {
         sensitive << i_re;
         sensitive << i_wdata;
         sensitive << r.wcnt;
-        for(int i = 0; i < QUEUE_DEPTH; i++) {
-            sensitive << r.mem[i];
-        }
+        sensitive << r.update;
 
         SC_METHOD(registers);
         sensitive << i_nrst;
@@ -69,9 +67,14 @@ SC_MODULE(Queue) {
  private:
     static const int QUEUE_DEPTH = 1 << szbits;
 
+    /**
+     * Memory words aren't signals: sensitivity to each of them and signal
+     * copies of the wide words are replaced by the update register.
+     */
     struct QueueRegisterType {
+        sc_signal<bool> update;  // To generate SystemC delta event only.
         sc_signal<sc_uint<szbits+1>> wcnt;
-        sc_signal<sc_biguint<dbits>> mem[QUEUE_DEPTH];
+        sc_biguint<dbits> mem[QUEUE_DEPTH];
     } v, r;
 
     bool async_reset_;
@@ -121,7 +124,7 @@ void Queue<szbits, dbits>::qproc() {
     if (r.wcnt.read() == 0) {
         vb_data_o = i_wdata.read();
     } else {
-        vb_data_o = r.mem[0].read();
+        vb_data_o = r.mem[0];
     }
 
     nempty = 0;
@@ -135,6 +138,7 @@ void Queue<szbits, dbits>::qproc() {
             v.mem[k] =  0;
         }
     }
+    v.update = !r.update.read();
 
     o_nempty = nempty;
     o_full = show_full;
@@ -148,6 +152,7 @@ void Queue<szbits, dbits>::registers() {
         for (int k = 0; k < QUEUE_DEPTH; k++) {
             r.mem[k] = 0;
         }
+        r.update = !r.update.read();
     } else {
         r = v;
     }
@@ -54,9 +54,8 @@ Tracer::Tracer(sc_module_name name_, bool async_reset, const char *trace_file)
     i_m_wdata("i_m_wdata") {
     async_reset_ = async_reset;
     fl_ = 0;
-    if (strlen(trace_file)) {
-        fl_ = fopen(trace_file, "wb");
-    }
+    trace_file_ = std::string(trace_file);
+    itrace_ = 0;
 
     SC_METHOD(comb);
     sensitive << i_nrst;
@@ -356,6 +355,30 @@ void Tracer::task_disassembler(uint32_t instr) {
     }
 }
 
+void Tracer::traceRecord(TraceStepType *p) {
+    TraceActionType *a;
+    rec_.step_cnt = p->exec_cnt;
+    rec_.pc = p->pc;
+    rec_.instr = p->instr;
+    rec_.disasm[0] = '\0';
+    rec_.action_cnt = 0;
+    if (p->waddr != 0) {
+        a = &rec_.action[rec_.action_cnt++];
+        a->memop = false;
+        a->waddr = static_cast<int>(p->waddr);
+        a->wdata = p->wres;
+    }
+    if (p->memop_load || p->memop_store) {
+        a = &rec_.action[rec_.action_cnt++];
+        a->memop = true;
+        a->memop_write = p->memop_store ? 1 : 0;
+        a->memop_addr = p->memop_addr;
+        a->memop_data.val = p->memop_store ? p->memop_wdata : p->wres;
+        a->memop_size = 0;      // isn't available on the executor outputs
+    }
+    itrace_->instrRetired(&rec_);
+}
+
 void Tracer::generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd) {
     if (o_vcd) {
         sc_trace(o_vcd, i_e_valid, i_e_valid.name());
@@ -388,6 +411,7 @@ void Tracer::registers() {
         p->memop_addr = i_e_memop_addr.read();
         p->memop_load = i_e_memop_load.read();
         p->memop_store = i_e_memop_store.read();
+        p->memop_wdata = i_e_memop_wdata.read();
         p->entry_valid = !p->whazard;
     }
 
@@ -417,6 +441,21 @@ void Tracer::registers() {
             tr_rcnt_ = 0;
         }
 
+        if (itrace_) {
+            traceRecord(p);
+            continue;
+        }
+        if (!fl_) {
+            if (trace_file_.size() == 0) {
+                continue;
+            }
+            fl_ = fopen(trace_file_.c_str(), "wb");
+            if (!fl_) {
+                trace_file_.clear();
+                continue;
+            }
+        }
+
         task_disassembler(p->instr);
         tsz = RISCV_sprintf(msg, sizeof(msg),
             "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \n",
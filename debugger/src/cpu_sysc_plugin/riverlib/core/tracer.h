@@ -22,6 +22,7 @@
 #include <systemc.h>
 #include <string>
 #include "../river_cfg.h"
+#include "coreservices/iinstrtrace.h"
 
 namespace debugger {
 
@@ -53,6 +54,8 @@ SC_MODULE(Tracer) {
     Tracer(sc_module_name name_, bool async_reset, const char *trace_file);
 
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
+    /** Retired instructions are passed to listener instead of file */
+    void setInstrTrace(IInstrTrace *itrace) { itrace_ = itrace; }
 
  private:
     void task_disassembler(uint32_t instr);
@@ -68,8 +71,11 @@ SC_MODULE(Tracer) {
         bool memop_load;
         bool memop_store;
         uint64_t memop_addr;
+        uint64_t memop_wdata;
     };
 
+    void traceRecord(TraceStepType *p);
+
     static const int TRACE_TBL_SZ = 64;
     TraceStepType trace_tbl_[TRACE_TBL_SZ];
     int tr_wcnt_;
@@ -77,7 +83,10 @@ SC_MODULE(Tracer) {
     int tr_total_;
 
     FILE *fl_;
+    std::string trace_file_;    // opened on first output
     char disasm[1024];
+    IInstrTrace *itrace_;
+    TraceRecordType rec_;
 
     bool async_reset_;
 };
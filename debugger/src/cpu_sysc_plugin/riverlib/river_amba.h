@@ -58,6 +58,9 @@ SC_MODULE(RiverAmba) {
     virtual ~RiverAmba();
 
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
+    void setInstrTrace(IInstrTrace *itrace) {
+        river0->setInstrTrace(itrace);
+    }
 
  private:
     RiverTop *river0;
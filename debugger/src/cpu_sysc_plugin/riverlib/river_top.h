@@ -72,6 +72,9 @@ SC_MODULE(RiverTop) {
     virtual ~RiverTop();
 
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
+    void setInstrTrace(IInstrTrace *itrace) {
+        proc0->setInstrTrace(itrace);
+    }
  private:
 
     Processor *proc0;
@@ -20,6 +20,7 @@
 #include "ihap.h"
 #include <riscv-isa.h>
 #include "coreservices/iserial.h"
+#include <string.h>
 
 namespace debugger {
 
@@ -57,6 +58,14 @@ RtlWrapper::RtlWrapper(IFace *parent, sc_module_name name) : sc_module(name),
     RISCV_event_create(&dport_.valid, "dport_valid");
     dport_.trans_idx_up = 0;
     dport_.trans_idx_down = 0;
+    dport_.busy = false;
+    burst_.valid = false;
+    burst_.beats = 0;
+    burst_.idx = 0;
+    init_.seq = 0;
+    init_.total = 0;
+    init_.cnt = 0;
+    init_.wait = false;
     trans.source_idx = 0;//CFG_NASTI_MASTER_CACHED;
 
     SC_METHOD(comb);
@@ -90,6 +99,10 @@ RtlWrapper::RtlWrapper(IFace *parent, sc_module_name name) : sc_module(name),
 
     SC_METHOD(sys_bus_proc);
     sensitive << bus_event_;
+
+    SC_METHOD(halted_proc);
+    sensitive << i_halted;
+    dont_initialize();
 }
 
 RtlWrapper::~RtlWrapper() {
@@ -251,10 +264,38 @@ void RtlWrapper::comb() {
 }
 
 void RtlWrapper::registers() {
-    bus_event_.notify(1, SC_NS);
+    if (isBusRequired()) {
+        bus_event_.notify(1, SC_NS);
+    }
     r = v;
 }
 
+/**
+ * Bus process is skipped on idle clocks: no AXI transaction, no debug
+ * port request, interrupt line change or clock event in the next clock.
+ */
+bool RtlWrapper::isBusRequired() {
+    if (v.state.read() != State_Idle || r.state.read() != State_Idle) {
+        return true;
+    }
+    if (dport_.busy || init_.cnt < init_.total
+        || RISCV_event_is_set(&dport_.valid)) {
+        return true;
+    }
+    if (async_interrupt != w_interrupt.read()) {
+        return true;
+    }
+    return step_queue_.isModified()
+        || step_queue_.getNextTime() <= i_time.read() + 1;
+}
+
+void RtlWrapper::halted_proc() {
+    if (i_halted.read() && init_.cnt == init_.total) {
+        IService *iserv = static_cast<IService *>(iparent_);
+        RISCV_trigger_hap(iserv, HAP_Halt, "Descr");
+    }
+}
+
 void RtlWrapper::sys_bus_proc() {
     /** Simulation events queue */
     IFace *cb;
@@ -268,11 +309,6 @@ void RtlWrapper::sys_bus_proc() {
         static_cast<IClockListener *>(cb)->stepCallback(step_cnt);
     }
 
-    if (i_halted.read() && !r.halted.read()) {
-        IService *iserv = static_cast<IService *>(iparent_);
-        RISCV_trigger_hap(iserv, HAP_Halt, "Descr");
-    }
-
     w_interrupt = async_interrupt;
 
     w_resp_valid = 0;
@@ -282,6 +318,18 @@ void RtlWrapper::sys_bus_proc() {
 
     switch (r.state.read()) {
     case State_Read:
+        if (r.req_burst.read() == 1) {
+            if (!burst_.valid) {
+                readBurst(r.req_addr.read(), r.req_len.read() + 1);
+            }
+            w_resp_valid = 1;
+            wb_resp_data = burst_.data[burst_.idx];
+            w_r_error = burst_.error[burst_.idx];
+            if (++burst_.idx >= burst_.beats) {
+                burst_.valid = false;
+            }
+            break;
+        }
         trans.action = MemAction_Read;
         trans.addr = r.req_addr.read();
         trans.xsize = 8;
@@ -296,6 +344,26 @@ void RtlWrapper::sys_bus_proc() {
         }
         break;
     case State_Write:
+        if (r.req_burst.read() == 1) {
+            if (!burst_.valid) {
+                burst_.valid = true;
+                burst_.addr = r.req_addr.read();
+                burst_.beats = r.req_len.read() + 1;
+                burst_.idx = 0;
+            }
+            if (burst_.idx < BURST_BEATS_MAX) {
+                burst_.data[burst_.idx] = wb_wdata.read();
+                burst_.strb[burst_.idx] =
+                    static_cast<uint8_t>(wb_wstrb.read());
+                burst_.idx++;
+            }
+            if (r.req_len.read() == 0) {
+                w_resp_valid = 1;
+                w_w_error = writeBurst();
+                burst_.valid = false;
+            }
+            break;
+        }
         trans.action = MemAction_Write;
         strob = static_cast<uint8_t>(wb_wstrb.read());
         offset = mask2offset(strob);
@@ -316,16 +384,33 @@ void RtlWrapper::sys_bus_proc() {
 
     // Debug port handling:
     w_dport_valid = 0;
-    if (RISCV_event_is_set(&dport_.valid)) {
+    if (init_.cnt < init_.total) {
+        if (!init_.wait) {
+            // Request is driven while core is still in reset so the halt
+            // is latched on the first clock edge, before any fetch
+            init_.wait = r.nrst.read()[1].to_bool();
+            w_dport_valid = 1;
+            w_dport_write = init_.seq[init_.cnt].write;
+            wb_dport_region = init_.seq[init_.cnt].region;
+            wb_dport_addr = init_.seq[init_.cnt].addr >> 3;
+            wb_dport_wdata = init_.seq[init_.cnt].wdata;
+        }
+    } else if (RISCV_event_is_set(&dport_.valid)) {
         RISCV_event_clear(&dport_.valid);
         w_dport_valid = 1;
         w_dport_write = dport_.trans->write;
         wb_dport_region = dport_.trans->region;
         wb_dport_addr = dport_.trans->addr >> 3;
         wb_dport_wdata = dport_.trans->wdata;
+        dport_.busy = true;
     }
     dport_.idx_missmatch = 0;
-    if (i_dport_ready.read()) {
+    if (i_dport_ready.read() && init_.wait) {
+        init_.seq[init_.cnt].rdata = i_dport_rdata.read().to_uint64();
+        init_.wait = false;
+        init_.cnt++;
+    } else if (i_dport_ready.read()) {
+        dport_.busy = false;
         dport_.trans->rdata = i_dport_rdata.read().to_uint64();
         dport_.trans_idx_down++;
         if (dport_.trans_idx_down != dport_.trans_idx_up) {
@@ -339,6 +424,87 @@ void RtlWrapper::sys_bus_proc() {
 
 }
 
+void RtlWrapper::readBurst(uint64_t addr, int beats) {
+    HostMemoryRegionType hr;
+    uint64_t bytes = static_cast<uint64_t>(beats) * BUS_DATA_BYTES;
+    burst_.valid = true;
+    burst_.addr = addr;
+    burst_.beats = beats;
+    burst_.idx = 0;
+
+    if (ibus_->getHostRegion(addr, &hr)
+        && addr >= hr.addr && addr + bytes <= hr.addr + hr.size) {
+        memcpy(burst_.data, &hr.ptr[addr - hr.addr], bytes);
+        memset(burst_.error, 0, beats * sizeof(bool));
+        ibus_->reportHostAccess(trans.source_idx, beats, 0);
+        return;
+    }
+
+    trans.action = MemAction_Read;
+    trans.xsize = BUS_DATA_BYTES;
+    trans.wstrb = 0;
+    trans.wpayload.b64[0] = 0;
+    for (int i = 0; i < beats; i++) {
+        trans.addr = addr + i * BUS_DATA_BYTES;
+        resp = ibus_->b_transport(&trans);
+        burst_.data[i] = trans.rpayload.b64[0];
+        burst_.error[i] = resp == TRANS_ERROR;
+    }
+}
+
+bool RtlWrapper::writeBurst() {
+    HostMemoryRegionType hr;
+    uint64_t bytes = static_cast<uint64_t>(burst_.beats) * BUS_DATA_BYTES;
+    uint8_t full = static_cast<uint8_t>((1 << BUS_DATA_BYTES) - 1);
+    uint8_t *src;
+    bool err = false;
+
+    if (ibus_->getHostRegion(burst_.addr, &hr) && hr.writable
+        && burst_.addr >= hr.addr
+        && burst_.addr + bytes <= hr.addr + hr.size) {
+        uint8_t *dst = &hr.ptr[burst_.addr - hr.addr];
+        for (int i = 0; i < burst_.beats; i++, dst += BUS_DATA_BYTES) {
+            src = reinterpret_cast<uint8_t *>(&burst_.data[i]);
+            if (burst_.strb[i] == full) {
+                memcpy(dst, src, BUS_DATA_BYTES);
+                continue;
+            }
+            for (int n = 0; n < BUS_DATA_BYTES; n++) {
+                if ((burst_.strb[i] >> n) & 0x1) {
+                    dst[n] = src[n];
+                }
+            }
+        }
+        ibus_->reportHostAccess(trans.source_idx, 0, burst_.beats);
+
+        // Snoop the same way as the bus does on write transactions. Burst
+        // is shorter than the decoded page and touches 2 pages at most.
+        ICpuFunctional *icpu;
+        for (unsigned i = 0; i < icpulist_.size(); i++) {
+            icpu = static_cast<ICpuFunctional *>(icpulist_[i].to_iface());
+            icpu->flush(burst_.addr);
+            icpu->flush(burst_.addr + bytes - 1);
+        }
+        return false;
+    }
+
+    uint8_t strob;
+    uint64_t offset;
+    trans.action = MemAction_Write;
+    for (int i = 0; i < burst_.beats; i++) {
+        strob = burst_.strb[i];
+        offset = mask2offset(strob);
+        trans.addr = burst_.addr + i * BUS_DATA_BYTES + offset;
+        trans.xsize = mask2size(strob >> offset);
+        trans.wstrb = (1 << trans.xsize) - 1;
+        trans.wpayload.b64[0] = burst_.data[i] >> (8 * offset);
+        if (ibus_->b_transport(&trans) == TRANS_ERROR) {
+            err = true;
+        }
+    }
+    return err;
+}
+
 uint64_t RtlWrapper::mask2offset(uint8_t mask) {
     for (int i = 0; i < BUS_DATA_BYTES; i++) {
         if (mask & 0x1) {
@@ -361,11 +527,23 @@ uint32_t RtlWrapper::mask2size(uint8_t mask) {
     return bytes;
 }
 
+void RtlWrapper::setBus(IMemoryOperation *v) {
+    ibus_ = v;
+    RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &icpulist_);
+}
+
 void RtlWrapper::setClockHz(double hz) {
     sc_time dt = sc_get_time_resolution();
     clockCycles_ = static_cast<int>((1.0 / hz) / dt.to_seconds() + 0.5);
 }
     
+void RtlWrapper::setInitSequence(DebugPortTransactionType *seq, int total) {
+    init_.seq = seq;
+    init_.cnt = 0;
+    init_.wait = false;
+    init_.total = total;
+}
+
 void RtlWrapper::registerStepCallback(IClockListener *cb, uint64_t t) {
     if (request_reset) {
         if (i_time.read() == t) {
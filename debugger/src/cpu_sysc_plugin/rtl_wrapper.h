@@ -24,6 +24,7 @@
 #include "coreservices/icpugen.h"
 #include "coreservices/iclock.h"
 #include "coreservices/icpuriscv.h"
+#include "coreservices/icpufunctional.h"
 #include "ambalib/types_amba.h"
 #include "riverlib/river_cfg.h"
 #include <systemc.h>
@@ -104,6 +105,7 @@ class RtlWrapper : public sc_module,
     void registers();
     void sys_bus_proc();
     void dbg_bus_proc();
+    void halted_proc();
 
     SC_HAS_PROCESS(RtlWrapper);
 
@@ -112,9 +114,14 @@ class RtlWrapper : public sc_module,
 
  public:
     void generateVCD(sc_trace_file *i_vcd, sc_trace_file *o_vcd);
-    void setBus(IMemoryOperation *v) { ibus_ = v; }
+    void setBus(IMemoryOperation *v);
     /** Default time resolution 1 picosecond. */
     void setClockHz(double hz);
+    /**
+     * Debug port writes executed right after reset before any external
+     * debug request, used to load architectural state into the core.
+     */
+    void setInitSequence(DebugPortTransactionType *seq, int total);
    
     /** ICpuGeneric interface */
     virtual void raiseSignal(int idx);
@@ -125,6 +132,8 @@ class RtlWrapper : public sc_module,
     /** ICpuRiscV interface */
     virtual uint64_t readCSR(int idx) { return 0;}
     void virtual writeCSR(int idx, uint64_t val) {}
+    virtual bool getMpuRegion(int idx, uint64_t *addr, uint64_t *mask,
+                              uint64_t *ctrl) { return false; }
 
     /** IClock */
     virtual void registerStepCallback(IClockListener *cb, uint64_t t);
@@ -139,9 +148,13 @@ class RtlWrapper : public sc_module,
     IFace *getInterface(const char *name) { return iparent_; }
     uint64_t mask2offset(uint8_t mask);
     uint32_t mask2size(uint8_t mask);       // nask with removed offset
+    bool isBusRequired();
+    void readBurst(uint64_t addr, int beats);
+    bool writeBurst();
 
  private:
     IMemoryOperation *ibus_;
+    AttributeType icpulist_;    // functional CPUs snooping host writes
     IFace *iparent_;    // pointer on parent module object (used for logging)
     int clockCycles_;   // default in [ps]
     ClockAsyncTQueueType step_queue_;
@@ -156,7 +169,30 @@ class RtlWrapper : public sc_module,
         unsigned trans_idx_up;
         unsigned trans_idx_down;
         unsigned idx_missmatch;
+        bool busy;              // waiting response
     } dport_;
+
+    /**
+     * INCR burst is read from memory at once on the first beat and written
+     * on the last one, beats are streamed from/to this buffer.
+     */
+    static const int BURST_BEATS_MAX = 256;
+    struct BurstType {
+        bool valid;
+        int beats;
+        int idx;
+        uint64_t addr;
+        uint64_t data[BURST_BEATS_MAX];
+        uint8_t strb[BURST_BEATS_MAX];
+        bool error[BURST_BEATS_MAX];
+    } burst_;
+
+    struct InitSequenceType {
+        DebugPortTransactionType *seq;
+        int total;
+        int cnt;
+        bool wait;              // waiting response on the current write
+    } init_;
 };
 
 }  // namespace debugger
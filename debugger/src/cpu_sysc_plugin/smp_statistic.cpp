@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "smp_statistic.h"
+#include <string.h>
+
+namespace debugger {
+
+SmpStatistic::SmpStatistic(sc_module_name name, int harts)
+    : sc_module(name),
+    i_clk("i_clk"),
+    i_nrst("i_nrst"),
+    i_msti("i_msti"),
+    i_msto("i_msto") {
+    harts_ = harts;
+    clock_cnt_ = 0;
+    memset(hart_, 0, sizeof(hart_));
+    memset(&l2_, 0, sizeof(l2_));
+
+    SC_METHOD(registers);
+    sensitive << i_clk.posedge_event();
+}
+
+/** Requests are counted on the address handshake, data on each beat */
+void SmpStatistic::registers() {
+    if (!i_nrst.read()) {
+        return;
+    }
+    clock_cnt_++;
+
+    for (int i = 0; i < harts_; i++) {
+        const axi4_l1_in_type &l1i = i_l1i[i].read();
+        const axi4_l1_out_type &l1o = i_l1o[i].read();
+        if (l1o.ar_valid && l1i.ar_ready) {
+            hart_[i].rd_cnt++;
+        }
+        if (l1o.aw_valid && l1i.aw_ready) {
+            hart_[i].wr_cnt++;
+        }
+        if (l1i.ac_valid && l1o.ac_ready) {
+            hart_[i].snoop_cnt++;
+        }
+    }
+
+    const axi4_master_in_type &msti = i_msti.read();
+    const axi4_master_out_type &msto = i_msto.read();
+    if (msto.ar_valid && msti.ar_ready) {
+        l2_.rd_cnt++;
+    }
+    if (msto.aw_valid && msti.aw_ready) {
+        l2_.wr_cnt++;
+    }
+    if (msti.r_valid && msto.r_ready) {
+        l2_.rd_beats++;
+    }
+    if (msto.w_valid && msti.w_ready) {
+        l2_.wr_beats++;
+    }
+}
+
+void SmpStatistic::getHartCounters(int idx, HartCounterType *p) {
+    *p = hart_[idx];
+    p->exec_cnt = i_exec_cnt[idx].read().to_uint64();
+}
+
+}  // namespace debugger
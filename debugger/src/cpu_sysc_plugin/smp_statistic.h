@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SMP_STATISTIC_H__
+#define __DEBUGGER_SMP_STATISTIC_H__
+
+#include "ambalib/types_amba.h"
+#include "riverlib/types_river.h"
+#include <systemc.h>
+
+namespace debugger {
+
+/**
+ * Throughput counters of the River SMP platform: retired instructions,
+ * L1 read/write requests and snoop requests per hart and L2 transactions
+ * on the system bus. Counters are free running, see 'smpstat' command.
+ */
+class SmpStatistic : public sc_module {
+ public:
+    sc_in<bool> i_clk;
+    sc_in<bool> i_nrst;
+    sc_in<axi4_l1_in_type> i_l1i[CFG_TOTAL_CPU_MAX];
+    sc_in<axi4_l1_out_type> i_l1o[CFG_TOTAL_CPU_MAX];
+    sc_in<sc_uint<64>> i_exec_cnt[CFG_TOTAL_CPU_MAX];
+    sc_in<axi4_master_in_type> i_msti;
+    sc_in<axi4_master_out_type> i_msto;
+
+    void registers();
+
+    SC_HAS_PROCESS(SmpStatistic);
+
+    SmpStatistic(sc_module_name name, int harts);
+
+    struct HartCounterType {
+        uint64_t exec_cnt;
+        uint64_t rd_cnt;        // L1 read requests
+        uint64_t wr_cnt;        // L1 write requests
+        uint64_t snoop_cnt;     // snoop requests from L2
+    };
+
+    struct L2CounterType {
+        uint64_t rd_cnt;        // system bus read requests
+        uint64_t wr_cnt;        // system bus write requests
+        uint64_t rd_beats;
+        uint64_t wr_beats;
+    };
+
+    int getHartsTotal() { return harts_; }
+    uint64_t getClockCnt() { return clock_cnt_; }
+    void getHartCounters(int idx, HartCounterType *p);
+    void getL2Counters(L2CounterType *p) { *p = l2_; }
+
+ private:
+    int harts_;
+    uint64_t clock_cnt_;
+    HartCounterType hart_[CFG_TOTAL_CPU_MAX];
+    L2CounterType l2_;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SMP_STATISTIC_H__
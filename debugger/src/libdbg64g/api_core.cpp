@@ -20,12 +20,12 @@
 #include "services/debug/serial_dbglink.h"
 #include "services/debug/udp_dbglink.h"
 #include "services/debug/edcl.h"
+#include "services/debug/covtracker.h"
 #include "services/elfloader/elfreader.h"
 #include "services/exec/cmdexec.h"
 #include "services/mem/memlut.h"
 #include "services/mem/memsim.h"
 #include "services/mem/rmemsim.h"
-#include "services/remote/tcpclient.h"
 #include "services/remote/tcpserver.h"
 #include "services/remote/dpiclient.h"
 #include "services/comport/comport.h"
@@ -70,7 +70,6 @@ extern "C" int RISCV_init() {
     REGISTER_CLASS_IDX(CmdExecutor, 4);
     REGISTER_CLASS_IDX(MemoryLUT, 5);
     REGISTER_CLASS_IDX(MemorySim, 6);
-    REGISTER_CLASS_IDX(TcpClient, 7);
     REGISTER_CLASS_IDX(TcpServer, 8);
     REGISTER_CLASS_IDX(ComPortService, 9);
     REGISTER_CLASS_IDX(AutoCompleter, 10);
@@ -78,6 +77,7 @@ extern "C" int RISCV_init() {
     REGISTER_CLASS_IDX(EdclService, 12);
     REGISTER_CLASS_IDX(RegMemorySim, 13);
     REGISTER_CLASS_IDX(DpiClient, 14);
+    REGISTER_CLASS_IDX(CoverageTracker, 15);
 
     pcore_->load_plugins();
     return 0;
@@ -326,6 +326,10 @@ extern "C" int RISCV_printf(void *iface, int level,
     int ret = 0;
     va_list arg;
     IFace *iout = reinterpret_cast<IFace *>(iface);
+    if (iout && strcmp(iout->getFaceName(), IFACE_SERVICE) == 0
+        && level > static_cast<IService *>(iout)->getLogLevel()) {
+        return 0;
+    }
     uint64_t cur_t = pcore_->getTimestamp();
 
     char *buf = pcore_->getpBufLog();
@@ -336,12 +340,6 @@ extern "C" int RISCV_printf(void *iface, int level,
                     "[%" RV_PRI64 "d, \"%s\", \"", cur_t, "unknown");
     } else if (strcmp(iout->getFaceName(), IFACE_SERVICE) == 0) {
         IService *iserv = static_cast<IService *>(iout);
-        AttributeType *local_level = 
-                static_cast<AttributeType *>(iserv->getAttribute("LogLevel"));
-        if (level > static_cast<int>(local_level->to_int64())) {
-            pcore_->unlockPrintf();
-            return 0;
-        }
         ret = RISCV_sprintf(buf, buf_sz,
                 "[%" RV_PRI64 "d, \"%s\", \"", cur_t, iserv->getObjName());
     } else if (strcmp(iout->getFaceName(), IFACE_CLASS) == 0) {
@@ -388,11 +386,7 @@ extern "C" int RISCV_sscanf(const char *s, const char *fmt, ...) {
     int ret;
     va_list arg;
     va_start(arg, fmt);
-#if defined(_WIN32) || defined(__CYGWIN__)
     ret = vsscanf(s, fmt, arg);
-#else
-    ret = vsscanf(fmt, s, arg);
-#endif
     va_end(arg);
     return ret;
 }
@@ -602,7 +596,7 @@ extern "C" void* RISCV_memshare_map(sharemem_def h, int sz) {
                         sz);
 #else
     ret = mmap(NULL, sz + 1, PROT_READ|PROT_WRITE, MAP_SHARED, h, 0);
-    if (ret < 0) {
+    if (ret == MAP_FAILED) {
         ret = 0;
     }
 #endif
@@ -620,6 +614,50 @@ extern "C" void RISCV_memshare_unmap(void *buf, int sz) {
 #endif
 }
 
+extern "C" void *RISCV_file_map(const char *filename, uint64_t off,
+                                uint64_t sz) {
+    void *ret = 0;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    HANDLE hfile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hfile == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    HANDLE hmap = CreateFileMappingA(hfile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (hmap) {
+        ret = MapViewOfFile(hmap, FILE_MAP_COPY,
+                            static_cast<DWORD>(off >> 32),
+                            static_cast<DWORD>(off),
+                            static_cast<SIZE_T>(sz));
+        CloseHandle(hmap);      // view holds the mapping object
+    }
+    CloseHandle(hfile);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ret = mmap(NULL, static_cast<size_t>(sz), PROT_READ|PROT_WRITE,
+               MAP_PRIVATE, fd, static_cast<off_t>(off));
+    if (ret == MAP_FAILED) {
+        ret = 0;
+    }
+    close(fd);
+#endif
+    if (ret == 0) {
+        RISCV_error("Couldn't map file %s", filename);
+    }
+    return ret;
+}
+
+extern "C" void RISCV_file_unmap(void *buf, uint64_t sz) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    UnmapViewOfFile(buf);
+#else
+    munmap(buf, static_cast<size_t>(sz));
+#endif
+}
+
 extern "C" void RISCV_memshare_delete(sharemem_def h) {
 #if defined(_WIN32) || defined(__CYGWIN__)
     CloseHandle(h);
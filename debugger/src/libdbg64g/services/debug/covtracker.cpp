@@ -0,0 +1,574 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <api_core.h>
+#include "covtracker.h"
+#include "coreservices/icpufunctional.h"
+#include <string.h>
+#include <stdlib.h>
+
+namespace debugger {
+
+static const char COVERAGE_MAGIC[8] = {'R', 'V', 'C', 'O', 'V', 'E', 'R', '1'};
+
+struct CoverageFileHeaderType {
+    char magic[8];
+    uint32_t region_total;
+    uint32_t granule_bits;
+};
+
+struct CoverageFileRegionType {
+    uint64_t base;
+    uint64_t size;
+};
+
+static unsigned popcount64(uint64_t v) {
+    unsigned ret = 0;
+    while (v) {
+        v &= v - 1;
+        ret++;
+    }
+    return ret;
+}
+
+CmdCoverage::CmdCoverage(IService *parent) : ICommand("coverage", 0) {
+    parent_ = parent;
+    briefDescr_.make_string("Code coverage of the simulated firmware");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Get coverage summary, export per function and per source line\n"
+        "    coverage into lcov .info or JSON file. Bitmaps stored by\n"
+        "    'save' from several runs can be merged before the export.\n"
+        "Usage:\n"
+        "    coverage\n"
+        "    coverage clear\n"
+        "    coverage save|merge|lcov|json file\n"
+        "Example:\n"
+        "    coverage lcov /home/riscv/fw.info\n"
+        "    coverage merge run2.cov\n");
+}
+
+int CmdCoverage::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1
+        || (args->size() == 2 && (*args)[1].is_equal("clear"))
+        || (args->size() == 3 && (*args)[1].is_string())) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdCoverage::exec(AttributeType *args, AttributeType *res) {
+    CoverageTracker *p = static_cast<CoverageTracker *>(parent_);
+    res->attr_free();
+    res->make_nil();
+    if (args->size() == 1) {
+        p->getSummary(res);
+        return;
+    }
+    if ((*args)[1].is_equal("clear")) {
+        p->clear();
+        return;
+    }
+    const char *filename = (*args)[2].to_string();
+    int err;
+    if ((*args)[1].is_equal("save")) {
+        err = p->save(filename);
+    } else if ((*args)[1].is_equal("merge")) {
+        err = p->merge(filename);
+    } else if (((*args)[1].is_equal("lcov") || (*args)[1].is_equal("json"))
+                && p->lineUnitsSkipped()) {
+        // Line report without some compilation units would look valid
+        generateError(res, "Unsupported DWARF line info format");
+        return;
+    } else if ((*args)[1].is_equal("lcov")) {
+        err = p->exportLcov(filename);
+    } else if ((*args)[1].is_equal("json")) {
+        err = p->exportJson(filename);
+    } else {
+        generateError(res, "Unknown subcommand");
+        return;
+    }
+    if (err) {
+        generateError(res, "Can't access file or no coverage data");
+    }
+}
+
+
+CoverageTracker::CoverageTracker(const char *name) : IService(name),
+    cmd_(static_cast<IService *>(this)) {
+    registerInterface(static_cast<ICoverageTracker *>(this));
+    registerAttribute("Regions", &regions_);
+    registerAttribute("ElfReader", &elfReader_);
+    registerAttribute("SourceCode", &sourceCode_);
+    registerAttribute("CmdExecutor", &cmdexec_);
+
+    regions_.make_list(0);
+    elfReader_.make_string("");
+    sourceCode_.make_string("");
+    cmdexec_.make_string("");
+    ielf_ = 0;
+    isrc_ = 0;
+    iexec_ = 0;
+    region_total_ = 0;
+    memset(&region_none_, 0, sizeof(region_none_));
+    last_ = &region_none_;
+    lines_ = 0;
+    line_total_ = 0;
+    func_ = 0;
+    func_total_ = 0;
+}
+
+CoverageTracker::~CoverageTracker() {
+    for (int i = 0; i < region_total_; i++) {
+        delete [] region_[i].bitmap;
+    }
+    releaseReport();
+}
+
+void CoverageTracker::postinitService() {
+    for (unsigned i = 0; i < regions_.size(); i++) {
+        const AttributeType &item = regions_[i];
+        if (!item.is_list() || item.size() < 2) {
+            RISCV_error("Wrong region format %d", i);
+            continue;
+        }
+        if (region_total_ >= REGIONS_MAX) {
+            RISCV_error("Regions number exceeds limit %d", REGIONS_MAX);
+            break;
+        }
+        RegionType *r = &region_[region_total_++];
+        r->base = item[0u].to_uint64();
+        r->size = item[1].to_uint64();
+        r->words = static_cast<unsigned>(
+            ((r->size >> GRANULE_BITS) + 63) / 64);
+        r->bitmap = new uint64_t[r->words];
+        memset(r->bitmap, 0, r->words * sizeof(uint64_t));
+    }
+
+    if (elfReader_.size()) {
+        ielf_ = static_cast<IElfReader *>(
+            RISCV_get_service_iface(elfReader_.to_string(), IFACE_ELFREADER));
+        if (!ielf_) {
+            RISCV_error("IElfReader interface '%s' not found",
+                        elfReader_.to_string());
+        }
+    }
+    if (sourceCode_.size()) {
+        isrc_ = static_cast<ISourceCode *>(
+            RISCV_get_service_iface(sourceCode_.to_string(),
+                                    IFACE_SOURCE_CODE));
+        if (!isrc_) {
+            RISCV_error("ISourceCode interface '%s' not found",
+                        sourceCode_.to_string());
+        }
+    }
+    iexec_ = static_cast<ICmdExecutor *>(
+        RISCV_get_service_iface(cmdexec_.to_string(), IFACE_CMD_EXECUTOR));
+    if (!iexec_) {
+        RISCV_error("ICmdExecutor interface '%s' not found",
+                    cmdexec_.to_string());
+    } else {
+        iexec_->registerCommand(&cmd_);
+    }
+}
+
+void CoverageTracker::predeleteService() {
+    if (iexec_) {
+        iexec_->unregisterCommand(&cmd_);
+    }
+}
+
+CoverageTracker::RegionType *CoverageTracker::findRegion(uint64_t addr) {
+    for (int i = 0; i < region_total_; i++) {
+        if (addr - region_[i].base < region_[i].size) {
+            return &region_[i];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Called by CPU on each executed instruction, all granules of the
+ * instruction are marked. The word is written only when the bits aren't
+ * set yet, so the loops executed many times don't modify the cache line
+ * shared between several harts.
+ */
+void CoverageTracker::markAddress(uint64_t addr, uint8_t oplen) {
+    RegionType *r = last_;
+    uint64_t off = addr - r->base;
+    if (off >= r->size) {
+        if ((r = findRegion(addr)) == 0) {
+            return;
+        }
+        last_ = r;
+        off = addr - r->base;
+    }
+    uint64_t last = off + (oplen ? oplen - 1 : 0);
+    if (last >= r->size) {
+        last = r->size - 1;
+    }
+    off >>= GRANULE_BITS;
+    last >>= GRANULE_BITS;
+    for (; off <= last; off++) {
+        uint64_t *pword = &r->bitmap[off >> 6];
+        uint64_t mask = 1ull << (off & 0x3F);
+        if (*pword & mask) {
+            continue;
+        }
+#if defined(_WIN32) || defined(__CYGWIN__)
+        InterlockedOr64(reinterpret_cast<volatile LONG64 *>(pword),
+                        static_cast<LONG64>(mask));
+#else
+        __sync_fetch_and_or(pword, mask);
+#endif
+    }
+}
+
+int CoverageTracker::cmpFileLine(const void *a, const void *b) {
+    const FileLineType *la = static_cast<const FileLineType *>(a);
+    const FileLineType *lb = static_cast<const FileLineType *>(b);
+    if (la->file != lb->file) {
+        return la->file < lb->file ? -1 : 1;
+    }
+    if (la->line != lb->line) {
+        return la->line < lb->line ? -1 : 1;
+    }
+    return 0;
+}
+
+bool CoverageTracker::isCovered(uint64_t addr) {
+    RegionType *r = findRegion(addr);
+    if (!r) {
+        return false;
+    }
+    uint64_t off = (addr - r->base) >> GRANULE_BITS;
+    return ((r->bitmap[off >> 6] >> (off & 0x3F)) & 0x1) != 0;
+}
+
+void CoverageTracker::clear() {
+    AttributeType cpulist;
+    for (int i = 0; i < region_total_; i++) {
+        memset(region_[i].bitmap, 0, region_[i].words * sizeof(uint64_t));
+    }
+    // CPUs don't report instructions already marked in the decoded cache
+    RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &cpulist);
+    for (unsigned i = 0; i < cpulist.size(); i++) {
+        ICpuFunctional *icpu =
+            static_cast<ICpuFunctional *>(cpulist[i].to_iface());
+        icpu->flush(~0ull);
+    }
+}
+
+int CoverageTracker::save(const char *filename) {
+    CoverageFileHeaderType hdr;
+    CoverageFileRegionType reg;
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        RISCV_error("Can't open file %s", filename);
+        return -1;
+    }
+    memcpy(hdr.magic, COVERAGE_MAGIC, sizeof(hdr.magic));
+    hdr.region_total = static_cast<uint32_t>(region_total_);
+    hdr.granule_bits = GRANULE_BITS;
+    fwrite(&hdr, 1, sizeof(hdr), f);
+    for (int i = 0; i < region_total_; i++) {
+        reg.base = region_[i].base;
+        reg.size = region_[i].size;
+        fwrite(&reg, 1, sizeof(reg), f);
+        fwrite(region_[i].bitmap, sizeof(uint64_t), region_[i].words, f);
+    }
+    fclose(f);
+    return 0;
+}
+
+/** OR bitmaps of the previous runs with the same regions */
+int CoverageTracker::merge(const char *filename) {
+    CoverageFileHeaderType hdr;
+    CoverageFileRegionType reg;
+    uint64_t w;
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        RISCV_error("Can't open file %s", filename);
+        return -1;
+    }
+    if (fread(&hdr, 1, sizeof(hdr), f) != sizeof(hdr)
+        || memcmp(hdr.magic, COVERAGE_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.granule_bits != GRANULE_BITS) {
+        RISCV_error("Wrong coverage file format %s", filename);
+        fclose(f);
+        return -1;
+    }
+    for (uint32_t i = 0; i < hdr.region_total; i++) {
+        if (fread(&reg, 1, sizeof(reg), f) != sizeof(reg)) {
+            break;
+        }
+        uint64_t words = ((reg.size >> GRANULE_BITS) + 63) / 64;
+        RegionType *r = findRegion(reg.base);
+        if (!r || r->base != reg.base || r->size != reg.size) {
+            RISCV_error("Region [%" RV_PRI64 "x, %" RV_PRI64 "x] not found",
+                        reg.base, reg.size);
+            fseek(f, static_cast<long>(words * sizeof(uint64_t)), SEEK_CUR);
+            continue;
+        }
+        for (unsigned n = 0; n < r->words; n++) {
+            if (fread(&w, 1, sizeof(w), f) != sizeof(w)) {
+                break;
+            }
+            r->bitmap[n] |= w;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/**
+ * Map bitmaps on the line table and function symbols. Lines are sorted by
+ * file and line and each line is counted once even if it was split on
+ * several address ranges.
+ */
+bool CoverageTracker::prepareReport() {
+    unsigned total = ielf_ ? ielf_->sourceLineTotal() : 0;
+    releaseReport();
+    if (lineUnitsSkipped()) {
+        RISCV_error("%d units of .debug_line aren't decoded, "
+                    "line coverage is incomplete", lineUnitsSkipped());
+    }
+
+    lines_ = new FileLineType[total + 1];
+    for (unsigned i = 0; i < total; i++) {
+        const SourceLineType *sl = ielf_->sourceLine(i);
+        lines_[i].file = sl->file;
+        lines_[i].line = sl->line;
+        lines_[i].hit = isCovered(sl->addr) ? 1 : 0;
+    }
+
+    symbols_.make_list(0);
+    if (isrc_) {
+        isrc_->getSymbols(&symbols_);
+    }
+    func_ = new FunctionType[symbols_.size() + 1];
+    func_total_ = 0;
+    FileLineType *tmp = new FileLineType[total + 1];
+    for (unsigned i = 0; i < symbols_.size(); i++) {
+        AttributeType &s = symbols_[i];
+        if ((s[Symbol_Type].to_uint64() & SYMBOL_TYPE_FUNCTION) == 0) {
+            continue;
+        }
+        FunctionType *fn = &func_[func_total_++];
+        fn->name = s[Symbol_Name].to_string();
+        fn->addr = s[Symbol_Addr].to_uint64();
+        fn->size = s[Symbol_Size].to_uint64();
+        fn->file = -1;
+        fn->line = 0;
+        fn->lines = 0;
+        fn->lines_hit = 0;
+        fn->hit = isCovered(fn->addr);
+
+        // Binary search of the first line inside of the function
+        unsigned lo = 0, hi = total, cnt = 0;
+        while (lo < hi) {
+            unsigned mid = (lo + hi) / 2;
+            if (ielf_->sourceLine(mid)->addr < fn->addr) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (unsigned n = lo; n < total; n++) {
+            const SourceLineType *sl = ielf_->sourceLine(n);
+            if (sl->addr >= fn->addr + fn->size) {
+                break;
+            }
+            if (fn->file < 0) {
+                fn->file = static_cast<int>(sl->file);
+                fn->line = sl->line;
+            }
+            tmp[cnt].file = sl->file;
+            tmp[cnt].line = sl->line;
+            tmp[cnt].hit = lines_[n].hit;
+            cnt++;
+        }
+        if (cnt) {
+            qsort(tmp, cnt, sizeof(FileLineType), cmpFileLine);
+        }
+        for (unsigned n = 0; n < cnt; n++) {
+            bool hit = tmp[n].hit != 0;
+            while (n + 1 < cnt && tmp[n + 1].file == tmp[n].file
+                    && tmp[n + 1].line == tmp[n].line) {
+                hit |= tmp[++n].hit != 0;
+            }
+            fn->lines++;
+            fn->lines_hit += hit ? 1 : 0;
+        }
+    }
+    delete [] tmp;
+
+    if (total) {
+        qsort(lines_, total, sizeof(FileLineType), cmpFileLine);
+    }
+    line_total_ = 0;
+    for (unsigned i = 0; i < total; i++) {
+        if (line_total_ && lines_[line_total_ - 1].file == lines_[i].file
+            && lines_[line_total_ - 1].line == lines_[i].line) {
+            lines_[line_total_ - 1].hit |= lines_[i].hit;
+            continue;
+        }
+        lines_[line_total_++] = lines_[i];
+    }
+    return line_total_ != 0 || func_total_ != 0;
+}
+
+void CoverageTracker::releaseReport() {
+    if (lines_) {
+        delete [] lines_;
+        lines_ = 0;
+    }
+    if (func_) {
+        delete [] func_;
+        func_ = 0;
+    }
+    line_total_ = 0;
+    func_total_ = 0;
+}
+
+void CoverageTracker::getSummary(AttributeType *res) {
+    uint64_t covered = 0;
+    unsigned lines_hit = 0;
+    unsigned func_hit = 0;
+    for (int i = 0; i < region_total_; i++) {
+        for (unsigned n = 0; n < region_[i].words; n++) {
+            covered += popcount64(region_[i].bitmap[n]);
+        }
+    }
+    prepareReport();
+    for (unsigned i = 0; i < line_total_; i++) {
+        lines_hit += lines_[i].hit;
+    }
+    for (unsigned i = 0; i < func_total_; i++) {
+        func_hit += func_[i].hit ? 1 : 0;
+    }
+    res->make_dict();
+    (*res)["CoveredBytes"].make_uint64(covered << GRANULE_BITS);
+    (*res)["Lines"].make_uint64(line_total_);
+    (*res)["LinesHit"].make_uint64(lines_hit);
+    (*res)["Functions"].make_uint64(func_total_);
+    (*res)["FunctionsHit"].make_uint64(func_hit);
+    (*res)["LineUnitsSkipped"].make_uint64(lineUnitsSkipped());
+    releaseReport();
+}
+
+int CoverageTracker::exportLcov(const char *filename) {
+    if (!prepareReport()) {
+        releaseReport();
+        return -1;
+    }
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        RISCV_error("Can't open file %s", filename);
+        releaseReport();
+        return -1;
+    }
+    fprintf(f, "TN:%s\n", getObjName());
+    unsigned i = 0;
+    while (i < line_total_) {
+        uint32_t file = lines_[i].file;
+        unsigned fn_cnt = 0, fn_hit = 0, ln_hit = 0, start = i;
+        fprintf(f, "SF:%s\n", ielf_->sourceFileName(file));
+        for (unsigned n = 0; n < func_total_; n++) {
+            if (func_[n].file == static_cast<int>(file)) {
+                fprintf(f, "FN:%d,%s\n", func_[n].line, func_[n].name);
+            }
+        }
+        for (unsigned n = 0; n < func_total_; n++) {
+            if (func_[n].file == static_cast<int>(file)) {
+                fprintf(f, "FNDA:%d,%s\n", func_[n].hit ? 1 : 0,
+                        func_[n].name);
+                fn_cnt++;
+                fn_hit += func_[n].hit ? 1 : 0;
+            }
+        }
+        fprintf(f, "FNF:%d\nFNH:%d\n", fn_cnt, fn_hit);
+        for (; i < line_total_ && lines_[i].file == file; i++) {
+            fprintf(f, "DA:%d,%d\n", lines_[i].line, lines_[i].hit);
+            ln_hit += lines_[i].hit;
+        }
+        fprintf(f, "LF:%d\nLH:%d\nend_of_record\n", i - start, ln_hit);
+    }
+    fclose(f);
+    releaseReport();
+    return 0;
+}
+
+void CoverageTracker::writeJsonString(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+int CoverageTracker::exportJson(const char *filename) {
+    if (!prepareReport()) {
+        releaseReport();
+        return -1;
+    }
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        RISCV_error("Can't open file %s", filename);
+        releaseReport();
+        return -1;
+    }
+    fprintf(f, "{\n  \"functions\": [");
+    for (unsigned i = 0; i < func_total_; i++) {
+        FunctionType *fn = &func_[i];
+        fprintf(f, "%s\n    {\"name\": ", i ? "," : "");
+        writeJsonString(f, fn->name);
+        fprintf(f, ", \"file\": ");
+        writeJsonString(f, fn->file >= 0
+                    ? ielf_->sourceFileName(fn->file) : "");
+        fprintf(f, ", \"line\": %d, \"addr\": %" RV_PRI64 "u"
+                   ", \"size\": %" RV_PRI64 "u, \"hit\": %d"
+                   ", \"lines\": %d, \"lines_hit\": %d}",
+                fn->line, fn->addr, fn->size, fn->hit ? 1 : 0,
+                fn->lines, fn->lines_hit);
+    }
+    fprintf(f, "\n  ],\n  \"files\": [");
+    unsigned i = 0;
+    while (i < line_total_) {
+        uint32_t file = lines_[i].file;
+        fprintf(f, "%s\n    {\"name\": ", i ? "," : "");
+        writeJsonString(f, ielf_->sourceFileName(file));
+        fprintf(f, ", \"lines\": [");
+        for (unsigned n = i; i < line_total_ && lines_[i].file == file; i++) {
+            fprintf(f, "%s[%d, %d]", i != n ? ", " : "",
+                    lines_[i].line, lines_[i].hit);
+        }
+        fprintf(f, "]}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    releaseReport();
+    return 0;
+}
+
+}  // namespace debugger
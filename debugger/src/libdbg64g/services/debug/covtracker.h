@@ -0,0 +1,139 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef __DEBUGGER_LIBDBG64G_SERVICES_DEBUG_COVTRACKER_H__
+#define __DEBUGGER_LIBDBG64G_SERVICES_DEBUG_COVTRACKER_H__
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icoveragetracker.h"
+#include "coreservices/icommand.h"
+#include "coreservices/icmdexec.h"
+#include "coreservices/ielfreader.h"
+#include "coreservices/isrccode.h"
+#include <stdio.h>
+
+namespace debugger {
+
+class CmdCoverage : public ICommand  {
+ public:
+    explicit CmdCoverage(IService *parent);
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+
+ private:
+    IService *parent_;
+};
+
+/**
+ * Code coverage of the executable regions. Each region is the packed
+ * bitmap with one bit per 2 bytes (minimal instruction length of RVC and
+ * Thumb). CPU threads only test and set bits without locks, results are
+ * mapped on functions and source lines using ELF symbols and DWARF line
+ * table when exported.
+ */
+class CoverageTracker : public IService,
+                        public ICoverageTracker {
+ public:
+    explicit CoverageTracker(const char *name);
+    virtual ~CoverageTracker();
+
+    /** IService interface */
+    virtual void postinitService();
+    virtual void predeleteService();
+
+    /** ICoverageTracker interface */
+    virtual void markAddress(uint64_t addr, uint8_t oplen);
+
+    /** Common methods */
+    void clear();
+    void getSummary(AttributeType *res);
+    int save(const char *filename);
+    int merge(const char *filename);
+    int exportLcov(const char *filename);
+    int exportJson(const char *filename);
+    /** Compilation units without line info due to unsupported format */
+    unsigned lineUnitsSkipped() {
+        return ielf_ ? ielf_->sourceLineUnitsSkipped() : 0;
+    }
+
+ private:
+    struct RegionType {
+        uint64_t base;
+        uint64_t size;
+        uint64_t *bitmap;
+        unsigned words;
+    };
+
+    struct FileLineType {
+        uint32_t file;
+        uint32_t line;
+        uint32_t hit;
+    };
+
+    struct FunctionType {
+        const char *name;
+        uint64_t addr;
+        uint64_t size;
+        int file;           // -1 when no line info
+        uint32_t line;
+        int lines;
+        int lines_hit;
+        bool hit;
+    };
+
+    RegionType *findRegion(uint64_t addr);
+    bool isCovered(uint64_t addr);
+    static int cmpFileLine(const void *a, const void *b);
+    bool prepareReport();
+    void releaseReport();
+    void writeJsonString(FILE *f, const char *s);
+
+ private:
+    static const int REGIONS_MAX = 16;
+    static const int GRANULE_BITS = 1;
+
+    AttributeType regions_;
+    AttributeType elfReader_;
+    AttributeType sourceCode_;
+    AttributeType cmdexec_;
+
+    IElfReader *ielf_;
+    ISourceCode *isrc_;
+    ICmdExecutor *iexec_;
+    CmdCoverage cmd_;
+
+    RegionType region_[REGIONS_MAX];
+    RegionType region_none_;
+    int region_total_;
+    RegionType *last_;
+
+    // Report data valid between prepareReport() and releaseReport()
+    AttributeType symbols_;
+    FileLineType *lines_;
+    unsigned line_total_;
+    FunctionType *func_;
+    unsigned func_total_;
+};
+
+DECLARE_CLASS(CoverageTracker)
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_LIBDBG64G_SERVICES_DEBUG_COVTRACKER_H__
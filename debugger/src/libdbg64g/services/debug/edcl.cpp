@@ -23,7 +23,9 @@ EdclService::EdclService(const char *name) : IService(name) {
     registerInterface(static_cast<ITap *>(this));
     registerAttribute("Transport", &transport_);
     registerAttribute("seq_cnt", &seq_cnt_);
+    registerAttribute("WindowSize", &windowSize_);
     seq_cnt_.make_uint64(0);
+    windowSize_.make_int64(1);
     itransport_ = 0;
 
     dbgRdTRansactionCnt_ = 0;
@@ -44,220 +46,326 @@ void EdclService::postinitService() {
 }
 
 int EdclService::read(uint64_t addr, int bytes, uint8_t *obuf) {
-    int txoff, rxoff;
-    UdpEdclCommonType req = {0};
-    UdpEdclCommonType rsp;
-    uint32_t align_addr;
-    uint32_t align_offset;
-    int align_length;
-    uint32_t obuf_len;
-    uint32_t obuf_off = 0;
-
-    align_offset = addr & 0x3ul;
-    align_addr = addr & ~0x3ul;
-    align_length = static_cast<int>((bytes + align_offset + 3) & ~0x3ul);
-
-    if (!itransport_) {
-        RISCV_error("UDP transport not defined, addr=%x", align_addr);
+    TapOperationType op;
+    op.addr = addr;
+    op.bytes = bytes;
+    op.action = TapAction_Read;
+    op.buf = obuf;
+    if (batch(&op, 1) == TAP_ERROR) {
         return TAP_ERROR;
     }
+    return bytes;
+}
 
-    int rd_bytes = 0;
-    while (rd_bytes < align_length && rd_bytes != TAP_ERROR) {
-        req.control.request.seqidx = 
-                    static_cast<uint32_t>(seq_cnt_.to_uint64());
-        req.control.request.write = 0;
-        req.address = static_cast<uint32_t>(align_addr + rd_bytes);
-        if ((align_length - rd_bytes) > EDCL_PAYLOAD_MAX_BYTES) {
-            req.control.request.len = 
-                    static_cast<uint32_t>(EDCL_PAYLOAD_MAX_BYTES);
-        } else {
-            req.control.request.len =
-                static_cast<uint32_t>(align_length - rd_bytes);
-        }
-
-        txoff = write16(tx_buf_, 0, req.offset);
-        txoff = write32(tx_buf_, txoff, req.control.word);
-        txoff = write32(tx_buf_, txoff, req.address);
-
-        txoff = itransport_->sendData(tx_buf_, txoff);
-        if (txoff == -1) {
-            RISCV_error("Data sending error", NULL);
-            rd_bytes = TAP_ERROR;
-            break;
-        }
-
-        dbgRdTRansactionCnt_++;
-        rxoff = itransport_->readData(rx_buf_, sizeof(rx_buf_));
-        if (rxoff == -1) {
-            RISCV_error("Data receiving error", NULL);
-            rd_bytes = TAP_ERROR;
-            break;
-        } 
-        if (rxoff == 0) {
-            RISCV_error("No response. Break read transaction[%d] at %08x",
-                        dbgRdTRansactionCnt_, req.address);
-            rd_bytes = TAP_ERROR;
-            break;
-        }
+int EdclService::write(uint64_t addr, int bytes, uint8_t *ibuf) {
+    TapOperationType op;
+    op.addr = addr;
+    op.bytes = bytes;
+    op.action = TapAction_Write;
+    op.buf = ibuf;
+    if (batch(&op, 1) == TAP_ERROR) {
+        return TAP_ERROR;
+    }
+    return bytes;
+}
 
-        rsp.control.word = read32(&rx_buf_[2]);
+/**
+ * Operations are placed into the staging buffer word aligned and the
+ * contiguous ones are merged into the same packets. Write into the partial
+ * words requires read-modify-write, so such operation is executed
+ * separately after all previous operations.
+ */
+int EdclService::batch(TapOperationType *ops, int cnt) {
+    TapOperationType *op;
+    EdclPacketType *p;
+    uint32_t align_addr;
+    int align_offset, align_length, len;
+    int stage_sz = 0;
+    int pkt_max = 0;
+    int pkt_cnt = 0;
+    int first = 0;
+    int ret = cnt;
 
-        const char *NAK[2] = {"ACK", "NAK"};
-        RISCV_debug("EDCL read: %s[%d], len = %d", 
-                    NAK[rsp.control.response.nak],
-                    rsp.control.response.seqidx,
-                    rsp.control.response.len);
+    if (!itransport_) {
+        RISCV_error("UDP transport not defined, addr=%x",
+                    static_cast<uint32_t>(ops[0].addr));
+        return TAP_ERROR;
+    }
 
-        // Retry with new sequence counter.
-        if (rsp.control.response.nak) {
-            RISCV_info("Sequence counter detected %d. Re-sending transaction.",
-                         rsp.control.response.seqidx);
-            seq_cnt_.make_uint64(rsp.control.response.seqidx);
-            continue;
+    int *stage_off = new int[cnt + 1];
+    for (int i = 0; i < cnt; i++) {
+        align_offset = static_cast<int>(ops[i].addr & 0x3);
+        align_length = (ops[i].bytes + align_offset + 3) & ~0x3;
+        stage_off[i] = stage_sz;
+        stage_sz += align_length;
+        pkt_max += align_length / EDCL_PAYLOAD_MAX_BYTES + 1;
+    }
+    stage_off[cnt] = stage_sz;
+    uint8_t *stage = new uint8_t[stage_sz + 4];
+    EdclPacketType *pkt = new EdclPacketType[pkt_max];
+
+    for (int i = 0; i <= cnt && ret != TAP_ERROR; i++) {
+        op = &ops[i];
+        align_offset = 0;
+        if (i < cnt) {
+            align_offset = static_cast<int>(op->addr & 0x3);
         }
-
-        // Try to receive next packet:
-        if (rsp.control.response.seqidx != seq_cnt_.to_uint32()) {
-            RISCV_error("Wrong ID received %d != %d. Try again.",
-                        seq_cnt_.to_uint32(), rsp.control.response.seqidx);
-
-            rxoff = itransport_->readData(rx_buf_, sizeof(rx_buf_));
-            if (rxoff <= 0) {
-                rd_bytes = TAP_ERROR;
+        if (i == cnt || (op->action == TapAction_Write
+            && (align_offset || (op->bytes & 0x3)))) {
+            // Flush packed operations
+            if (exchange(pkt, pkt_cnt) == TAP_ERROR) {
+                ret = TAP_ERROR;
                 break;
             }
-            rsp.control.word = read32(&rx_buf_[2]);
-            if (rsp.control.response.seqidx != seq_cnt_.to_uint32()) {
-                rd_bytes = TAP_ERROR;
-                break;
+            for (int n = first; n < i; n++) {
+                if (ops[n].action == TapAction_Read) {
+                    memcpy(ops[n].buf,
+                           &stage[stage_off[n] + (ops[n].addr & 0x3)],
+                           ops[n].bytes);
+                }
+            }
+            pkt_cnt = 0;
+            first = i + 1;
+            if (i < cnt && writeUnaligned(op) == TAP_ERROR) {
+                ret = TAP_ERROR;
             }
+            continue;
         }
 
-        obuf_len = rsp.control.response.len;
-        if ((obuf_off + obuf_len) > static_cast<uint32_t>(bytes)) {
-            // exclude alignment bytes from buffer end
-            obuf_len = static_cast<uint32_t>(bytes) - obuf_off;
+        align_addr = static_cast<uint32_t>(op->addr & ~0x3ull);
+        align_length = stage_off[i + 1] - stage_off[i];
+        uint8_t *data = &stage[stage_off[i]];
+        int write = op->action == TapAction_Write ? 1 : 0;
+        if (write) {
+            memcpy(data, op->buf, op->bytes);
         }
-        if (align_offset) {
-            if (rd_bytes == 0) {
-                memcpy(&obuf[obuf_off], &rx_buf_[10 + align_offset], obuf_len);
-                obuf_off += (rsp.control.response.len - align_offset);
-            } else {
-                memcpy(&obuf[obuf_off], &rx_buf_[10], obuf_len);
-                obuf_off += obuf_len;
+        for (int off = 0; off < align_length; off += len) {
+            p = pkt_cnt ? &pkt[pkt_cnt - 1] : 0;
+            len = align_length - off;
+            if (p && p->write == write
+                && p->addr + p->len == align_addr + off
+                && p->data + p->len == data + off
+                && p->len < EDCL_PAYLOAD_MAX_BYTES) {
+                if (len > EDCL_PAYLOAD_MAX_BYTES - p->len) {
+                    len = EDCL_PAYLOAD_MAX_BYTES - p->len;
+                }
+                p->len += len;
+                continue;
+            }
+            if (len > EDCL_PAYLOAD_MAX_BYTES) {
+                len = EDCL_PAYLOAD_MAX_BYTES;
             }
-        } else {
-            memcpy(&obuf[obuf_off], &rx_buf_[10], obuf_len);
-            obuf_off += obuf_len;
+            p = &pkt[pkt_cnt++];
+            p->write = write;
+            p->addr = align_addr + off;
+            p->len = len;
+            p->data = data + off;
         }
-        rd_bytes += rsp.control.response.len;
-        seq_cnt_.make_uint64((seq_cnt_.to_uint64() + 1) & 0x3FFF);
     }
-    return bytes;
+
+    delete [] stage_off;
+    delete [] stage;
+    delete [] pkt;
+    return ret;
 }
 
-int EdclService::write(uint64_t addr, int bytes, uint8_t *ibuf) {
-    int off;
-    UdpEdclCommonType req = {0};
-    UdpEdclCommonType rsp;
-    uint32_t align_addr;
-    uint32_t align_offset;
-    uint32_t align_offset0;
-    int align_length;
-    uint32_t ibuf_len;
-    uint32_t ibuf_off = 0;
-    uint32_t ubytes = static_cast<uint32_t>(bytes);
+int EdclService::writeUnaligned(TapOperationType *op) {
+    TapOperationType rmw[2];
+    int rmw_cnt = 0;
+    uint32_t align_addr = static_cast<uint32_t>(op->addr & ~0x3ull);
+    int align_offset = static_cast<int>(op->addr & 0x3);
+    int align_length = (op->bytes + align_offset + 3) & ~0x3;
+    uint8_t *tbuf = new uint8_t[align_length];
+
+    if (align_offset) {
+        rmw[rmw_cnt].addr = align_addr;
+        rmw[rmw_cnt].bytes = 4;
+        rmw[rmw_cnt].action = TapAction_Read;
+        rmw[rmw_cnt].buf = tbuf;
+        rmw_cnt++;
+    }
+    if (((align_offset + op->bytes) & 0x3)
+        && !(align_offset && align_length == 4)) {
+        rmw[rmw_cnt].addr = align_addr + align_length - 4;
+        rmw[rmw_cnt].bytes = 4;
+        rmw[rmw_cnt].action = TapAction_Read;
+        rmw[rmw_cnt].buf = &tbuf[align_length - 4];
+        rmw_cnt++;
+    }
+    int ret = batch(rmw, rmw_cnt);
+    if (ret != TAP_ERROR) {
+        memcpy(&tbuf[align_offset], op->buf, op->bytes);
+        ret = write(align_addr, align_length, tbuf);
+    }
+    delete [] tbuf;
+    return ret;
+}
 
-    if (!itransport_) {
-        RISCV_error("UDP transport not defined, addr=%x", addr);
-        return TAP_ERROR;
+/**
+ * Sliding window transmission of the packets. Up to 'WindowSize' requests
+ * are in flight, responses are matched by seqidx. Board handles requests
+ * strictly in order of seqidx and answers NAK with the expected value on
+ * mismatch, so all non-acknowledged requests are re-sent in the next round
+ * starting from this value. Re-sent request is always the same as the
+ * lost one, so duplicates are harmless. Late responses of the previous
+ * rounds may have seqidx of the current round: responses are accepted
+ * only in order of seqidx and with the length of the request.
+ */
+int EdclService::exchange(EdclPacketType *pkt, int total) {
+    UdpEdclCommonType rsp;
+    int window = windowSize_.to_int();
+    int pending = total;
+    int retry = 0;
+    int rxoff, n, send_pos, ack_pos, inflight;
+    uint32_t base, j;
+    bool nak, progress;
+
+    if (total == 0) {
+        return 0;
+    }
+    if (window < 1) {
+        window = 1;
+    } else if (window > EDCL_WINDOW_MAX) {
+        window = EDCL_WINDOW_MAX;
     }
 
-    align_offset = addr & 0x3ul;
-    align_addr = addr & ~0x3ul;
-    align_length = static_cast<int>((bytes + align_offset + 3) & ~0x3ul);
-    align_offset0 = align_offset;
-
-    int wr_bytes = 0;
-    while (wr_bytes < align_length && wr_bytes != -1) {
-        req.control.request.seqidx =
-                    static_cast<uint32_t>(seq_cnt_.to_uint64());
-        req.control.request.write = 1;
-        req.address = static_cast<uint32_t>(align_addr + wr_bytes);
-        if ((align_length - wr_bytes) > EDCL_PAYLOAD_MAX_BYTES) {
-            req.control.request.len =
-                    static_cast<uint32_t>(EDCL_PAYLOAD_MAX_BYTES);
-        } else {
-            req.control.request.len =
-                    static_cast<uint32_t>(align_length - wr_bytes);
+    bool *done = new bool[total];
+    int *list = new int[total];
+    memset(done, 0, total * sizeof(bool));
+
+    while (pending) {
+        // New round: not acknowledged packets with the sequential seqidx
+        n = 0;
+        for (int i = 0; i < total; i++) {
+            if (!done[i]) {
+                list[n++] = i;
+            }
         }
+        base = seq_cnt_.to_uint32();
+        send_pos = 0;
+        ack_pos = 0;
+        inflight = 0;
+        nak = false;
+        progress = false;
+
+        while (1) {
+            while (!nak && inflight < window && send_pos < n) {
+                EdclPacketType *p = &pkt[list[send_pos]];
+                if (sendPacket(p->write, (base + send_pos) & EDCL_SEQIDX_MASK,
+                               p->addr, p->len, p->data) == -1) {
+                    RISCV_error("Data sending error", NULL);
+                    pending = TAP_ERROR;
+                    break;
+                }
+                send_pos++;
+                inflight++;
+            }
+            if (pending == TAP_ERROR || inflight == 0) {
+                break;
+            }
+
+            dbgRdTRansactionCnt_++;
+            rxoff = itransport_->readData(rx_buf_, sizeof(rx_buf_));
+            if (rxoff == -1) {
+                RISCV_error("Data receiving error", NULL);
+                pending = TAP_ERROR;
+                break;
+            }
+            if (rxoff == 0) {
+                RISCV_info("No response. %d requests lost at %08x",
+                           inflight, pkt[list[send_pos - 1]].addr);
+                break;
+            }
+            inflight--;
 
-        off = write16(tx_buf_, 0, req.offset);
-        off = write32(tx_buf_, off, req.control.word);
-        off = write32(tx_buf_, off, req.address);
+            rsp.control.word = read32(&rx_buf_[2]);
+            const char *NAK[2] = {"ACK", "NAK"};
+            RISCV_debug("EDCL response: %s[%d], len = %d",
+                        NAK[rsp.control.response.nak],
+                        rsp.control.response.seqidx,
+                        rsp.control.response.len);
+
+            if (rsp.control.response.nak) {
+                // Stop sending and wait the rest of responses
+                RISCV_info("Sequence counter detected %d. "
+                           "Re-sending transaction.",
+                           rsp.control.response.seqidx);
+                seq_cnt_.make_uint64(rsp.control.response.seqidx);
+                nak = true;
+                continue;
+            }
 
-        ibuf_len = req.control.request.len;
-        // Alignment at the and of buffer
-        if (ibuf_off + req.control.request.len - align_offset0 > ubytes) {
-            read(req.address, 8, &tx_buf_[off]);
-            ibuf_len = align_offset0 + ubytes - ibuf_off;
-        }
-        // Alignment at the begin of buffer
-        if (align_offset0 != 0) {
-            off += read(align_addr, align_offset, &tx_buf_[off]);
-            ibuf_len -= align_offset;
-        }
-        // seqidx can be modified by alingment reading
-        req.control.request.seqidx =
-                    static_cast<uint32_t>(seq_cnt_.to_uint64());
-        write32(tx_buf_, 2, req.control.word);
-
-        memcpy(&tx_buf_[off], &ibuf[ibuf_off], ibuf_len);
-        ibuf_off += ibuf_len;
-        align_offset0 = 0;      // only for zero step
-
-        off = itransport_->sendData(tx_buf_, 10 + req.control.request.len);
-        if (off == -1) {
-            RISCV_error("Data sending error", NULL);
-            wr_bytes = -1;
-            break;
+            j = (rsp.control.response.seqidx - base) & EDCL_SEQIDX_MASK;
+            if (j >= static_cast<uint32_t>(send_pos)) {
+                // Stray packet isn't a response on the sent requests
+                RISCV_error("Wrong ID received %d",
+                            rsp.control.response.seqidx);
+                inflight++;
+                continue;
+            }
+            EdclPacketType *p = &pkt[list[j]];
+            if (j < static_cast<uint32_t>(ack_pos)
+                || rsp.control.response.len != static_cast<uint32_t>(p->len)
+                || (!p->write && rxoff < 10 + p->len)) {
+                RISCV_info("Stale response %d dropped",
+                           rsp.control.response.seqidx);
+                inflight++;
+                continue;
+            }
+            ack_pos = static_cast<int>(j) + 1;
+            if (!nak) {
+                seq_cnt_.make_uint64(
+                    (rsp.control.response.seqidx + 1) & EDCL_SEQIDX_MASK);
+            }
+            if (done[list[j]]) {
+                continue;
+            }
+            if (!p->write) {
+                memcpy(p->data, &rx_buf_[10], p->len);
+            }
+            done[list[j]] = true;
+            pending--;
+            progress = true;
         }
 
-        off = itransport_->readData(rx_buf_, sizeof(rx_buf_));
-        if (off == -1) {
-            RISCV_error("Data receiving error", NULL);
-            wr_bytes = -1;
+        if (pending == TAP_ERROR || pending == 0) {
             break;
-        } 
-        if (off == 0) {
-            RISCV_error("No response. Break write transaction.", NULL);
-            wr_bytes = -1;
+        }
+        if (progress) {
+            retry = 0;
+        } else if (++retry > EDCL_RETRY_MAX) {
+            RISCV_error("No response. Break transaction at %08x",
+                        pkt[list[0]].addr);
+            pending = TAP_ERROR;
             break;
         }
+    }
 
-        rsp.control.word = read32(&rx_buf_[2]);
-
-        // Warning:
-        //   response length = 0;
-        const char *NAK[2] = {"ACK", "NAK"};
-        RISCV_debug("EDCL write: %s[%d], len = %d", 
-                    NAK[rsp.control.response.nak],
-                    rsp.control.response.seqidx,
-                    req.control.request.len);
-
-        // Retry with new sequence counter.
-        if (rsp.control.response.nak) {
-            RISCV_info("Sequence counter detected %d. Re-sending transaction.",
-                         rsp.control.response.seqidx);
-            seq_cnt_.make_uint64(rsp.control.response.seqidx);
-            continue;
-        }
+    delete [] done;
+    delete [] list;
+    if (pending == TAP_ERROR) {
+        return TAP_ERROR;
+    }
+    return total;
+}
 
-        wr_bytes += req.control.request.len;
-        seq_cnt_.make_uint64(seq_cnt_.to_uint64() + 1);
+int EdclService::sendPacket(int write, uint32_t seqidx, uint32_t addr,
+                            int len, uint8_t *data) {
+    UdpEdclCommonType req = {0};
+    int off;
+    req.control.request.seqidx = seqidx;
+    req.control.request.write = write;
+    req.control.request.len = static_cast<uint32_t>(len);
+    req.address = addr;
+
+    off = write16(tx_buf_, 0, req.offset);
+    off = write32(tx_buf_, off, req.control.word);
+    off = write32(tx_buf_, off, req.address);
+    if (write) {
+        memcpy(&tx_buf_[off], data, len);
+        off += len;
     }
-    return bytes;
+    return itransport_->sendData(tx_buf_, off);
 }
 
 int EdclService::write16(uint8_t *buf, int off, uint16_t v) {
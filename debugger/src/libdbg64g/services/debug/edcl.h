@@ -25,6 +25,12 @@
 
 namespace debugger {
 
+/**
+ * Debug access via the Ethernet Debug Communication Link. Requests are
+ * split on packets, contiguous operations of the batch share packets.
+ * Packets are sent with up to 'WindowSize' outstanding sequence numbers,
+ * so the transfer isn't limited by the round-trip time.
+ */
 class EdclService : public IService,
                     public ITap {
 public:
@@ -36,8 +42,20 @@ public:
     /** ITap interface */
     virtual int read(uint64_t addr, int bytes, uint8_t *obuf);
     virtual int write(uint64_t addr, int bytes, uint8_t *ibuf);
+    virtual int batch(TapOperationType *ops, int cnt);
 
 private:
+    struct EdclPacketType {
+        int write;
+        uint32_t addr;
+        int len;
+        uint8_t *data;
+    };
+
+    int writeUnaligned(TapOperationType *op);
+    int exchange(EdclPacketType *pkt, int total);
+    int sendPacket(int write, uint32_t seqidx, uint32_t addr, int len,
+                   uint8_t *data);
     int write16(uint8_t *buf, int off, uint16_t v);
     int write32(uint8_t *buf, int off, uint32_t v);
     uint32_t read32(uint8_t *buf);
@@ -47,12 +65,18 @@ private:
      * following value up to 242 words. */
     static const int EDCL_PAYLOAD_MAX_WORDS32 = 8;
     static const int EDCL_PAYLOAD_MAX_BYTES  = 4*EDCL_PAYLOAD_MAX_WORDS32;
+    /** Maximum number of the outstanding requests */
+    static const int EDCL_WINDOW_MAX = 64;
+    /** Retransmit rounds without any progress before error */
+    static const int EDCL_RETRY_MAX = 3;
+    static const uint32_t EDCL_SEQIDX_MASK = 0x3FFF;
 
     uint8_t tx_buf_[4096];
     uint8_t rx_buf_[4096];
     ILink *itransport_;
     AttributeType transport_;
     AttributeType seq_cnt_;
+    AttributeType windowSize_;
 
     int dbgRdTRansactionCnt_;
 };
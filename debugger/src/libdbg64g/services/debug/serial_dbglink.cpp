@@ -15,9 +15,10 @@
  *
  * @details
  *             Write command: 
- *                 Send     [11.Length-1].Addr[63:0].Data[31:0]*(x Length)
+ *                 Send     0x31.[11.Length-1].Addr[63:0].Data[31:0]*(x Length)
+ *                 Receive  "ACK\n"
  *             Read command: 
- *                 Send     [10.Length-1].Addr[63:0]
+ *                 Send     0x31.[10.Length-1].Addr[63:0]
  *                 Receive  Data[31:0]*(x Length)
  */
 
@@ -32,6 +33,10 @@ SerialDbgService::SerialDbgService(const char *name)
     registerAttribute("Timeout", &timeout_);
     registerAttribute("Port", &port_);
 
+    iserial_ = 0;
+    pkt_len_ = 0;
+    pkt_write_ = 0;
+    slice_cnt_ = 0;
     RISCV_event_create(&event_block_, "SerialDbg_event_block");
 }
 
@@ -63,133 +68,179 @@ void SerialDbgService::predeleteService() {
 }
 
 int SerialDbgService::read(uint64_t addr, int bytes, uint8_t *obuf) {
-    uint32_t align_addr;
-    uint32_t align_offset;
-    int align_length;
-    uint32_t obuf_len;
-    uint32_t obuf_off = 0;
+    TapOperationType op;
+    op.addr = addr;
+    op.bytes = bytes;
+    op.action = TapAction_Read;
+    op.buf = obuf;
+    if (batch(&op, 1) == TAP_ERROR) {
+        return TAP_ERROR;
+    }
+    return bytes;
+}
+
+int SerialDbgService::write(uint64_t addr, int bytes, uint8_t *ibuf) {
+    TapOperationType op;
+    op.addr = addr;
+    op.bytes = bytes;
+    op.action = TapAction_Write;
+    op.buf = ibuf;
+    if (batch(&op, 1) == TAP_ERROR) {
+        return TAP_ERROR;
+    }
+    return bytes;
+}
 
-    align_offset = addr & 0x3ul;
-    align_addr = addr & ~0x3ul;
-    align_length = static_cast<int>((bytes + align_offset + 3) & ~0x3ul);
+/**
+ * Link is half-duplex: the tap doesn't buffer the next request while it
+ * transmits response. So contiguous operations of the same direction are
+ * merged into the bursts of UART_MST_BURST_BYTES_MAX bytes, each burst is
+ * a single round trip.
+ */
+int SerialDbgService::batch(TapOperationType *ops, int cnt) {
+    TapOperationType *op;
+    uint64_t align_addr;
+    int align_offset, align_length, len, write;
 
     if (!iserial_) {
         return TAP_ERROR;
     }
-    int bytes_to_read = align_length;
-    pkt_.fields.magic = MAGIC_ID;
-    pkt_.fields.addr = align_addr;
-    while (bytes_to_read) {
-        pkt_.fields.cmd = (0x2 << 6);
-        if (bytes_to_read > UART_MST_BURST_BYTES_MAX) {
-            req_count_ = UART_MST_BURST_BYTES_MAX;
-            pkt_.fields.cmd |= 0x3F;
-        } else {
-            req_count_ = bytes_to_read;
-            pkt_.fields.cmd |= ((bytes_to_read / 4) - 1) & 0x3F;
-        }
-        rd_count_ = 0;
-        wait_bytes_ = req_count_;
-        RISCV_event_clear(&event_block_);
-        iserial_->writeData(pkt_.buf, UART_REQ_HEADER_SZ);
-
-        if (RISCV_event_wait_ms(&event_block_, timeout_.to_int()) != 0) {
-            RISCV_error("Reading [%08" RV_PRI64 "x] failed", addr);
-            return TAP_ERROR;
-        }
-        if (rd_count_ != req_count_) {
-            RISCV_error("Read bytes %d of %d", rd_count_, req_count_);
-            return TAP_ERROR;
-        }
-
-        obuf_len = rd_count_;
-        if ((obuf_off + obuf_len) > static_cast<uint32_t>(bytes)) {
-            // exclude alignment bytes from buffer end
-            obuf_len = static_cast<uint32_t>(bytes) - obuf_off;
+    pkt_len_ = 0;
+    slice_cnt_ = 0;
+    for (int i = 0; i < cnt; i++) {
+        op = &ops[i];
+        write = op->action == TapAction_Write ? 1 : 0;
+        align_offset = static_cast<int>(op->addr & 0x3);
+        if (write && (align_offset || (op->bytes & 0x3))) {
+            if (flushPacket() == TAP_ERROR || writeUnaligned(op) == TAP_ERROR) {
+                return TAP_ERROR;
+            }
+            continue;
         }
-        if (align_offset) {
-            if (bytes_to_read == align_length) {
-                memcpy(&obuf[obuf_off], &rx_buf_[align_offset], obuf_len);
-                obuf_off += (bytes_to_read - align_offset);
+        align_addr = op->addr & ~0x3ull;
+        align_length = (op->bytes + align_offset + 3) & ~0x3;
+        for (int off = 0; off < align_length; off += len) {
+            if (pkt_len_ && (pkt_write_ != write
+                || pkt_.fields.addr + pkt_len_ != align_addr + off
+                || pkt_len_ == UART_MST_BURST_BYTES_MAX)) {
+                if (flushPacket() == TAP_ERROR) {
+                    return TAP_ERROR;
+                }
+            }
+            if (pkt_len_ == 0) {
+                pkt_.fields.addr = align_addr + off;
+                pkt_write_ = write;
+            }
+            len = align_length - off;
+            if (len > UART_MST_BURST_BYTES_MAX - pkt_len_) {
+                len = UART_MST_BURST_BYTES_MAX - pkt_len_;
+            }
+            if (write) {
+                memcpy(&pkt_.fields.data8[pkt_len_], &op->buf[off], len);
             } else {
-                memcpy(&obuf[obuf_off], rx_buf_, obuf_len);
-                obuf_off += obuf_len;
+                slice_[slice_cnt_].op = op;
+                slice_[slice_cnt_].addr = align_addr + off;
+                slice_[slice_cnt_].len = len;
+                slice_cnt_++;
             }
-        } else {
-            memcpy(&obuf[obuf_off], rx_buf_, obuf_len);
-            obuf_off += obuf_len;
+            pkt_len_ += len;
         }
-        pkt_.fields.addr += static_cast<unsigned>(rd_count_);
-        bytes_to_read -= rd_count_;
     }
-    return bytes;
-}
-
-int SerialDbgService::write(uint64_t addr, int bytes, uint8_t *ibuf) {
-    uint32_t align_addr;
-    uint32_t align_offset;
-    uint32_t align_offset0;
-    int align_length;
-    uint32_t ibuf_len;
-    uint32_t ibuf_off = 0;
-    uint32_t ubytes = static_cast<uint32_t>(bytes);
-
-    if (!iserial_) {
+    if (flushPacket() == TAP_ERROR) {
         return TAP_ERROR;
     }
+    return cnt;
+}
 
-    align_offset = addr & 0x3ul;
-    align_addr = addr & ~0x3ul;
-    align_length = static_cast<int>((bytes + align_offset + 3) & ~0x3ul);
-    align_offset0 = align_offset;
+int SerialDbgService::writeUnaligned(TapOperationType *op) {
+    TapOperationType rmw[2];
+    int rmw_cnt = 0;
+    uint64_t align_addr = op->addr & ~0x3ull;
+    int align_offset = static_cast<int>(op->addr & 0x3);
+    int align_length = (op->bytes + align_offset + 3) & ~0x3;
+    uint8_t *tbuf = new uint8_t[align_length];
+
+    // Read-modify-write of the partially written words
+    if (align_offset) {
+        rmw[rmw_cnt].addr = align_addr;
+        rmw[rmw_cnt].bytes = 4;
+        rmw[rmw_cnt].action = TapAction_Read;
+        rmw[rmw_cnt].buf = tbuf;
+        rmw_cnt++;
+    }
+    if (((align_offset + op->bytes) & 0x3)
+        && !(align_offset && align_length == 4)) {
+        rmw[rmw_cnt].addr = align_addr + align_length - 4;
+        rmw[rmw_cnt].bytes = 4;
+        rmw[rmw_cnt].action = TapAction_Read;
+        rmw[rmw_cnt].buf = &tbuf[align_length - 4];
+        rmw_cnt++;
+    }
+    int ret = batch(rmw, rmw_cnt);
+    if (ret != TAP_ERROR) {
+        memcpy(&tbuf[align_offset], op->buf, op->bytes);
+        ret = write(align_addr, align_length, tbuf);
+    }
+    delete [] tbuf;
+    return ret;
+}
 
-    int bytes_to_write = align_length;
+int SerialDbgService::flushPacket() {
+    uint64_t lo, hi;
+    int tx_len = UART_REQ_HEADER_SZ;
+    if (pkt_len_ == 0) {
+        return 0;
+    }
     pkt_.fields.magic = MAGIC_ID;
-    pkt_.fields.addr = align_addr;
-    while (bytes_to_write) {
-        pkt_.fields.cmd = (0x3 << 6);
-        if (bytes_to_write > UART_MST_BURST_BYTES_MAX) {
-            req_count_ = UART_MST_BURST_BYTES_MAX;
-            pkt_.fields.cmd |= 0x3F;
-        } else {
-            req_count_ = bytes_to_write;
-            pkt_.fields.cmd |= ((bytes_to_write / 4) - 1) & 0x3F;
-        }
-
-        ibuf_len = req_count_;
-        // Alignment at the and of buffer
-        if (ibuf_off + req_count_ - align_offset0 > ubytes) {
-            read(pkt_.fields.addr, 8, pkt_.fields.data8);
-            ibuf_len = align_offset0 + ubytes - ibuf_off;
-        }
-        // Alignment at the begin of buffer
-        if (align_offset0 != 0) {
-            read(align_addr, align_offset, pkt_.fields.data8);
-            ibuf_len -= align_offset;
-        }
+    pkt_.fields.cmd = ((pkt_len_ / 4) - 1) & 0x3F;
+    if (pkt_write_) {
+        pkt_.fields.cmd |= (0x3 << 6);
+        tx_len += pkt_len_;
+        req_count_ = 4;     // "ACK\n" handshake
+    } else {
+        pkt_.fields.cmd |= (0x2 << 6);
+        req_count_ = pkt_len_;
+    }
+    pkt_len_ = 0;
 
-        memcpy(&pkt_.fields.data8[align_offset0], &ibuf[ibuf_off], ibuf_len);
-        ibuf_off += ibuf_len;
-        align_offset0 = 0;      // only for zero step
+    rd_count_ = 0;
+    wait_bytes_ = req_count_;
+    RISCV_event_clear(&event_block_);
+    iserial_->writeData(pkt_.buf, tx_len);
 
-        wait_bytes_ = 4;
-        rd_count_ = 0;
-        RISCV_event_clear(&event_block_);
-        iserial_->writeData(pkt_.buf, UART_REQ_HEADER_SZ + req_count_);
+    if (RISCV_event_wait_ms(&event_block_, timeout_.to_int()) != 0) {
+        RISCV_error("Burst [%08" RV_PRI64 "x] failed", pkt_.fields.addr);
+        slice_cnt_ = 0;
+        return TAP_ERROR;
+    }
+    if (rd_count_ < req_count_) {
+        RISCV_error("Read bytes %d of %d", rd_count_, req_count_);
+        slice_cnt_ = 0;
+        return TAP_ERROR;
+    }
 
-        // Waiting "ACK\n" handshake
-        if (RISCV_event_wait_ms(&event_block_, timeout_.to_int()) != 0) {
-            RISCV_error("Writing [%08" RV_PRI64 "x] failed", addr);
-            return TAP_ERROR;
+    // Scatter read data into the operations buffers
+    for (int i = 0; i < slice_cnt_; i++) {
+        ReadSliceType *p = &slice_[i];
+        lo = p->op->addr > p->addr ? p->op->addr : p->addr;
+        hi = p->op->addr + p->op->bytes;
+        if (hi > p->addr + p->len) {
+            hi = p->addr + p->len;
+        }
+        if (hi > lo) {
+            memcpy(&p->op->buf[lo - p->op->addr],
+                   &rx_buf_[lo - pkt_.fields.addr],
+                   static_cast<size_t>(hi - lo));
         }
-
-        bytes_to_write -= req_count_;
-        pkt_.fields.addr += static_cast<unsigned>(req_count_);
     }
-    return bytes;
+    slice_cnt_ = 0;
+    return 0;
 }
 
 int SerialDbgService::updateData(const char *buf, int buflen) {
+    if (rd_count_ + buflen > static_cast<int>(sizeof(rx_buf_))) {
+        buflen = static_cast<int>(sizeof(rx_buf_)) - rd_count_;
+    }
     memcpy(&rx_buf_[rd_count_], buf, buflen);
     rd_count_ += buflen;
     if (rd_count_ < wait_bytes_) {
@@ -58,11 +58,23 @@ public:
     /** ITap interface */
     virtual int read(uint64_t addr, int bytes, uint8_t *obuf);
     virtual int write(uint64_t addr, int bytes, uint8_t *ibuf);
+    virtual int batch(TapOperationType *ops, int cnt);
 
     /** IRawListener interface */
     virtual int updateData(const char *buf, int buflen);
 
 private:
+    int writeUnaligned(TapOperationType *op);
+    int flushPacket();
+
+private:
+    /** Part of the batched read operation placed into the packet */
+    struct ReadSliceType {
+        TapOperationType *op;
+        uint64_t addr;
+        int len;
+    };
+
     AttributeType timeout_;
     AttributeType port_;
 
@@ -72,6 +84,10 @@ private:
     int rd_count_;
     int req_count_;
     int wait_bytes_;
+    int pkt_len_;
+    int pkt_write_;
+    ReadSliceType slice_[UART_MST_BURST_WORD_MAX];
+    int slice_cnt_;
     uint8_t rx_buf_[UART_MST_BURST_BYTES_MAX + 16];
 };
 
@@ -16,23 +16,132 @@
 
 #include "elfreader.h"
 #include <iostream>
+#include <stdlib.h>
 
 namespace debugger {
 
+/** DWARF line number program opcodes (versions 2 - 5) */
+enum EDwarfLineOpcode {
+    DW_LNS_extended_op,
+    DW_LNS_copy,
+    DW_LNS_advance_pc,
+    DW_LNS_advance_line,
+    DW_LNS_set_file,
+    DW_LNS_set_column,
+    DW_LNS_negate_stmt,
+    DW_LNS_set_basic_block,
+    DW_LNS_const_add_pc,
+    DW_LNS_fixed_advance_pc
+};
+
+enum EDwarfLineExtOpcode {
+    DW_LNE_end_sequence = 1,
+    DW_LNE_set_address,
+    DW_LNE_define_file
+};
+
+/** DWARF 5 directory and file name entry formats */
+enum EDwarfLineContent {
+    DW_LNCT_path = 1,
+    DW_LNCT_directory_index
+};
+
+enum EDwarfForm {
+    DW_FORM_data2 = 0x05,
+    DW_FORM_data4 = 0x06,
+    DW_FORM_data8 = 0x07,
+    DW_FORM_string = 0x08,
+    DW_FORM_block = 0x09,
+    DW_FORM_data1 = 0x0b,
+    DW_FORM_strp = 0x0e,
+    DW_FORM_udata = 0x0f,
+    DW_FORM_data16 = 0x1e,
+    DW_FORM_line_strp = 0x1f
+};
+
+static const int DWARF_LINE_FILES_MAX = 4096;
+static const int DWARF_LINE_DIRS_MAX = 256;
+static const int DWARF_ENTRY_FORMAT_MAX = 16;
+
+static uint64_t readUleb(const uint8_t **p, const uint8_t *end) {
+    uint64_t ret = 0;
+    int shift = 0;
+    while (*p < end) {
+        uint8_t b = *(*p)++;
+        if (shift < 64) {
+            ret |= static_cast<uint64_t>(b & 0x7F) << shift;
+        }
+        shift += 7;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    return ret;
+}
+
+static int64_t readSleb(const uint8_t **p, const uint8_t *end) {
+    int64_t ret = 0;
+    int shift = 0;
+    uint8_t b = 0;
+    while (*p < end) {
+        b = *(*p)++;
+        if (shift < 64) {
+            ret |= static_cast<int64_t>(b & 0x7F) << shift;
+        }
+        shift += 7;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    if (shift < 64 && (b & 0x40)) {
+        ret |= -(static_cast<int64_t>(1) << shift);
+    }
+    return ret;
+}
+
+static uint64_t readLe(const uint8_t **p, int bytes) {
+    uint64_t ret = 0;
+    for (int i = 0; i < bytes; i++) {
+        ret |= static_cast<uint64_t>((*p)[i]) << (8 * i);
+    }
+    *p += bytes;
+    return ret;
+}
+
+static int cmpSourceLine(const void *a, const void *b) {
+    const SourceLineType *la = static_cast<const SourceLineType *>(a);
+    const SourceLineType *lb = static_cast<const SourceLineType *>(b);
+    if (la->addr != lb->addr) {
+        return la->addr < lb->addr ? -1 : 1;
+    }
+    return 0;
+}
+
 ElfReaderService::ElfReaderService(const char *name) : IService(name) {
     registerInterface(static_cast<IElfReader *>(this));
     registerAttribute("SourceProc", &sourceProc_);
     image_ = NULL;
+    imageSize_ = 0;
+    header_ = NULL;
+    sh_tbl_ = NULL;
     sectionNames_ = NULL;
     symbolList_.make_list(0);
     loadSectionList_.make_list(0);
     sourceProc_.make_string("");
+    sourceFiles_.make_list(0);
     isrc_ = 0;
+    lines_ = 0;
+    lineCnt_ = 0;
+    lineMax_ = 0;
+    lineUnitsSkipped_ = 0;
+    segments_ = 0;
+    segmentCnt_ = 0;
 }
 
 ElfReaderService::~ElfReaderService() {
-    if (image_) {
-        delete image_;
+    freeImage();
+    if (lines_) {
+        delete [] lines_;
     }
 }
 
@@ -46,6 +155,10 @@ void ElfReaderService::postinitService() {
     }
 }
 
+/**
+ * File is mapped instead of reading, so that the loadable data are
+ * accessed directly in the mapping without copying.
+ */
 int ElfReaderService::readFile(const char *filename) {
     FILE *fp = fopen(filename, "rb");
     if (!fp) {
@@ -53,27 +166,33 @@ int ElfReaderService::readFile(const char *filename) {
         return -1;
     }
     fseek(fp, 0, SEEK_END);
-    int sz = ftell(fp);
-    rewind(fp);
+    uint64_t sz = static_cast<uint64_t>(ftell(fp));
+    fclose(fp);
 
-    if (image_) {
-        delete image_;
-        sectionNames_ = NULL;
-        sourceProc_.make_list(0);
-        symbolList_.make_list(0);
-        loadSectionList_.make_list(0);
+    freeImage();
+    sectionNames_ = NULL;
+    symbolList_.make_list(0);
+    loadSectionList_.make_list(0);
+    sourceFiles_.make_list(0);
+    lineCnt_ = 0;
+    lineUnitsSkipped_ = 0;
+    if (sz == 0) {
+        RISCV_error("File '%s' is empty", filename);
+        return -1;
+    }
+    image_ = static_cast<uint8_t *>(RISCV_file_map(filename, 0, sz));
+    if (image_ == 0) {
+        return -1;
     }
-    image_ = new uint8_t[sz];
-    fread(image_, 1, sz, fp);
+    imageSize_ = sz;
 
     if (readElfHeader() != 0) {
-        fclose(fp);
         return 0;
     }
+    loadSegments();
 
     symbolNames_ = 0;
     if (!header_->get_shoff()) {
-        fclose(fp);
         return 0;
     }
 
@@ -123,16 +242,40 @@ int ElfReaderService::readFile(const char *filename) {
         printf("err: section .strtab not found. No debug symbols.\n");
     }
 
-    /** Direct loading via tap interface: */
     int bytes_loaded = loadSections();
     RISCV_info("Loaded: %d B", bytes_loaded);
+    return 0;
+}
 
-    if (header_->get_phoff()) {
-        //readProgramHeader();
+void ElfReaderService::freeImage() {
+    if (sh_tbl_) {
+        for (int i = 0; i < header_->get_shnum(); i++) {
+            delete sh_tbl_[i];
+        }
+        delete [] sh_tbl_;
+        sh_tbl_ = NULL;
+    }
+    if (header_) {
+        delete header_;
+        header_ = NULL;
+    }
+    if (segments_) {
+        delete [] segments_;
+        segments_ = 0;
     }
+    segmentCnt_ = 0;
+    if (image_) {
+        RISCV_file_unmap(image_, imageSize_);
+        image_ = NULL;
+    }
+}
 
-    fclose(fp);
-    return 0;
+uint8_t *ElfReaderService::sectionData(unsigned idx) {
+    AttributeType &sec = loadSectionList_[idx];
+    if (sec[LoadSh_type].to_uint32() == SHT_NOBITS) {
+        return NULL;
+    }
+    return &image_[sec[LoadSh_offset].to_uint64()];
 }
 
 int ElfReaderService::readElfHeader() {
@@ -144,8 +287,41 @@ int ElfReaderService::readElfHeader() {
     return -1;
 }
 
+void ElfReaderService::loadSegments() {
+    if (!header_->get_phoff() || header_->get_phnum() == 0) {
+        return;
+    }
+    uint64_t phsz = header_->isElf32() ? sizeof(Elf32_Phdr)
+                                       : sizeof(Elf64_Phdr);
+    if (header_->get_phoff() + header_->get_phnum() * phsz > imageSize_) {
+        RISCV_error("Wrong program header table", NULL);
+        return;
+    }
+    segments_ = new LoadSegmentType[header_->get_phnum()];
+    uint8_t *pph = &image_[header_->get_phoff()];
+    for (int i = 0; i < header_->get_phnum(); i++, pph += phsz) {
+        ProgramHeaderType ph(pph, header_);
+        if (ph.get_type() != PT_LOAD || ph.get_memsz() == 0) {
+            continue;
+        }
+        if (ph.get_offset() + ph.get_filesz() > imageSize_
+            || ph.get_filesz() > ph.get_memsz()) {
+            RISCV_error("Wrong segment %d", i);
+            continue;
+        }
+        LoadSegmentType *seg = &segments_[segmentCnt_++];
+        seg->addr = ph.get_paddr();
+        seg->filesz = ph.get_filesz();
+        seg->memsz = ph.get_memsz();
+        seg->data = &image_[ph.get_offset()];
+    }
+}
+
 int ElfReaderService::loadSections() {
     SectionHeaderType *sh;
+    SectionHeaderType *debug_line = 0;
+    SectionHeaderType *debug_line_str = 0;
+    SectionHeaderType *debug_str = 0;
     uint64_t total_bytes = 0;
     AttributeType tsymb;
 
@@ -180,8 +356,8 @@ int ElfReaderService::loadSections() {
             }
             loadsec[LoadSh_addr].make_uint64(sh->get_addr());
             loadsec[LoadSh_size].make_uint64(sh->get_size());
-            loadsec[LoadSh_data].make_data(static_cast<unsigned>(sh->get_size()),
-                                           &image_[sh->get_offset()]);
+            loadsec[LoadSh_offset].make_uint64(sh->get_offset());
+            loadsec[LoadSh_type].make_uint64(sh->get_type());
             loadSectionList_.add_to_list(&loadsec);
             total_bytes += sh->get_size();
         } else if (sh->get_type() == SHT_NOBITS
@@ -202,15 +378,27 @@ int ElfReaderService::loadSections() {
             }
             loadsec[LoadSh_addr].make_uint64(sh->get_addr());
             loadsec[LoadSh_size].make_uint64(sh->get_size());
-            loadsec[LoadSh_data].make_data(static_cast<unsigned>(sh->get_size()));
-            memset(loadsec[LoadSh_data].data(), 
-                        0, static_cast<size_t>(sh->get_size()));
+            loadsec[LoadSh_offset].make_uint64(sh->get_offset());
+            loadsec[LoadSh_type].make_uint64(sh->get_type());
             loadSectionList_.add_to_list(&loadsec);
             total_bytes += sh->get_size();
         } else if (sh->get_type() == SHT_SYMTAB || sh->get_type() == SHT_DYNSYM) {
             processDebugSymbol(sh);
+        } else if (sectionNames_ && sh->get_type() == SHT_PROGBITS
+            && strcmp(&sectionNames_[sh->get_name()], ".debug_line") == 0) {
+            debug_line = sh;
+        } else if (sectionNames_ && sh->get_type() == SHT_PROGBITS
+            && strcmp(&sectionNames_[sh->get_name()],
+                      ".debug_line_str") == 0) {
+            debug_line_str = sh;
+        } else if (sectionNames_ && sh->get_type() == SHT_PROGBITS
+            && strcmp(&sectionNames_[sh->get_name()], ".debug_str") == 0) {
+            debug_str = sh;
         }
     }
+    if (debug_line) {
+        processDebugLine(debug_line, debug_line_str, debug_str);
+    }
     symbolList_.sort(LoadSh_name);
     if (isrc_) {
         isrc_->addSymbols(&symbolList_);
@@ -268,4 +456,347 @@ void ElfReaderService::processDebugSymbol(SectionHeaderType *sh) {
     }
 }
 
+bool ElfReaderService::isExecAddress(uint64_t addr) {
+    SectionHeaderType *sh;
+    for (int i = 0; i < header_->get_shnum(); i++) {
+        sh = sh_tbl_[i];
+        if ((sh->get_flags() & (SHF_ALLOC | SHF_EXECINSTR))
+                != (SHF_ALLOC | SHF_EXECINSTR)) {
+            continue;
+        }
+        if (addr >= sh->get_addr() && addr < sh->get_addr() + sh->get_size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t ElfReaderService::sourceFileIndex(const char *dir,
+                                           const char *name) {
+    char tpath[4096];
+    if (dir && name[0] != '/' && name[0] != '\\' && name[1] != ':') {
+        RISCV_sprintf(tpath, sizeof(tpath), "%s/%s", dir, name);
+    } else {
+        RISCV_sprintf(tpath, sizeof(tpath), "%s", name);
+    }
+    // Several compilation units share headers
+    for (unsigned i = 0; i < sourceFiles_.size(); i++) {
+        if (strcmp(sourceFiles_[i].to_string(), tpath) == 0) {
+            return i;
+        }
+    }
+    AttributeType t1(tpath);
+    sourceFiles_.add_to_list(&t1);
+    return sourceFiles_.size() - 1;
+}
+
+void ElfReaderService::addSourceLine(uint64_t addr, uint32_t file,
+                                     uint32_t line) {
+    // Sequences of the discarded functions are linked at zero address
+    if (!isExecAddress(addr)) {
+        return;
+    }
+    if (lineCnt_ == lineMax_) {
+        lineMax_ = lineMax_ ? 2 * lineMax_ : 4096;
+        SourceLineType *t = new SourceLineType[lineMax_];
+        if (lines_) {
+            memcpy(t, lines_, lineCnt_ * sizeof(SourceLineType));
+            delete [] lines_;
+        }
+        lines_ = t;
+    }
+    lines_[lineCnt_].addr = addr;
+    lines_[lineCnt_].file = file;
+    lines_[lineCnt_].line = line;
+    lineCnt_++;
+}
+
+/** String of .debug_str or .debug_line_str section, 0 if out of range */
+const char *ElfReaderService::debugString(SectionHeaderType *sh,
+                                          uint64_t off) {
+    if (!sh || off >= sh->get_size()) {
+        return 0;
+    }
+    return reinterpret_cast<const char *>(&image_[sh->get_offset() + off]);
+}
+
+/**
+ * Entry of the DWARF 5 directory or file name table described by pairs
+ * (content type, form). Only the path and the directory index are used,
+ * other content is skipped. Returns false on unsupported form.
+ */
+bool ElfReaderService::readLineEntry(const uint8_t **p, const uint8_t *end,
+                                     const uint64_t *fmt, int fmt_cnt,
+                                     int offsz, SectionHeaderType *line_str,
+                                     SectionHeaderType *str,
+                                     const char **path, uint64_t *dir_idx) {
+    *path = 0;
+    *dir_idx = 0;
+    for (int i = 0; i < fmt_cnt; i++) {
+        uint64_t v = 0;
+        const char *sv = 0;
+        switch (fmt[2*i + 1]) {
+        case DW_FORM_string:
+            sv = reinterpret_cast<const char *>(*p);
+            while (*p < end && **p) {
+                (*p)++;
+            }
+            (*p)++;
+            break;
+        case DW_FORM_line_strp:
+            sv = debugString(line_str, readLe(p, offsz));
+            break;
+        case DW_FORM_strp:
+            sv = debugString(str, readLe(p, offsz));
+            break;
+        case DW_FORM_udata:
+            v = readUleb(p, end);
+            break;
+        case DW_FORM_data1:
+            v = readLe(p, 1);
+            break;
+        case DW_FORM_data2:
+            v = readLe(p, 2);
+            break;
+        case DW_FORM_data4:
+            v = readLe(p, 4);
+            break;
+        case DW_FORM_data8:
+            v = readLe(p, 8);
+            break;
+        case DW_FORM_data16:
+            *p += 16;
+            break;
+        case DW_FORM_block:
+            v = readUleb(p, end);
+            *p += v;
+            break;
+        default:
+            return false;
+        }
+        if (*p > end) {
+            return false;
+        }
+        if (fmt[2*i] == DW_LNCT_path) {
+            if (!sv) {
+                return false;
+            }
+            *path = sv;
+        } else if (fmt[2*i] == DW_LNCT_directory_index) {
+            *dir_idx = v;
+        }
+    }
+    return *path != 0;
+}
+
+/**
+ * Decode line number programs of all compilation units (DWARF 2 - 5) into
+ * the single address sorted table used by the coverage and source views.
+ * Units that can't be decoded are counted, so the coverage report isn't
+ * silently incomplete.
+ */
+void ElfReaderService::processDebugLine(SectionHeaderType *sh,
+                                        SectionHeaderType *line_str,
+                                        SectionHeaderType *str) {
+    const uint8_t *p = &image_[sh->get_offset()];
+    const uint8_t *sec_end = p + sh->get_size();
+    uint32_t *files = new uint32_t[DWARF_LINE_FILES_MAX];
+    const char *dirs[DWARF_LINE_DIRS_MAX];
+    uint64_t fmt[2*DWARF_ENTRY_FORMAT_MAX];
+
+    if (header_->isElfMsb()) {
+        RISCV_info("%s", "Line info of big-endian ELF isn't supported");
+        delete [] files;
+        return;
+    }
+
+    while (p + 4 < sec_end) {
+        const uint8_t *unit_end, *prog;
+        uint64_t unit_len, hdr_len;
+        int offsz = 4;
+        unit_len = readLe(&p, 4);
+        if (unit_len == 0xFFFFFFFFull) {
+            offsz = 8;
+            unit_len = readLe(&p, 8);
+        }
+        unit_end = p + unit_len;
+        if (unit_end > sec_end || unit_len < 16) {
+            RISCV_error("Wrong .debug_line unit length %" RV_PRI64 "d",
+                        unit_len);
+            lineUnitsSkipped_++;
+            break;
+        }
+        int version = static_cast<int>(readLe(&p, 2));
+        if (version == 5) {
+            p += 2;             // address_size, segment_selector_size
+        }
+        hdr_len = readLe(&p, offsz);
+        prog = p + hdr_len;
+        if (version < 2 || version > 5 || prog > unit_end) {
+            RISCV_error("Unsupported .debug_line unit version %d", version);
+            lineUnitsSkipped_++;
+            p = unit_end;
+            continue;
+        }
+        int min_inst_len = *p++;
+        if (version >= 4) {
+            p++;                // maximum_operations_per_instruction
+        }
+        int default_is_stmt = *p++;
+        int line_base = static_cast<int8_t>(*p++);
+        int line_range = *p++;
+        int opcode_base = *p++;
+        const uint8_t *std_len = p;
+        p += opcode_base - 1;
+        (void)default_is_stmt;
+
+        int dir_cnt = 0;
+        int file_cnt = 0;
+        uint64_t file_base = 1;     // first file index of the program
+        if (version >= 5) {
+            // Directory 0 and file 0 are the compilation unit ones
+            const char *name;
+            uint64_t dir_idx, cnt;
+            bool ok = true;
+            file_base = 0;
+            for (int tbl = 0; tbl < 2 && ok; tbl++) {
+                int fmt_cnt = *p++;
+                if (fmt_cnt > DWARF_ENTRY_FORMAT_MAX) {
+                    ok = false;
+                    break;
+                }
+                for (int i = 0; i < 2*fmt_cnt; i++) {
+                    fmt[i] = readUleb(&p, prog);
+                }
+                cnt = readUleb(&p, prog);
+                for (uint64_t i = 0; i < cnt; i++) {
+                    if (!readLineEntry(&p, prog, fmt, fmt_cnt, offsz,
+                                       line_str, str, &name, &dir_idx)) {
+                        ok = false;
+                        break;
+                    }
+                    if (tbl == 0) {
+                        if (dir_cnt < DWARF_LINE_DIRS_MAX) {
+                            dirs[dir_cnt++] = name;
+                        }
+                    } else if (file_cnt < DWARF_LINE_FILES_MAX) {
+                        files[file_cnt++] = sourceFileIndex(
+                            dir_idx < static_cast<uint64_t>(dir_cnt)
+                                ? dirs[dir_idx] : 0, name);
+                    }
+                }
+            }
+            if (!ok) {
+                RISCV_error("Unsupported .debug_line v5 entry format", NULL);
+                lineUnitsSkipped_++;
+                p = unit_end;
+                continue;
+            }
+        } else {
+            while (p < prog && *p) {
+                const char *dir = reinterpret_cast<const char *>(p);
+                if (dir_cnt < DWARF_LINE_DIRS_MAX) {
+                    dirs[dir_cnt++] = dir;
+                }
+                p += strlen(dir) + 1;
+            }
+            p++;
+            while (p < prog && *p) {
+                const char *name = reinterpret_cast<const char *>(p);
+                p += strlen(name) + 1;
+                uint64_t dir_idx = readUleb(&p, prog);
+                readUleb(&p, prog);     // modification time
+                readUleb(&p, prog);     // file length
+                if (file_cnt < DWARF_LINE_FILES_MAX) {
+                    files[file_cnt++] = sourceFileIndex(
+                        dir_idx && dir_idx <= static_cast<uint64_t>(dir_cnt)
+                            ? dirs[dir_idx - 1] : 0, name);
+                }
+            }
+        }
+        if (line_range == 0) {
+            p = unit_end;
+            continue;
+        }
+
+        // State machine registers
+        uint64_t addr = 0;
+        uint64_t file = 1;
+        int64_t line = 1;
+        p = prog;
+        while (p < unit_end) {
+            int op = *p++;
+            if (op >= opcode_base) {
+                int adj = op - opcode_base;
+                addr += (adj / line_range) * min_inst_len;
+                line += line_base + adj % line_range;
+                if (file - file_base < static_cast<uint64_t>(file_cnt)) {
+                    addSourceLine(addr, files[file - file_base],
+                                  static_cast<uint32_t>(line));
+                }
+                continue;
+            }
+            switch (op) {
+            case DW_LNS_extended_op: {
+                uint64_t len = readUleb(&p, unit_end);
+                const uint8_t *next = p + len;
+                if (len == 0 || next > unit_end) {
+                    p = unit_end;
+                    break;
+                }
+                int sub = *p++;
+                if (sub == DW_LNE_end_sequence) {
+                    addr = 0;
+                    file = 1;
+                    line = 1;
+                } else if (sub == DW_LNE_set_address && len <= 9) {
+                    addr = readLe(&p, static_cast<int>(len - 1));
+                } else if (sub == DW_LNE_define_file) {
+                    const char *name = reinterpret_cast<const char *>(p);
+                    if (file_cnt < DWARF_LINE_FILES_MAX) {
+                        files[file_cnt++] = sourceFileIndex(0, name);
+                    }
+                }
+                p = next;
+                break;
+            }
+            case DW_LNS_copy:
+                if (file - file_base < static_cast<uint64_t>(file_cnt)) {
+                    addSourceLine(addr, files[file - file_base],
+                                  static_cast<uint32_t>(line));
+                }
+                break;
+            case DW_LNS_advance_pc:
+                addr += readUleb(&p, unit_end) * min_inst_len;
+                break;
+            case DW_LNS_advance_line:
+                line += readSleb(&p, unit_end);
+                break;
+            case DW_LNS_set_file:
+                file = readUleb(&p, unit_end);
+                break;
+            case DW_LNS_const_add_pc:
+                addr += ((255 - opcode_base) / line_range) * min_inst_len;
+                break;
+            case DW_LNS_fixed_advance_pc:
+                addr += readLe(&p, 2);
+                break;
+            default:
+                // set_column, set_isa and unknown standard opcodes
+                for (int i = 0; i < std_len[op - 1]; i++) {
+                    readUleb(&p, unit_end);
+                }
+            }
+        }
+        p = unit_end;
+    }
+    delete [] files;
+
+    if (lineCnt_) {
+        qsort(lines_, lineCnt_, sizeof(SourceLineType), cmpSourceLine);
+    }
+    RISCV_info("Source lines: %d in %d files",
+               lineCnt_, sourceFiles_.size());
+}
+
 }  // namespace debugger
@@ -54,21 +54,52 @@ public:
         return loadSectionList_[idx][LoadSh_size].to_uint64();
     }
 
-    virtual uint8_t *sectionData(unsigned idx)  {
-        return loadSectionList_[idx][LoadSh_data].data();
+    virtual uint8_t *sectionData(unsigned idx);
+
+    virtual unsigned loadableSegmentTotal() { return segmentCnt_; }
+
+    virtual const LoadSegmentType *loadableSegment(unsigned idx) {
+        return &segments_[idx];
+    }
+
+    virtual unsigned sourceLineTotal() { return lineCnt_; }
+
+    virtual const SourceLineType *sourceLine(unsigned idx) {
+        return &lines_[idx];
     }
 
+    virtual unsigned sourceFileTotal() { return sourceFiles_.size(); }
+
+    virtual const char *sourceFileName(unsigned idx) {
+        return sourceFiles_[idx].to_string();
+    }
+
+    virtual unsigned sourceLineUnitsSkipped() { return lineUnitsSkipped_; }
+
 private:
     int readElfHeader();
+    void freeImage();
     int loadSections();
+    void loadSegments();
     void processDebugSymbol(SectionHeaderType *sh);
+    void processDebugLine(SectionHeaderType *sh, SectionHeaderType *line_str,
+                          SectionHeaderType *str);
+    const char *debugString(SectionHeaderType *sh, uint64_t off);
+    bool readLineEntry(const uint8_t **p, const uint8_t *end,
+                       const uint64_t *fmt, int fmt_cnt, int offsz,
+                       SectionHeaderType *line_str, SectionHeaderType *str,
+                       const char **path, uint64_t *dir_idx);
+    void addSourceLine(uint64_t addr, uint32_t file, uint32_t line);
+    uint32_t sourceFileIndex(const char *dir, const char *name);
+    bool isExecAddress(uint64_t addr);
 
 private:
     enum ELoadSectionItem {
         LoadSh_name,
         LoadSh_addr,
         LoadSh_size,
-        LoadSh_data,
+        LoadSh_offset,      // file offset, section data isn't copied
+        LoadSh_type,
         LoadSh_Total,
     };
 
@@ -80,13 +111,21 @@ private:
     AttributeType sourceProc_;
     AttributeType symbolList_;
     AttributeType loadSectionList_;
+    AttributeType sourceFiles_;
 
     ISourceCode *isrc_;
-    uint8_t *image_;
+    uint8_t *image_;        // mapped file
+    uint64_t imageSize_;
     ElfHeaderType *header_;
     SectionHeaderType **sh_tbl_;
     char *sectionNames_;
     char *symbolNames_;
+    SourceLineType *lines_;
+    unsigned lineCnt_;
+    unsigned lineMax_;
+    unsigned lineUnitsSkipped_;
+    LoadSegmentType *segments_;
+    unsigned segmentCnt_;
 };
 
 DECLARE_CLASS(ElfReaderService)
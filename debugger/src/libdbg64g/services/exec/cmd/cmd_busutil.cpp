@@ -77,32 +77,37 @@ void CmdBusUtil::exec(AttributeType *args, AttributeType *res) {
     struct MasterStatType {
         Reg64Type w_cnt;
         Reg64Type r_cnt;
-    } mst_stat;
+    } mst_stat[64];
     Reg64Type cnt_total;
-    addr = DSUREGBASE(udbg.v.clock_cnt);
-    tap_->read(addr, 8, cnt_total.buf);
+    TapOperationType ops[2];
+    ops[0].addr = DSUREGBASE(udbg.v.clock_cnt);
+    ops[0].bytes = 8;
+    ops[0].action = TapAction_Read;
+    ops[0].buf = cnt_total.buf;
+    ops[1].addr = DSUREGBASE(ulocal.v.bus_util);
+    ops[1].bytes = static_cast<int>(mst_total_ * sizeof(MasterStatType));
+    ops[1].action = TapAction_Read;
+    ops[1].buf = mst_stat[0].w_cnt.buf;
+    tap_->batch(ops, 2);
     double d_cnt_total = static_cast<double>(cnt_total.val - clock_cnt_z_);
     if (d_cnt_total == 0) {
         return;
     }
 
-    addr = DSUREGBASE(ulocal.v.bus_util);
     for (unsigned i = 0; i < mst_total_; i++) {
         AttributeType &mst = (*res)[i];
         if (!mst.is_list() || mst.size() != 2) {
             mst.make_list(2);
         }
-        tap_->read(addr, 16, mst_stat.w_cnt.buf);
         mst[0u].make_floating(100.0 *
-            static_cast<double>(mst_stat.w_cnt.val - bus_util_z_[i].w_cnt)
+            static_cast<double>(mst_stat[i].w_cnt.val - bus_util_z_[i].w_cnt)
             / d_cnt_total);
         mst[1].make_floating(100.0 *
-            static_cast<double>(mst_stat.r_cnt.val - bus_util_z_[i].r_cnt)
+            static_cast<double>(mst_stat[i].r_cnt.val - bus_util_z_[i].r_cnt)
             / d_cnt_total);
 
-        bus_util_z_[i].w_cnt = mst_stat.w_cnt.val;
-        bus_util_z_[i].r_cnt = mst_stat.r_cnt.val;
-        addr += 16;
+        bus_util_z_[i].w_cnt = mst_stat[i].w_cnt.val;
+        bus_util_z_[i].r_cnt = mst_stat[i].r_cnt.val;
     }
     clock_cnt_z_ = cnt_total.val;
 }
@@ -79,7 +79,11 @@ void CmdElf2Raw::exec(AttributeType *args, AttributeType *res) {
         if ((waddr + wsz) >= imageSize.to_uint32()) {
             continue;
         }
-        memcpy(&image[waddr], elf->sectionData(i), wsz);
+        if (elf->sectionData(i)) {
+            memcpy(&image[waddr], elf->sectionData(i), wsz);
+        } else {
+            memset(&image[waddr], 0, wsz);
+        }
     }
     FILE *fp = fopen((*args)[2].to_string(), "w");
     fwrite(image, 1, imageSize.to_int(), fp);
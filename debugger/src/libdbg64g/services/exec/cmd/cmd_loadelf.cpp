@@ -17,18 +17,22 @@
 #include "iservice.h"
 #include "cmd_loadelf.h"
 #include "coreservices/ielfreader.h"
+#include "coreservices/icpufunctional.h"
 #include "debug/dsumap.h"
 
 namespace debugger {
 
 CmdLoadElf::CmdLoadElf(ITap *tap) : ICommand ("loadelf", tap) {
+    memList_.make_list(0);
+    backdoor_ = false;
 
     briefDescr_.make_string("Load ELF-file");
     detailedDescr_.make_string(
         "Description:\n"
         "    Load ELF-file to SOC target memory. Optional key 'nocode'\n"
         "    allows to read debug information from the elf-file without\n"
-        "    target programming.\n"
+        "    target programming. Simulated memories are written directly\n"
+        "    bypassing the bus, hardware target is programmed via tap.\n"
         "Usage:\n"
         "    loadelf filename [nocode]\n"
         "Example:\n"
@@ -69,7 +73,10 @@ void CmdLoadElf::exec(AttributeType *args, AttributeType *res) {
     IService *iserv = static_cast<IService *>(lstServ[0u].to_iface());
     IElfReader *elf = static_cast<IElfReader *>(
                         iserv->getInterface(IFACE_ELFREADER));
-    elf->readFile((*args)[1].to_string());
+    if (elf->readFile((*args)[1].to_string()) != 0) {
+        generateError(res, "Can't read file");
+        return;
+    }
 
     if (!program) {
         return;
@@ -79,17 +86,96 @@ void CmdLoadElf::exec(AttributeType *args, AttributeType *res) {
     uint64_t addr = DSUREGBASE(ulocal.v.soft_reset);
     tap_->write(addr, 8, reinterpret_cast<uint8_t *>(&soft_reset));
 
-    uint64_t sec_addr;
-    int sec_sz;
-    for (unsigned i = 0; i < elf->loadableSectionTotal(); i++) {
-        sec_addr = elf->sectionAddress(i);
-        sec_sz = static_cast<int>(elf->sectionSize(i));
-        tap_->write(sec_addr, sec_sz, elf->sectionData(i));
+    memList_.make_list(0);
+    backdoor_ = false;
+    const AttributeType *glb = RISCV_get_global_settings();
+    if ((*glb)["SimEnable"].to_bool()) {
+        RISCV_get_iface_list(IFACE_MEMORY_OPERATION, &memList_);
+    }
+
+    // Program headers define load addresses, sections are used only when
+    // the file has no segments.
+    if (elf->loadableSegmentTotal()) {
+        for (unsigned i = 0; i < elf->loadableSegmentTotal(); i++) {
+            const LoadSegmentType *seg = elf->loadableSegment(i);
+            writeMemory(seg->addr, seg->data, seg->filesz);
+            writeMemory(seg->addr + seg->filesz, 0,
+                        seg->memsz - seg->filesz);
+        }
+    } else {
+        for (unsigned i = 0; i < elf->loadableSectionTotal(); i++) {
+            writeMemory(elf->sectionAddress(i), elf->sectionData(i),
+                        elf->sectionSize(i));
+        }
+    }
+    memList_.make_list(0);
+
+    if (backdoor_) {
+        // Bus snooping was bypassed, drop decoded instructions
+        AttributeType cpulist;
+        RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &cpulist);
+        for (unsigned i = 0; i < cpulist.size(); i++) {
+            static_cast<ICpuFunctional *>(
+                cpulist[i].to_iface())->flush(~0ull);
+        }
     }
 
     //soft_reset = 0;
     //tap_->write(addr, 8, reinterpret_cast<uint8_t *>(&soft_reset));
 }
 
+void CmdLoadElf::writeMemory(uint64_t addr, uint8_t *data, uint64_t sz) {
+    HostMemoryRegionType r;
+    uint8_t zeros[4096];
+    uint64_t len;
+    memset(zeros, 0, sizeof(zeros));
+    while (sz) {
+        if (getHostRegion(addr, &r)) {
+            len = r.addr + r.size - addr;
+            if (len > sz) {
+                len = sz;
+            }
+            if (data) {
+                memcpy(&r.ptr[addr - r.addr], data, static_cast<size_t>(len));
+            } else {
+                memset(&r.ptr[addr - r.addr], 0, static_cast<size_t>(len));
+            }
+            backdoor_ = true;
+        } else if (data) {
+            len = sz;
+            tap_->write(addr, static_cast<int>(len), data);
+        } else {
+            len = sz < sizeof(zeros) ? sz : sizeof(zeros);
+            tap_->write(addr, static_cast<int>(len), zeros);
+        }
+        addr += len;
+        sz -= len;
+        if (data) {
+            data += len;
+        }
+    }
+}
+
+/**
+ * Memories and buses return their own host regions, the smallest one is
+ * limited by the devices mapped over the memory.
+ */
+bool CmdLoadElf::getHostRegion(uint64_t addr, HostMemoryRegionType *r) {
+    HostMemoryRegionType t1;
+    bool found = false;
+    for (unsigned i = 0; i < memList_.size(); i++) {
+        IMemoryOperation *imem =
+            static_cast<IMemoryOperation *>(memList_[i].to_iface());
+        if (!imem->getHostRegion(addr, &t1) || !t1.writable
+            || addr < t1.addr || addr >= t1.addr + t1.size) {
+            continue;
+        }
+        if (!found || t1.size < r->size) {
+            *r = t1;
+            found = true;
+        }
+    }
+    return found;
+}
 
 }  // namespace debugger
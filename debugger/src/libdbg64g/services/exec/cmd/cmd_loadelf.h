@@ -20,6 +20,7 @@
 #include "api_core.h"
 #include "coreservices/itap.h"
 #include "coreservices/icommand.h"
+#include "coreservices/imemop.h"
 
 namespace debugger {
 
@@ -30,6 +31,15 @@ class CmdLoadElf : public ICommand  {
     /** ICommand */
     virtual int isValid(AttributeType *args);
     virtual void exec(AttributeType *args, AttributeType *res);
+
+ private:
+    /** Zero-filled when data is NULL */
+    void writeMemory(uint64_t addr, uint8_t *data, uint64_t sz);
+    bool getHostRegion(uint64_t addr, HostMemoryRegionType *r);
+
+ private:
+    AttributeType memList_;     // simulated memories for the backdoor access
+    bool backdoor_;
 };
 
 }  // namespace debugger
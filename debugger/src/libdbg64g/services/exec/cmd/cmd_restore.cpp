@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "cmd_restore.h"
+#include "iservice.h"
+#include "coreservices/icpufunctional.h"
+#include "coreservices/isnapshot.h"
+
+namespace debugger {
+
+CmdRestore::CmdRestore(ITap *tap) : ICommand ("restore", tap) {
+
+    briefDescr_.make_string("Restore snapshot of the simulated platform");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Restore state of CPUs, memories and devices from the file\n"
+        "    generated by 'save' command with the same configuration.\n"
+        "    Memory pages are loaded on the first access. All CPUs should\n"
+        "    be halted.\n"
+        "Response:\n"
+        "    integer: Number of restored services\n"
+        "Usage:\n"
+        "    restore snapshot-file\n"
+        "Example:\n"
+        "    restore /home/riscv/boot.snap\n");
+}
+
+int CmdRestore::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 2) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdRestore::exec(AttributeType *args, AttributeType *res) {
+    AttributeType cpulist;
+    SnapshotHeaderType hdr;
+    const char *filename = (*args)[1].to_string();
+    res->attr_free();
+    res->make_nil();
+
+    RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &cpulist);
+    for (unsigned i = 0; i < cpulist.size(); i++) {
+        ICpuFunctional *icpu =
+            static_cast<ICpuFunctional *>(cpulist[i].to_iface());
+        if (icpu->isOn() && !icpu->isHalt()) {
+            generateError(res, "Simulation should be halted");
+            return;
+        }
+    }
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        generateError(res, "Can't open file");
+        return;
+    }
+    if (fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)
+        || memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version != SNAPSHOT_VERSION
+        || hdr.section_total > SNAPSHOT_SECTIONS_MAX) {
+        fclose(fp);
+        generateError(res, "Wrong snapshot format or version");
+        return;
+    }
+    SnapshotSectionType *sect = new SnapshotSectionType[hdr.section_total + 1];
+    ISnapshot **isnap = new ISnapshot *[hdr.section_total + 1];
+    size_t rdsz = hdr.section_total * sizeof(SnapshotSectionType);
+    bool valid = fread(sect, 1, rdsz, fp) == rdsz;
+    uint64_t fsz = fileSize(fp);
+    fclose(fp);
+
+    // Check all sections before modifying anything: mapping beyond the
+    // end of file would fault on access
+    for (unsigned i = 0; valid && i < hdr.section_total; i++) {
+        sect[i].name[sizeof(sect[i].name) - 1] = '\0';
+        isnap[i] = static_cast<ISnapshot *>(
+            RISCV_get_service_iface(sect[i].name, IFACE_SNAPSHOT));
+        if (isnap[i] == 0 || sect[i].size == 0
+            || sect[i].offset > fsz || sect[i].size > fsz - sect[i].offset
+            || (sect[i].offset & (SNAPSHOT_ALIGN - 1)) != 0
+            || !isnap[i]->checkSnapshotSize(sect[i].size)) {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        delete [] sect;
+        delete [] isnap;
+        generateError(res, "Snapshot doesn't match configuration");
+        return;
+    }
+
+    unsigned cnt = 0;
+    for (unsigned i = 0; i < hdr.section_total; i++) {
+        uint8_t *buf = static_cast<uint8_t *>(
+            RISCV_file_map(filename, sect[i].offset, sect[i].size));
+        if (buf == 0) {
+            continue;
+        }
+        ESnapshotStatus st = isnap[i]->restoreSnapshot(buf, sect[i].size);
+        if (st != SNAPSHOT_MAPPED) {
+            RISCV_file_unmap(buf, sect[i].size);
+        }
+        if (st != SNAPSHOT_ERROR) {
+            cnt++;
+        }
+    }
+    delete [] sect;
+    delete [] isnap;
+
+    // Drop decoded instructions and host pointers of the previous memory
+    for (unsigned i = 0; i < cpulist.size(); i++) {
+        static_cast<ICpuFunctional *>(cpulist[i].to_iface())->flush(~0ull);
+    }
+    if (cnt != hdr.section_total) {
+        generateError(res, "Snapshot partially restored");
+        return;
+    }
+    res->make_uint64(cnt);
+}
+
+uint64_t CmdRestore::fileSize(FILE *fp) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    if (_fseeki64(fp, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    int64_t sz = _ftelli64(fp);
+#else
+    if (fseeko(fp, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    int64_t sz = static_cast<int64_t>(ftello(fp));
+#endif
+    return sz < 0 ? 0 : static_cast<uint64_t>(sz);
+}
+
+}  // namespace debugger
@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "cmd_save.h"
+#include "iservice.h"
+#include "coreservices/icpufunctional.h"
+#include "coreservices/isnapshot.h"
+
+namespace debugger {
+
+CmdSave::CmdSave(ITap *tap) : ICommand ("save", tap) {
+
+    briefDescr_.make_string("Save snapshot of the simulated platform");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Store state of CPUs, memories and devices into file. All\n"
+        "    CPUs should be halted.\n"
+        "Response:\n"
+        "    integer: Number of stored services\n"
+        "Usage:\n"
+        "    save snapshot-file\n"
+        "Example:\n"
+        "    save /home/riscv/boot.snap\n");
+}
+
+int CmdSave::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 2) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdSave::exec(AttributeType *args, AttributeType *res) {
+    AttributeType cpulist, servlist;
+    res->attr_free();
+    res->make_nil();
+
+    RISCV_get_iface_list(IFACE_CPU_FUNCTIONAL, &cpulist);
+    for (unsigned i = 0; i < cpulist.size(); i++) {
+        ICpuFunctional *icpu =
+            static_cast<ICpuFunctional *>(cpulist[i].to_iface());
+        if (icpu->isOn() && !icpu->isHalt()) {
+            generateError(res, "Simulation should be halted");
+            return;
+        }
+    }
+
+    // Memory of the restored services may be still mapped to the previous
+    // snapshot file, so the new content is stored into another file that
+    // replaces the old one at the end.
+    const char *fname = (*args)[1].to_string();
+    char tmpname[4096];
+    bool ok = true;
+    RISCV_sprintf(tmpname, sizeof(tmpname), "%s.tmp", fname);
+    FILE *fp = fopen(tmpname, "wb");
+    if (!fp) {
+        generateError(res, "Can't open file");
+        return;
+    }
+
+    RISCV_get_services_with_iface(IFACE_SNAPSHOT, &servlist);
+    SnapshotHeaderType hdr;
+    SnapshotSectionType *sect = new SnapshotSectionType[servlist.size() + 1];
+    uint64_t off = sizeof(hdr) + servlist.size() * sizeof(SnapshotSectionType);
+
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.section_total = servlist.size();
+    for (unsigned i = 0; i < servlist.size(); i++) {
+        IService *iserv = static_cast<IService *>(servlist[i].to_iface());
+        ISnapshot *isnap = static_cast<ISnapshot *>(
+                            iserv->getInterface(IFACE_SNAPSHOT));
+        // Each section can be mapped into memory independently
+        off = (off + SNAPSHOT_ALIGN - 1) & ~(SNAPSHOT_ALIGN - 1);
+        memset(sect[i].name, 0, sizeof(sect[i].name));
+        RISCV_sprintf(sect[i].name, sizeof(sect[i].name), "%s",
+                      iserv->getObjName());
+        sect[i].offset = off;
+        sect[i].size = isnap->getSnapshotSize();
+
+        uint8_t *buf = new uint8_t[static_cast<size_t>(sect[i].size) + 1];
+        isnap->saveSnapshot(buf);
+        fseek(fp, static_cast<long>(off), SEEK_SET);
+        if (fwrite(buf, 1, static_cast<size_t>(sect[i].size), fp)
+            != static_cast<size_t>(sect[i].size)) {
+            ok = false;
+        }
+        delete [] buf;
+        off += sect[i].size;
+    }
+    fseek(fp, 0, SEEK_SET);
+    if (fwrite(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)
+        || fwrite(sect, 1, servlist.size() * sizeof(SnapshotSectionType), fp)
+            != servlist.size() * sizeof(SnapshotSectionType)) {
+        ok = false;
+    }
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    delete [] sect;
+    if (!ok) {
+        remove(tmpname);
+        generateError(res, "Can't write file");
+        return;
+    }
+#if defined(_WIN32) || defined(__CYGWIN__)
+    // rename() doesn't replace existing file
+    remove(fname);
+#endif
+    if (rename(tmpname, fname) != 0) {
+        remove(tmpname);
+        generateError(res, "Can't replace file");
+        return;
+    }
+    res->make_uint64(servlist.size());
+}
+
+}  // namespace debugger
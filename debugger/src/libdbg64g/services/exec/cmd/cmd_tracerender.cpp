@@ -0,0 +1,88 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "cmd_tracerender.h"
+#include "iservice.h"
+#include "coreservices/icpufunctional.h"
+
+namespace debugger {
+
+CmdTraceRender::CmdTraceRender(ITap *tap)
+    : ICommand ("tracerender", tap) {
+
+    briefDescr_.make_string("Render binary trace into text file");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Convert binary trace file generated with the 'TraceBinary'\n"
+        "    attribute enabled into the text trace of the specified CPU.\n"
+        "    The first CPU in the configuration is used if the name is\n"
+        "    omitted.\n"
+        "Return:\n"
+        "    Number of rendered instructions.\n"
+        "Usage:\n"
+        "    tracerender [cpu-name] bin-file txt-file\n"
+        "Example:\n"
+        "    tracerender trace_river.bin trace_river.log\n"
+        "    tracerender core0 trace_river.bin trace_river.log\n");
+}
+
+int CmdTraceRender::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 3 || args->size() == 4) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdTraceRender::exec(AttributeType *args, AttributeType *res) {
+    ICpuFunctional *icpu = 0;
+    unsigned fidx = 1;
+    int64_t cnt;
+    res->attr_free();
+    res->make_nil();
+
+    if (args->size() == 4) {
+        icpu = static_cast<ICpuFunctional *>(
+            RISCV_get_service_iface((*args)[1].to_string(),
+                                    IFACE_CPU_FUNCTIONAL));
+        fidx = 2;
+    } else {
+        AttributeType lstServ;
+        RISCV_get_services_with_iface(IFACE_CPU_FUNCTIONAL, &lstServ);
+        if (lstServ.size() != 0) {
+            IService *iserv = static_cast<IService *>(lstServ[0u].to_iface());
+            icpu = static_cast<ICpuFunctional *>(
+                            iserv->getInterface(IFACE_CPU_FUNCTIONAL));
+        }
+    }
+    if (!icpu) {
+        generateError(res, "CPU not found");
+        return;
+    }
+
+    cnt = icpu->renderTrace((*args)[fidx].to_string(),
+                            (*args)[fidx + 1].to_string());
+    if (cnt < 0) {
+        generateError(res, "Can't render trace file");
+        return;
+    }
+    res->make_uint64(static_cast<uint64_t>(cnt));
+}
+
+}  // namespace debugger
@@ -37,6 +37,9 @@
 #include "cmd/cmd_loadbin.h"
 #include "cmd/cmd_elf2raw.h"
 #include "cmd/cmd_cpucontext.h"
+#include "cmd/cmd_save.h"
+#include "cmd/cmd_restore.h"
+#include "cmd/cmd_tracerender.h"
 
 namespace debugger {
 
@@ -86,9 +89,12 @@ void CmdExecutor::postinitService() {
     registerCommand(new CmdRead(itap_));
     registerCommand(new CmdRun(itap_));
     registerCommand(new CmdReset(itap_));
+    registerCommand(new CmdRestore(itap_));
+    registerCommand(new CmdSave(itap_));
     registerCommand(new CmdStack(itap_));
     registerCommand(new CmdStatus(itap_));
     registerCommand(new CmdSymb(itap_));
+    registerCommand(new CmdTraceRender(itap_));
     registerCommand(new CmdWrite(itap_));
 }
 
@@ -40,6 +40,7 @@ CmdDpi::CmdDpi(IService *parent) : ICommand ("dpi", 0) {
         "    dpi time sec\n"
         "    dpi axi4 read 8 0x1000\n"
         "    dpi axi4 write 8 0x1000 0xcafef00d\n"
+        "    dpi diff\n"
         );
 }
 
@@ -76,6 +77,8 @@ void CmdDpi::exec(AttributeType *args, AttributeType *res) {
     }
     else if ((*args)[1].is_equal("clkcnt")) {
         res->make_uint64(p->getHartBeatClkcnt());
+    } else if ((*args)[1].is_equal("diff")) {
+        res->make_uint64(p->getMismatchCnt());
     }
 }
 
@@ -90,11 +93,21 @@ DpiClient::DpiClient(const char *name) : IService(name),
     registerAttribute("Timeout", &timeout_);
     registerAttribute("HostIP", &hostIP_);
     registerAttribute("HostPort", &hostPort_);
+    registerAttribute("StreamMode", &streamMode_);
+    registerAttribute("Outstanding", &outstanding_);
+    registerAttribute("Clock", &clock_);
 
     RISCV_event_create(&event_cmd_, name);
+    char tstr[256];
+    RISCV_sprintf(tstr, sizeof(tstr), "%s_tag", name);
+    RISCV_event_create(&event_tag_, tstr);
     RISCV_mutex_init(&mutex_tx_);
 
-    char tstr[256];
+    timeout_.make_int64(500);
+    streamMode_.make_boolean(false);
+    outstanding_.make_int64(64);
+    clock_.make_string("");
+
     RISCV_sprintf(tstr, sizeof(tstr), "['%s','HartBeat']", name);
     reqHartBeat_.make_string(tstr);
     cmdcnt_ = 0;
@@ -102,11 +115,19 @@ DpiClient::DpiClient(const char *name) : IService(name),
     hsock_ = 0;
     hartbeatTime_ = 0;
     hartbeatClkcnt_ = 0;
+    iexec_ = 0;
+    iclk_ = 0;
+    connected_ = false;
+    stream_rx_ = false;
+    mismatch_cnt_ = 0;
+    window_ = 1;
+    resetStream();
 }
 
 DpiClient::~DpiClient() {
     RISCV_mutex_destroy(&mutex_tx_);
     RISCV_event_close(&event_cmd_);
+    RISCV_event_close(&event_tag_);
 }
 
 void DpiClient::postinitService() {
@@ -120,6 +141,22 @@ void DpiClient::postinitService() {
         iexec_->registerCommand(&cmd_);
     }
 
+    if (clock_.size()) {
+        iclk_ = static_cast<IClock *>(
+            RISCV_get_service_iface(clock_.to_string(), IFACE_CLOCK));
+        if (!iclk_) {
+            RISCV_error("Can't get IClock interface %s",
+                        clock_.to_string());
+        }
+    }
+
+    window_ = outstanding_.to_int();
+    if (window_ <= 0) {
+        window_ = 1;
+    } else if (window_ > STREAM_TAGS_MAX) {
+        window_ = STREAM_TAGS_MAX;
+    }
+
     if (isEnable_.to_bool()) {
         if (!run()) {
             RISCV_error("Can't create thread.", NULL);
@@ -162,9 +199,11 @@ void DpiClient::busyLoop() {
                 RISCV_sleep_ms(2000);
                 continue;
             }
-            connected_ = true;
             cmdcnt_ = 0;
             txcnt_ = 0;
+            stream_rx_ = false;
+            resetStream();
+            connected_ = true;
         }
 
         rxbytes = recv(hsock_, rcvbuf, sizeof(rcvbuf), 0);
@@ -176,7 +215,24 @@ void DpiClient::busyLoop() {
         }
 
         for (int i = 0; i < rxbytes; i++) {
+            if (cmdcnt_ == 0) {
+                stream_rx_ =
+                    static_cast<uint8_t>(rcvbuf[i]) == DPI_STREAM_MARKER;
+            }
+            if (cmdcnt_ >= static_cast<int>(sizeof(cmdbuf_))) {
+                RISCV_error("Rx overflow %d", cmdcnt_);
+                cmdcnt_ = 0;
+                continue;
+            }
             cmdbuf_[cmdcnt_++] = rcvbuf[i];
+            if (stream_rx_) {
+                if (cmdcnt_ ==
+                    static_cast<int>(sizeof(DpiStreamResponseType))) {
+                    processStreamRx();
+                    cmdcnt_ = 0;
+                }
+                continue;
+            }
             if (rcvbuf[i] != '\0') {
                 continue;
             }
@@ -260,6 +316,150 @@ bool DpiClient::syncRequest(const char *buf, unsigned size) {
     return true;
 }
 
+void DpiClient::resetStream() {
+    RISCV_mutex_lock(&mutex_tx_);
+    memset(posted_, 0, sizeof(posted_));
+    tag_wr_ = 0;
+    inflight_ = 0;
+    txframes_ = 0;
+    RISCV_mutex_unlock(&mutex_tx_);
+    RISCV_event_set(&event_tag_);
+}
+
+/**
+ * Append request frame into the Tx buffer without waiting response. The
+ * buffer is flushed each STREAM_FLUSH_FRAMES frames, when the window is
+ * full or by the client thread on the receive timeout.
+ */
+bool DpiClient::postRequest(int we, uint64_t addr, int bytes, uint64_t data,
+                            uint8_t *rbuf, int roff, int rlen) {
+    DpiStreamRequestType req;
+    PostedRequestType *p;
+    uint64_t step = iclk_ ? iclk_->getStepCounter() : 0;
+    bool flush;
+
+    req.marker = DPI_STREAM_MARKER;
+    req.we = static_cast<uint8_t>(we);
+    req.bytes = static_cast<uint32_t>(bytes);
+    req.addr = addr;
+    req.wdata = we ? data : 0;
+
+    while (1) {
+        if (!connected_) {
+            return false;
+        }
+        RISCV_event_clear(&event_tag_);
+        RISCV_mutex_lock(&mutex_tx_);
+        p = &posted_[tag_wr_];
+        if (!p->busy && inflight_ < window_
+            && (txcnt_ + sizeof(req)) < sizeof(txbuf_)) {
+            break;
+        }
+        RISCV_mutex_unlock(&mutex_tx_);
+
+        processTx();
+        if (RISCV_event_wait_ms(&event_tag_, timeout_.to_int()) != 0) {
+            RISCV_error("Stream response timeout, %d requests dropped",
+                        inflight_);
+            resetStream();
+            return false;
+        }
+    }
+
+    // Slot is allocated under the Tx lock to serve several producers
+    p->busy = true;
+    p->we = we;
+    p->addr = addr;
+    p->bytes = bytes;
+    p->expected = data;
+    p->step = step;
+    p->rbuf = rbuf;
+    p->roff = roff;
+    p->rlen = rlen;
+    req.tag = static_cast<uint16_t>(tag_wr_);
+    memcpy(&txbuf_[txcnt_], &req, sizeof(req));
+    txcnt_ += sizeof(req);
+    inflight_++;
+    tag_wr_ = (tag_wr_ + 1) % STREAM_TAGS_MAX;
+    flush = ++txframes_ >= STREAM_FLUSH_FRAMES;
+    if (flush) {
+        txframes_ = 0;
+    }
+    RISCV_mutex_unlock(&mutex_tx_);
+
+    if (flush) {
+        processTx();
+    }
+    return true;
+}
+
+/** Wait all posted requests */
+bool DpiClient::waitStream() {
+    while (1) {
+        RISCV_event_clear(&event_tag_);
+        if (inflight_ == 0) {
+            return true;
+        }
+        if (!connected_) {
+            return false;
+        }
+        processTx();
+        if (RISCV_event_wait_ms(&event_tag_, timeout_.to_int()) != 0
+            && inflight_ != 0) {
+            RISCV_error("Stream response timeout, %d requests dropped",
+                        inflight_);
+            resetStream();
+            return false;
+        }
+    }
+}
+
+void DpiClient::processStreamRx() {
+    DpiStreamResponseType resp;
+    PostedRequestType *p;
+    Reg64Type t;
+    memcpy(&resp, cmdbuf_, sizeof(resp));
+
+    p = &posted_[resp.tag % STREAM_TAGS_MAX];
+    if (!p->busy) {
+        RISCV_error("Unexpected stream response tag %d", resp.tag);
+        return;
+    }
+    if (resp.status != 0) {
+        RISCV_error("DPI error step %" RV_PRI64 "d [%08x]",
+                    p->step, static_cast<unsigned>(p->addr));
+    } else if (!p->we) {
+        t.val = resp.rdata;
+        if (p->rbuf) {
+            memcpy(p->rbuf, &t.buf[p->roff], p->rlen);
+        } else {
+            compareRead(p->step, p->addr, p->bytes, t.val, p->expected);
+        }
+    }
+
+    RISCV_mutex_lock(&mutex_tx_);
+    p->busy = false;
+    inflight_--;
+    RISCV_mutex_unlock(&mutex_tx_);
+    RISCV_event_set(&event_tag_);
+}
+
+void DpiClient::compareRead(uint64_t step, uint64_t addr, int bytes,
+                            uint64_t rdata, uint64_t expected) {
+    uint64_t mask = ~0ull;
+    if (bytes < 8) {
+        mask = (1ull << (8 * bytes)) - 1;
+    }
+    if (((rdata ^ expected) & mask) == 0) {
+        return;
+    }
+    mismatch_cnt_++;
+    RISCV_error("DPI diff step %" RV_PRI64 "d [%08x]: "
+                "%016" RV_PRI64 "x != %016" RV_PRI64 "x",
+                step, static_cast<unsigned>(addr),
+                rdata & mask, expected & mask);
+}
+
 int DpiClient::createServerSocket() {
     struct timeval tv;
     int nodelay = 1;
@@ -364,6 +564,25 @@ void DpiClient::axi4_read(uint64_t addr, int bytes, uint64_t *data) {
     *data = rdata[0u].to_uint64();
 }
 
+void DpiClient::axi4_post_write(uint64_t addr, int bytes, uint64_t data) {
+    if (!streamMode_.to_bool()) {
+        axi4_write(addr, bytes, data);
+        return;
+    }
+    postRequest(1, addr, bytes, data, 0, 0, 0);
+}
+
+void DpiClient::axi4_post_read(uint64_t addr, int bytes, uint64_t expected) {
+    if (!streamMode_.to_bool()) {
+        uint64_t rdata = 0;
+        uint64_t step = iclk_ ? iclk_->getStepCounter() : 0;
+        axi4_read(addr, bytes, &rdata);
+        compareRead(step, addr, bytes, rdata, expected);
+        return;
+    }
+    postRequest(0, addr, bytes, expected, 0, 0, 0);
+}
+
 void DpiClient::msgRead(uint64_t addr, int bytes) {
     tmpsz_ = RISCV_sprintf(tmpbuf_, sizeof(tmpbuf_),
         "["
@@ -431,6 +650,10 @@ void DpiClient::msgWrite(uint64_t addr, int bytes, uint8_t *buf) {
 }
 
 int DpiClient::read(uint64_t addr, int bytes, uint8_t *obuf) {
+    if (streamMode_.to_bool()) {
+        TapOperationType op = {addr, bytes, TapAction_Read, obuf};
+        return batch(&op, 1) == TAP_ERROR ? TAP_ERROR : bytes;
+    }
     uint8_t *pout = obuf;
     int bytes_total = bytes;
     Reg64Type t;
@@ -503,6 +726,10 @@ int DpiClient::read(uint64_t addr, int bytes, uint8_t *obuf) {
 }
 
 int DpiClient::write(uint64_t addr, int bytes, uint8_t *ibuf) {
+    if (streamMode_.to_bool()) {
+        TapOperationType op = {addr, bytes, TapAction_Write, ibuf};
+        return batch(&op, 1) == TAP_ERROR ? TAP_ERROR : bytes;
+    }
     uint8_t *pin = ibuf;
     int bytes_total = bytes;
 
@@ -548,6 +775,48 @@ int DpiClient::write(uint64_t addr, int bytes, uint8_t *ibuf) {
     return bytes;
 }
 
+/**
+ * In stream mode all operations are split on 8-bytes aligned frames and
+ * posted without waiting, so the whole batch costs one round trip.
+ */
+int DpiClient::batch(TapOperationType *ops, int cnt) {
+    if (!streamMode_.to_bool()) {
+        return ITap::batch(ops, cnt);
+    }
+    Reg64Type t;
+    for (int i = 0; i < cnt; i++) {
+        uint64_t addr = ops[i].addr;
+        uint8_t *pbuf = ops[i].buf;
+        int total = ops[i].bytes;
+        int off, sz;
+        bool ok;
+        while (total > 0) {
+            off = static_cast<int>(addr & 0x7);
+            sz = 8 - off;
+            if (sz > total) {
+                sz = total;
+            }
+            if (ops[i].action == TapAction_Read) {
+                ok = postRequest(0, addr - off, 8, 0, pbuf, off, sz);
+            } else {
+                t.val = 0;
+                memcpy(t.buf, pbuf, sz);
+                ok = postRequest(1, addr, sz, t.val, 0, 0, 0);
+            }
+            if (!ok) {
+                return TAP_ERROR;
+            }
+            addr += sz;
+            pbuf += sz;
+            total -= sz;
+        }
+    }
+    if (!waitStream()) {
+        return TAP_ERROR;
+    }
+    return cnt;
+}
+
 bool DpiClient::is_irq() {
     return false;
 }
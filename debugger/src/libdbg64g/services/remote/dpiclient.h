@@ -23,6 +23,7 @@
 #include "coreservices/idpi.h"
 #include "coreservices/icmdexec.h"
 #include "coreservices/itap.h"
+#include "coreservices/iclock.h"
 
 namespace debugger {
 
@@ -40,6 +41,42 @@ class CmdDpi : public ICommand  {
 
 
 
+/**
+ * Stream mode binary framing (StreamMode = true).
+ *
+ * JSON messages are NUL-terminated strings that always start with '[',
+ * binary frames start with DPI_STREAM_MARKER so both kinds of messages
+ * share the same TCP connection. Requests are sent without waiting
+ * responses, up to 'Outstanding' requests are in flight and the
+ * response is matched to the request by tag. Responses may arrive
+ * out of order.
+ *
+ *      request:  marker, we, tag[2], bytes[4], addr[8], wdata[8]
+ *      response: marker, status, tag[2], reserved[4], rdata[8]
+ *
+ * All fields are little-endian, status != 0 means AXI4 error response.
+ */
+static const uint8_t DPI_STREAM_MARKER = 0xA5;
+
+#pragma pack(1)
+struct DpiStreamRequestType {
+    uint8_t marker;
+    uint8_t we;
+    uint16_t tag;
+    uint32_t bytes;
+    uint64_t addr;
+    uint64_t wdata;
+};
+
+struct DpiStreamResponseType {
+    uint8_t marker;
+    uint8_t status;
+    uint16_t tag;
+    uint32_t rsrv;
+    uint64_t rdata;
+};
+#pragma pack()
+
 class DpiClient : public IService,
                   public IThread,
                   public IDpi,
@@ -55,16 +92,20 @@ class DpiClient : public IService,
     /** IDpi */
     virtual void axi4_write(uint64_t addr, int bytes, uint64_t data);
     virtual void axi4_read(uint64_t addr, int bytes, uint64_t *data);
+    virtual void axi4_post_write(uint64_t addr, int bytes, uint64_t data);
+    virtual void axi4_post_read(uint64_t addr, int bytes, uint64_t expected);
     virtual bool is_irq();
     virtual int get_irq();
 
     /** ITap interface */
     virtual int read(uint64_t addr, int bytes, uint8_t *obuf);
     virtual int write(uint64_t addr, int bytes, uint8_t *ibuf);
+    virtual int batch(TapOperationType *ops, int cnt);
 
     /** Common methods */
     double getHartBeatTime() { return hartbeatTime_; }
     uint64_t getHartBeatClkcnt() { return hartbeatClkcnt_; }
+    uint64_t getMismatchCnt() { return mismatch_cnt_; }
 
  protected:
     /** IThread interface */
@@ -81,19 +122,45 @@ class DpiClient : public IService,
     void msgRead(uint64_t addr, int bytes);
     void msgWrite(uint64_t addr, int bytes, uint8_t *buf);
 
+    void resetStream();
+    bool postRequest(int we, uint64_t addr, int bytes, uint64_t data,
+                     uint8_t *rbuf, int roff, int rlen);
+    bool waitStream();
+    void processStreamRx();
+    void compareRead(uint64_t step, uint64_t addr, int bytes,
+                     uint64_t rdata, uint64_t expected);
+
  private:
     static const int BURST_LEN_MAX = 4*8;    // hardcoded in libdpiwrapper
+    static const int STREAM_TAGS_MAX = 256;
+    static const int STREAM_FLUSH_FRAMES = 64;
+
+    struct PostedRequestType {
+        bool busy;
+        int we;
+        uint64_t addr;
+        int bytes;
+        uint64_t expected;
+        uint64_t step;
+        uint8_t *rbuf;      // ITap read destination or 0 to compare
+        int roff;
+        int rlen;
+    };
 
     AttributeType isEnable_;
     AttributeType cmdexec_;
     AttributeType timeout_;
     AttributeType hostIP_;
     AttributeType hostPort_;
+    AttributeType streamMode_;
+    AttributeType outstanding_;
+    AttributeType clock_;
     AttributeType syncResponse_;
     AttributeType reqHartBeat_;
     AttributeType respHartBeat_;
 
     ICmdExecutor *iexec_;
+    IClock *iclk_;
     CmdDpi cmd_;
 
     struct sockaddr_in sockaddr_ipv4_;
@@ -101,6 +168,7 @@ class DpiClient : public IService,
 
     mutex_def mutex_tx_;
     event_def event_cmd_;
+    event_def event_tag_;
     char rcvbuf[4096];
     char cmdbuf_[4096];
     int cmdcnt_;
@@ -113,6 +181,13 @@ class DpiClient : public IService,
     char tmpbuf_[1024];
     int tmpsz_;
 
+    PostedRequestType posted_[STREAM_TAGS_MAX];
+    int tag_wr_;
+    volatile int inflight_;
+    int txframes_;
+    int window_;
+    bool stream_rx_;
+    uint64_t mismatch_cnt_;
 };
 
 DECLARE_CLASS(DpiClient)
@@ -14,42 +14,210 @@
  *  limitations under the License.
  */
 
+#include <stdlib.h>
 #include "gdbcmd.h"
+#include "debug/dsumap.h"
+#include "coreservices/icpuarm.h"
 
 namespace debugger {
-/*
-RspPacket::RspPacket(const char* const c_str) : RspPacket() {
-    append('$');
-    append(c_str);
-    append('#');
-    RISCV_sprintf(&data[size], sizeof(data) - size, "%02x",
-                checksum(c_str, strlen(c_str)));
-    size += 2; // for checksum
-    data[size] = '\0';
-}
 
-void RspPacket::removeCRC(){
-    data[size - 3] = '\0';
-    size -= 3;
-}
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/** x0..x31, pc */
+static const GdbRegisterType RISCV_GDB_REGS[] = {
+    {8, DSUREGBASE(ureg.v.iregs[0])},
+    {8, DSUREGBASE(ureg.v.iregs[1])},
+    {8, DSUREGBASE(ureg.v.iregs[2])},
+    {8, DSUREGBASE(ureg.v.iregs[3])},
+    {8, DSUREGBASE(ureg.v.iregs[4])},
+    {8, DSUREGBASE(ureg.v.iregs[5])},
+    {8, DSUREGBASE(ureg.v.iregs[6])},
+    {8, DSUREGBASE(ureg.v.iregs[7])},
+    {8, DSUREGBASE(ureg.v.iregs[8])},
+    {8, DSUREGBASE(ureg.v.iregs[9])},
+    {8, DSUREGBASE(ureg.v.iregs[10])},
+    {8, DSUREGBASE(ureg.v.iregs[11])},
+    {8, DSUREGBASE(ureg.v.iregs[12])},
+    {8, DSUREGBASE(ureg.v.iregs[13])},
+    {8, DSUREGBASE(ureg.v.iregs[14])},
+    {8, DSUREGBASE(ureg.v.iregs[15])},
+    {8, DSUREGBASE(ureg.v.iregs[16])},
+    {8, DSUREGBASE(ureg.v.iregs[17])},
+    {8, DSUREGBASE(ureg.v.iregs[18])},
+    {8, DSUREGBASE(ureg.v.iregs[19])},
+    {8, DSUREGBASE(ureg.v.iregs[20])},
+    {8, DSUREGBASE(ureg.v.iregs[21])},
+    {8, DSUREGBASE(ureg.v.iregs[22])},
+    {8, DSUREGBASE(ureg.v.iregs[23])},
+    {8, DSUREGBASE(ureg.v.iregs[24])},
+    {8, DSUREGBASE(ureg.v.iregs[25])},
+    {8, DSUREGBASE(ureg.v.iregs[26])},
+    {8, DSUREGBASE(ureg.v.iregs[27])},
+    {8, DSUREGBASE(ureg.v.iregs[28])},
+    {8, DSUREGBASE(ureg.v.iregs[29])},
+    {8, DSUREGBASE(ureg.v.iregs[30])},
+    {8, DSUREGBASE(ureg.v.iregs[31])},
+    {8, DSUREGBASE(ureg.v.pc)}
+};
+
+static const char RISCV_TARGET_XML[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<architecture>riscv:rv64</architecture>"
+    "<feature name=\"org.gnu.gdb.riscv.cpu\">"
+    "<reg name=\"zero\" bitsize=\"64\" type=\"int\" regnum=\"0\"/>"
+    "<reg name=\"ra\" bitsize=\"64\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"gp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"tp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"t0\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t1\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t2\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"fp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"s1\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a0\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a1\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a2\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a3\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a4\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a5\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a6\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a7\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s2\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s3\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s4\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s5\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s6\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s7\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s8\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s9\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s10\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s11\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t3\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t4\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t5\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t6\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"pc\" bitsize=\"64\" type=\"code_ptr\"/>"
+    "</feature>"
+    "</target>";
+
+/** r0..r15, f0..f7, fps, cpsr: FPA registers aren't implemented */
+static const GdbRegisterType ARM_GDB_REGS[] = {
+    {4, DSUREGBASE(ureg.v.iregs[0])},
+    {4, DSUREGBASE(ureg.v.iregs[1])},
+    {4, DSUREGBASE(ureg.v.iregs[2])},
+    {4, DSUREGBASE(ureg.v.iregs[3])},
+    {4, DSUREGBASE(ureg.v.iregs[4])},
+    {4, DSUREGBASE(ureg.v.iregs[5])},
+    {4, DSUREGBASE(ureg.v.iregs[6])},
+    {4, DSUREGBASE(ureg.v.iregs[7])},
+    {4, DSUREGBASE(ureg.v.iregs[8])},
+    {4, DSUREGBASE(ureg.v.iregs[9])},
+    {4, DSUREGBASE(ureg.v.iregs[10])},
+    {4, DSUREGBASE(ureg.v.iregs[11])},
+    {4, DSUREGBASE(ureg.v.iregs[12])},
+    {4, DSUREGBASE(ureg.v.iregs[13])},
+    {4, DSUREGBASE(ureg.v.iregs[14])},
+    {4, DSUREGBASE(ureg.v.pc)},
+    {12, 0},
+    {12, 0},
+    {12, 0},
+    {12, 0},
+    {12, 0},
+    {12, 0},
+    {12, 0},
+    {12, 0},
+    {4, 0},
+    {4, DSUREGBASE(ureg.v.iregs[16])}
+};
+
+static const char ARM_TARGET_XML[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<architecture>arm</architecture>"
+    "<feature name=\"org.gnu.gdb.arm.core\">"
+    "<reg name=\"r0\" bitsize=\"32\" type=\"uint32\" regnum=\"0\"/>"
+    "<reg name=\"r1\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r2\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r3\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r4\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r5\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r6\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r7\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r8\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r9\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r10\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r11\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"r12\" bitsize=\"32\" type=\"uint32\"/>"
+    "<reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"lr\" bitsize=\"32\"/>"
+    "<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>"
+    "<reg name=\"cpsr\" bitsize=\"32\" regnum=\"25\"/>"
+    "</feature>"
+    "<feature name=\"org.gnu.gdb.arm.fpa\">"
+    "<reg name=\"f0\" bitsize=\"96\" type=\"arm_fpa_ext\" regnum=\"16\"/>"
+    "<reg name=\"f1\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"f2\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"f3\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"f4\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"f5\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"f6\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"f7\" bitsize=\"96\" type=\"arm_fpa_ext\"/>"
+    "<reg name=\"fps\" bitsize=\"32\"/>"
+    "</feature>"
+    "</target>";
 
-void RspPacket::append(const char* c_str){
-    size_t length = strlen(c_str);
-    memcpy(&data[size], c_str, length);
-    size += length;
-}
+GdbCommands::GdbCommands(IService *parent) : TcpCommandsGen(parent) {
+    estate_ = State_AckMode;
 
-uint8_t RspPacket::checksum(const char *data, const size_t sz) {
-    uint8_t sum = 0;
-    for (size_t i = 0; i < sz; i++) {
-        sum += static_cast<unsigned char>(data[i]);
+    // Escaped binary data may be up to twice longer than the packet size
+    delete [] rxbuf_;
+    rxtotal_ = 2 * GDB_PACKET_SIZE + 16;
+    rxbuf_ = new char[rxtotal_];
+    delete [] respbuf_;
+    resptotal_ = 2 * GDB_PACKET_SIZE + 16;
+    respbuf_ = new char[resptotal_];
+
+    packet_data_ = new char[rxtotal_];
+    packet_len_ = 0;
+    membuf_ = new uint8_t[GDB_PACKET_SIZE];
+    txdata_ = new char[2 * GDB_PACKET_SIZE + 4];
+
+    // The same Tap interface as used by the commands executor
+    itap_ = 0;
+    IService *iexecserv = static_cast<IService *>(
+                        RISCV_get_service(executor_.to_string()));
+    if (iexecserv) {
+        AttributeType *tap = static_cast<AttributeType *>(
+                        iexecserv->getAttribute("Tap"));
+        if (tap && tap->is_string()) {
+            itap_ = static_cast<ITap *>(
+                RISCV_get_service_iface(tap->to_string(), IFACE_TAP));
+        }
     }
-    return sum;
+    selectTarget();
 }
-*/
 
-GdbCommands::GdbCommands(IService *parent) : TcpCommandsGen(parent) {
-    estate_ = State_AckMode;
+GdbCommands::~GdbCommands() {
+    delete [] packet_data_;
+    delete [] membuf_;
+    delete [] txdata_;
+}
+
+void GdbCommands::selectTarget() {
+    if (RISCV_get_service_iface(cpu_.to_string(), IFACE_CPU_ARM)) {
+        regs_ = ARM_GDB_REGS;
+        regs_total_ = static_cast<int>(sizeof(ARM_GDB_REGS)
+                                     / sizeof(GdbRegisterType));
+        target_xml_ = ARM_TARGET_XML;
+    } else {
+        regs_ = RISCV_GDB_REGS;
+        regs_total_ = static_cast<int>(sizeof(RISCV_GDB_REGS)
+                                     / sizeof(GdbRegisterType));
+        target_xml_ = RISCV_TARGET_XML;
+    }
 }
 
 int GdbCommands::processCommand(const char *cmdbuf, int bufsz) {
@@ -73,8 +241,9 @@ int GdbCommands::processCommand(const char *cmdbuf, int bufsz) {
     }
 
     // Remove '$' start symbol and CRC at the end
-    memcpy(&packet_data_, &cmdbuf[1], bufsz - 4);
-    packet_data_[bufsz - 4] = '\0';
+    packet_len_ = bufsz - 4;
+    memcpy(packet_data_, &cmdbuf[1], packet_len_);
+    packet_data_[packet_len_] = '\0';
 
     handlePacket(packet_data_);
     return bufsz;
@@ -150,6 +319,9 @@ void GdbCommands::handlePacket(char *data) {
     case 'v' :  // v command.
         handleVCommand();
         break;
+    case 'x' :  // Read memory (binary).
+        handleGetMemoryBinary();
+        break;
     case 'X' :  // Write memory (binary).
         handleWriteMemory();
         break;
@@ -212,10 +384,11 @@ void GdbCommands::handleQuery() {
         sendPacket("");
     } else if (strncmp("qSupported", 
                         packet_data_, strlen("qSupported")) == 0) {
-        /* Report a list of the features we support.
-         * 1000h == 4096
-         * 500h  == 1280 */
-        sendPacket("PacketSize=500;QStartNoAckMode+;vContSupported+");
+        /* Report a list of the features we support. */
+        char tstr[128];
+        RISCV_sprintf(tstr, sizeof(tstr), "PacketSize=%x;QStartNoAckMode+;"
+                      "qXfer:features:read+;vContSupported+", GDB_PACKET_SIZE);
+        sendPacket(tstr);
         //QNonStop+
     } else if (strncmp("qSymbol:", packet_data_, strlen("qSymbol:")) == 0) {
         /* Offer to look up symbols. Ignore for now */
@@ -230,8 +403,11 @@ void GdbCommands::handleQuery() {
     } else if (strncmp("qTStatus", packet_data_, strlen("qTStatus")) == 0) {
         /* Don't support tracing, return empty packet. */
         sendPacket("");
+    } else if (strncmp("qXfer:features:read:", packet_data_,
+                       strlen("qXfer:features:read:")) == 0) {
+        handleQueryXfer();
     } else if (strncmp("qXfer:", packet_data_, strlen("qXfer:")) == 0) {
-        /* No 'qXfer' requests supported, return empty packet. */
+        /* Other 'qXfer' objects aren't supported, return empty packet. */
         sendPacket("");
     } else {
         RISCV_error("Unrecognized RSP query: %s \n", packet_data_);
@@ -260,57 +436,149 @@ void GdbCommands::handleDetach() {
     sendPacket("OK");
 }
 
-void GdbCommands::appendRegValue(char *s, uint32_t value) {
-    char byte_hex[3];
+/**
+ * Target description: qXfer:features:read:target.xml:offset,length
+ */
+void GdbCommands::handleQueryXfer() {
+    const char *annex = &packet_data_[strlen("qXfer:features:read:")];
+    const char *args = strchr(annex, ':');
+    uint64_t offset;
+    int len;
+    if (!args || strncmp(annex, "target.xml:", strlen("target.xml:")) != 0) {
+        sendPacket("E00");
+        return;
+    }
+    if (!parseAddrLen(args + 1, &offset, &len, 0)) {
+        sendPacket("E01");
+        return;
+    }
+    uint64_t total = strlen(target_xml_);
+    if (offset >= total) {
+        sendPacket("l");
+        return;
+    }
+    if (static_cast<uint64_t>(len) > total - offset) {
+        len = static_cast<int>(total - offset);
+    }
+    sendBinaryPacket(offset + len < total ? 'm' : 'l',
+        reinterpret_cast<const uint8_t *>(&target_xml_[offset]), len);
+}
 
-    RISCV_sprintf(byte_hex, 3, "%02X", value & 0xFF);
-    strncat(s, byte_hex, 2);
-    RISCV_sprintf(byte_hex, 3, "%02X", (value >> 8) & 0xFF);
-    strncat(s, byte_hex, 2);
-    RISCV_sprintf(byte_hex, 3, "%02X", (value >> 16) & 0xFF);
-    strncat(s, byte_hex, 2);
-    RISCV_sprintf(byte_hex, 3, "%02X", (value >> 24) & 0xFF);
-    strncat(s, byte_hex, 2);
+bool GdbCommands::parseAddrLen(const char *s, uint64_t *addr, int *len,
+                               const char **end) {
+    char *pend;
+    *addr = strtoull(s, &pend, 16);
+    if (pend == s || *pend != ',') {
+        return false;
+    }
+    s = pend + 1;
+    *len = static_cast<int>(strtol(s, &pend, 16));
+    if (pend == s || *len < 0) {
+        return false;
+    }
+    if (end) {
+        *end = pend;
+    }
+    return true;
+}
+
+int GdbCommands::appendHex(char *s, const uint8_t *buf, int sz) {
+    for (int i = 0; i < sz; i++) {
+        *s++ = HEX_DIGITS[buf[i] >> 4];
+        *s++ = HEX_DIGITS[buf[i] & 0xF];
+    }
+    return 2 * sz;
+}
+
+/** Returns number of decoded bytes or -1 on wrong symbol */
+int GdbCommands::parseHex(const char *s, uint8_t *buf, int sz) {
+    int nibble;
+    for (int i = 0; i < 2 * sz; i++) {
+        char c = s[i];
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else {
+            return -1;
+        }
+        if (i & 1) {
+            buf[i >> 1] = static_cast<uint8_t>((buf[i >> 1] << 4) | nibble);
+        } else {
+            buf[i >> 1] = static_cast<uint8_t>(nibble);
+        }
+    }
+    return sz;
+}
+
+int GdbCommands::appendRegister(char *s, int idx, Reg64Type *val) {
+    int sz = regs_[idx].bytes;
+    if (regs_[idx].addr == 0) {
+        memset(s, 'x', 2 * sz);
+        return 2 * sz;
+    }
+    return appendHex(s, val->buf, sz);
 }
 
 void GdbCommands::handleGetRegisters() {
-    char resp[512] = "\0";
-    AttributeType res;
+    Reg64Type *val = new Reg64Type[regs_total_];
+    TapOperationType *ops = new TapOperationType[regs_total_];
+    int cnt = 0;
+    for (int i = 0; i < regs_total_; i++) {
+        val[i].val = 0;
+        if (regs_[i].addr == 0) {
+            continue;
+        }
+        ops[cnt].addr = regs_[i].addr;
+        ops[cnt].bytes = 8;
+        ops[cnt].action = TapAction_Read;
+        ops[cnt].buf = val[i].buf;
+        cnt++;
+    }
 
-    if (iexec_) {
-        iexec_->exec("regs", &res, false);
-    }
-    appendRegValue(resp, res["r0"].to_uint32());
-    appendRegValue(resp, res["r1"].to_uint32());
-    appendRegValue(resp, res["r2"].to_uint32());
-    appendRegValue(resp, res["r3"].to_uint32());
-    appendRegValue(resp, res["r4"].to_uint32());
-    appendRegValue(resp, res["r5"].to_uint32());
-    appendRegValue(resp, res["r6"].to_uint32());
-    appendRegValue(resp, res["r7"].to_uint32());
-    appendRegValue(resp, res["r8"].to_uint32());
-    appendRegValue(resp, res["r9"].to_uint32());
-    appendRegValue(resp, res["r10"].to_uint32());
-    appendRegValue(resp, res["r11"].to_uint32());
-    appendRegValue(resp, res["fp"].to_uint32());
-    appendRegValue(resp, res["sp"].to_uint32());
-    appendRegValue(resp, res["lr"].to_uint32());
-    appendRegValue(resp, res["pc"].to_uint32());
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);  // f0
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 96 / 8 * 2);  // f7
-    strncat(resp, "xxxxxxxxxxxxxxxxxxxxxxxxx", 32 / 8 * 2);  // fps
-    appendRegValue(resp, res["cpsr"].to_uint32());
-    sendPacket(resp);
+    if (!itap_ || itap_->batch(ops, cnt) == TAP_ERROR) {
+        sendPacket("E01");
+    } else {
+        int sz = 0;
+        for (int i = 0; i < regs_total_; i++) {
+            sz += appendRegister(&txdata_[sz], i, &val[i]);
+        }
+        sendPacket(txdata_, sz);
+    }
+    delete [] ops;
+    delete [] val;
 }
 
 void GdbCommands::handleSetRegisters() {
-    sendPacket("");
+    Reg64Type *val = new Reg64Type[regs_total_];
+    TapOperationType *ops = new TapOperationType[regs_total_];
+    const char *p = &packet_data_[1];
+    int cnt = 0;
+    for (int i = 0; i < regs_total_; i++) {
+        int sz = regs_[i].bytes;
+        if (p + 2 * sz > &packet_data_[packet_len_]) {
+            break;
+        }
+        val[i].val = 0;
+        if (regs_[i].addr != 0 && parseHex(p, val[i].buf, sz) == sz) {
+            ops[cnt].addr = regs_[i].addr;
+            ops[cnt].bytes = 8;
+            ops[cnt].action = TapAction_Write;
+            ops[cnt].buf = val[i].buf;
+            cnt++;
+        }
+        p += 2 * sz;
+    }
+
+    if (!itap_ || itap_->batch(ops, cnt) == TAP_ERROR) {
+        sendPacket("E01");
+    } else {
+        sendPacket("OK");
+    }
+    delete [] ops;
+    delete [] val;
 }
 
 void GdbCommands::handleSetThread() {
@@ -330,40 +598,69 @@ void GdbCommands::handleGetMemory() {
      * Lowest address first, encoded as pairs of hex digits.
      * The length given is the number of bytes to be read.
      */
-    unsigned long address;
+    uint64_t address;
     int len;
-    if (RISCV_sscanf(packet_data_, "m%lx,%x:", &address, &len) != 2) {
+    if (!parseAddrLen(&packet_data_[1], &address, &len, 0)) {
         RISCV_info("Failed to recognize RSP read memory command: %s",
                     packet_data_);
         sendPacket("E01");
         return;
     }
-
-    AttributeType res;
-    char tstr[256];
-    RISCV_sprintf(tstr, sizeof(tstr), "read 0x%lx %d", address, len);
-
-    if (iexec_) {
-        iexec_->exec(tstr, &res, false);
+    if (len > GDB_PACKET_SIZE / 2) {
+        len = GDB_PACKET_SIZE / 2;
     }
-
-    uint8_t *bts = res.data();
-    tstr[0] = 0;
-    for (size_t offset = 0; offset < res.size(); offset++) {
-        char byte_hex[3];
-        RISCV_sprintf(byte_hex, sizeof(byte_hex), "%02x", bts[offset]);
-        strncat(tstr, byte_hex, 2);
+    if (!itap_ || itap_->read(address, len, membuf_) == TAP_ERROR) {
+        sendPacket("E01");
+        return;
     }
+    sendPacket(txdata_, appendHex(txdata_, membuf_, len));
+}
 
-    sendPacket(tstr);
+void GdbCommands::handleGetMemoryBinary() {
+    /* Syntax is: x<addr>,<length>
+     * The response is 'b' followed by the escaped binary data.
+     */
+    uint64_t address;
+    int len;
+    if (!parseAddrLen(&packet_data_[1], &address, &len, 0)) {
+        RISCV_info("Failed to recognize RSP read memory command: %s",
+                    packet_data_);
+        sendPacket("E01");
+        return;
+    }
+    if (len > GDB_PACKET_SIZE) {
+        len = GDB_PACKET_SIZE;
+    }
+    if (!itap_ || itap_->read(address, len, membuf_) == TAP_ERROR) {
+        sendPacket("E01");
+        return;
+    }
+    sendBinaryPacket('b', membuf_, len);
 }
 
 void GdbCommands::handleWriteMemoryHex() {
-    sendPacket("");
+    /* Syntax is: M<addr>,<length>:<hex data> */
+    uint64_t address;
+    int len;
+    const char *data;
+    if (!parseAddrLen(&packet_data_[1], &address, &len, &data)
+        || *data != ':' || len > GDB_PACKET_SIZE
+        || 2 * len > packet_len_ - static_cast<int>(data + 1 - packet_data_)
+        || parseHex(data + 1, membuf_, len) != len) {
+        RISCV_info("Failed to recognize RSP write memory %s", packet_data_);
+        sendPacket("E01");
+        return;
+    }
+    if (len && (!itap_ || itap_->write(address, len, membuf_) == TAP_ERROR)) {
+        sendPacket("E01");
+        return;
+    }
+    sendPacket("OK");
 }
 
 void GdbCommands::handleReadRegister() {
     unsigned int regnum;
+    Reg64Type val;
 
     if (RISCV_sscanf(packet_data_, "p%x", &regnum) != 1) {
         RISCV_info("Failed to recognize RSP read register "
@@ -371,61 +668,45 @@ void GdbCommands::handleReadRegister() {
         sendPacket("E01");
         return;
     }
-
-    AttributeType res;
-    if (iexec_) {
-        iexec_->exec("regs", &res, false);
+    if (regnum >= static_cast<unsigned>(regs_total_)) {
+        sendPacket("E01");
+        return;
     }
 
-    char resp[256] = "\0";
-    appendRegValue(resp, res.dict_value(regnum)->to_uint32());
-    sendPacket(resp);
+    val.val = 0;
+    if (regs_[regnum].addr != 0
+        && (!itap_ || itap_->read(regs_[regnum].addr, 8, val.buf)
+            == TAP_ERROR)) {
+        sendPacket("E01");
+        return;
+    }
+    sendPacket(txdata_, appendRegister(txdata_, regnum, &val));
 }
 
 void GdbCommands::handleWriteRegister() {
-    unsigned       regnum;            /* Register index */
-    char           byte0[3];  /* Data to set */
-    char           byte1[3];
-    char           byte2[3];
-    char           byte3[3];
-
-    if (RISCV_sscanf(packet_data_, "P%x=%2s%2s%2s%2s",
-               &regnum, byte0, byte1, byte2, byte3) != 5) {
+    unsigned regnum;            /* Register index */
+    Reg64Type val;
+    const char *data = strchr(packet_data_, '=');
+
+    if (!data || RISCV_sscanf(packet_data_, "P%x=", &regnum) != 1
+        || regnum >= static_cast<unsigned>(regs_total_)) {
         RISCV_info("Failed to recognize RSP write register "
                    "command: %s", packet_data_);
         sendPacket("E01");
         return;
     }
 
-    AttributeType res;
-    char tstr[256];
-
-    /** Hardcode for ARM only */
-    char regname[10] = "\0";
-    if (regnum < 12) {
-        RISCV_sprintf(regname, sizeof(regname), "r%d", regnum);
-    } else if (regnum == 12) {
-        RISCV_sprintf(regname, sizeof(regname), "fp");
-    } else if (regnum == 13) {
-        RISCV_sprintf(regname, sizeof(regname), "sp");
-    } else if (regnum == 14) {
-        RISCV_sprintf(regname, sizeof(regname), "lr");
-    } else if (regnum == 15) {
-        RISCV_sprintf(regname, sizeof(regname), "pc");
-    } else if (regnum == 26) {
-        RISCV_sprintf(regname, sizeof(regname), "cpsr");
-    } else {
-        RISCV_info("Failed to recognize register: %d", regnum);
-        sendPacket("E01");
+    int sz = regs_[regnum].bytes;
+    val.val = 0;
+    if (regs_[regnum].addr == 0) {
+        // Not implemented register, ignore silently
+        sendPacket("OK");
         return;
     }
-
-    RISCV_sprintf(tstr, sizeof(tstr), "reg %s 0x%s%s%s%s",
-                  regname, byte3, byte2, byte1, byte0);
-    RISCV_info("command: %s", tstr);
-
-    if (iexec_) {
-        iexec_->exec(tstr, &res, false);
+    if (parseHex(data + 1, val.buf, sz) != sz || !itap_
+        || itap_->write(regs_[regnum].addr, 8, val.buf) == TAP_ERROR) {
+        sendPacket("E01");
+        return;
     }
     sendPacket("OK");
 }
@@ -473,38 +754,40 @@ void GdbCommands::handleVCommand() {
 }
 
 void GdbCommands::handleWriteMemory() {
-    size_t         len;             /* Number of bytes to write */
-    unsigned long  address;         /* Where to write the memory */
-    const char     *data_ptr;       /* Pointer to the binary data */
-
-    if (RISCV_sscanf(packet_data_, "X%lx,%lx:", &address, &len) != 2) {
+    /* Syntax is: X<addr>,<length>:<binary data>
+     * Symbols '#', '$', '}' and '*' are escaped with '}' and XOR 0x20
+     */
+    uint64_t address;
+    int len;
+    const char *data;
+    if (!parseAddrLen(&packet_data_[1], &address, &len, &data)
+        || *data != ':' || len > GDB_PACKET_SIZE) {
         RISCV_info("Failed to recognize RSP write memory %s",
                    packet_data_);
         sendPacket("E01");
         return;
     }
 
-    data_ptr = static_cast<char*>(memchr(packet_data_, ':', DATA_MAX));
-    data_ptr++;
-    char data_hex[2 * DATA_MAX + 1];
-    data_hex[0] = '\0';
-
-    for (size_t offset = 0; offset < len; offset++) {
-        char byte_hex[3];
-        RISCV_sprintf(byte_hex, sizeof(byte_hex), "%02x", data_ptr[offset]);
-        strncat(data_hex, byte_hex, 2);
+    const char *end = &packet_data_[packet_len_];
+    int cnt = 0;
+    data++;
+    while (data < end && cnt < len) {
+        if (*data == '}' && data + 1 < end) {
+            membuf_[cnt++] = static_cast<uint8_t>(data[1] ^ 0x20);
+            data += 2;
+        } else {
+            membuf_[cnt++] = static_cast<uint8_t>(*data++);
+        }
     }
-
-    AttributeType res;
-    // 32 should be enough for 'write 0x000000 9999 '
-    char tstr[DATA_MAX * 2 + 32];
-    RISCV_sprintf(tstr, sizeof(tstr), "write 0x%lx %lu 0x%s",
-                  address, len, data_hex);
-
-    if (iexec_) {
-        iexec_->exec(tstr, &res, false);
+    if (cnt != len) {
+        RISCV_info("Wrong RSP binary data length %d of %d", cnt, len);
+        sendPacket("E01");
+        return;
+    }
+    if (len && (!itap_ || itap_->write(address, len, membuf_) == TAP_ERROR)) {
+        sendPacket("E01");
+        return;
     }
-
     sendPacket("OK");
 }
 
@@ -545,23 +828,45 @@ void GdbCommands::handleBreakpoint() {
 }
 
 void GdbCommands::sendPacket(const char *data) {
-    int tsz = strlen(data);
+    sendPacket(data, static_cast<int>(strlen(data)));
+}
+
+void GdbCommands::sendPacket(const char *data, int sz) {
     respcnt_ = 0;
+    if (sz + 5 > resptotal_) {
+        RISCV_error("Response is too long %d", sz);
+        sz = 0;
+    }
     if (estate_ != State_NoAckMode) {
         respbuf_[respcnt_++] = '+';
     }
     respbuf_[respcnt_++] = '$';
-    memcpy(&respbuf_[respcnt_], data, tsz);
-    respcnt_ += tsz;
+    memcpy(&respbuf_[respcnt_], data, sz);
+    respcnt_ += sz;
 
     // Add checksum
+    uint8_t sum = checksum(data, sz);
     respbuf_[respcnt_++] = '#';
-    RISCV_sprintf(&respbuf_[respcnt_], resptotal_ - respcnt_, "%02x",
-                checksum(data, tsz));
-    respcnt_ += 2;
+    respbuf_[respcnt_++] = HEX_DIGITS[sum >> 4];
+    respbuf_[respcnt_++] = HEX_DIGITS[sum & 0xF];
     respbuf_[respcnt_] = '\0';
 }
 
+void GdbCommands::sendBinaryPacket(char prefix, const uint8_t *data, int sz) {
+    int cnt = 0;
+    txdata_[cnt++] = prefix;
+    for (int i = 0; i < sz; i++) {
+        if (data[i] == '#' || data[i] == '$' || data[i] == '}'
+            || data[i] == '*') {
+            txdata_[cnt++] = '}';
+            txdata_[cnt++] = static_cast<char>(data[i] ^ 0x20);
+        } else {
+            txdata_[cnt++] = static_cast<char>(data[i]);
+        }
+    }
+    sendPacket(txdata_, cnt);
+}
+
 uint8_t GdbCommands::checksum(const char *data, const int sz) {
     uint8_t sum = 0;
     for (int i = 0; i < sz; i++) {
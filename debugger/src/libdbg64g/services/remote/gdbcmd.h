@@ -18,31 +18,34 @@
 #define __DEBUGGER_SERVICES_REMOTE_GDBCMD_H__
 
 #include "tcpcmd_gen.h"
+#include "coreservices/itap.h"
 
 namespace debugger {
 
-static const int DATA_MAX = 4096;
-
-/*struct RspPacket {
-    RspPacket() : size(0), is_good(false) {}
-    RspPacket(const char* const c_str);
-
-    void removeCRC();
-    void append(const char& c) { data[size++] = c; }
-    void append(const char* c_str);
-
-    uint8_t checksum(const char *data, const size_t sz);
-
- public:
-    char    data[DATA_MAX];
-    size_t  size;
-    bool    is_good;
-};*/
+/** Maximum packet size reported to GDB in qSupported */
+static const int GDB_PACKET_SIZE = 0x10000;
 
+/** Register of the 'g' packet layout, addr = 0 if not available */
+struct GdbRegisterType {
+    int bytes;
+    uint64_t addr;
+};
 
+/**
+ * Remote Serial Protocol stub. Memory and registers are accessed directly
+ * through the ITap interface of the command executor, binary 'X'/'x'
+ * packets are supported. Register layout is provided to GDB with the
+ * target description (qXfer:features) for RISC-V and ARM targets.
+ */
 class GdbCommands : public TcpCommandsGen {
  public:
     explicit GdbCommands(IService *parent);
+    virtual ~GdbCommands();
+
+    virtual void reset() {
+        TcpCommandsGen::reset();
+        estate_ = State_AckMode;
+    }
 
  protected:
     virtual int processCommand(const char *cmdbuf, int bufsz);
@@ -53,7 +56,7 @@ class GdbCommands : public TcpCommandsGen {
         return s == '$';
     }
     virtual bool isEndMarker(const char *s, int sz) {
-        return s[sz - 3] == '#';
+        return sz >= 4 && s[sz - 3] == '#';
     }
 
  private:
@@ -61,6 +64,8 @@ class GdbCommands : public TcpCommandsGen {
     void handlePacket(char *data);
     uint8_t checksum(const char *data, const int sz);
     void sendPacket(const char *data);
+    void sendPacket(const char *data, int sz);
+    void sendBinaryPacket(char prefix, const uint8_t *data, int sz);
 
     // RSP packet handlers
     void handleStopReasonQuery();
@@ -71,10 +76,12 @@ class GdbCommands : public TcpCommandsGen {
     void handleSetThread();
     void handleKill();
     void handleGetMemory();
+    void handleGetMemoryBinary();
     void handleWriteMemoryHex();
     void handleReadRegister();
     void handleWriteRegister();
     void handleQuery();
+    void handleQueryXfer();
     void handleGeneralSet();
     void handleStep();
     void handleThreadAlive();
@@ -82,13 +89,23 @@ class GdbCommands : public TcpCommandsGen {
     void handleWriteMemory();
     void handleBreakpoint();
 
-    void appendRegValue(char *s, uint32_t value);
+    void selectTarget();
+    bool parseAddrLen(const char *s, uint64_t *addr, int *len,
+                      const char **end);
+    int appendHex(char *s, const uint8_t *buf, int sz);
+    int parseHex(const char *s, uint8_t *buf, int sz);
+    int appendRegister(char *s, int idx, Reg64Type *val);
 
  private:
-    //RspPacket previous_packet;
-    //bool is_ack_mode;
-    //bool last_success_;
-    char packet_data_[1 << 16];
+    ITap *itap_;
+    const GdbRegisterType *regs_;
+    int regs_total_;
+    const char *target_xml_;
+
+    char *packet_data_;
+    int packet_len_;
+    uint8_t *membuf_;
+    char *txdata_;
     enum EState {
         State_AckMode,
         State_WaitAckToSwitch,
@@ -96,5 +113,6 @@ class GdbCommands : public TcpCommandsGen {
     } estate_;
 };
 
-}
+}  // namespace debugger
+
 #endif  // __DEBUGGER_SERVICES_REMOTE_GDBCMD_H__
@@ -15,131 +15,263 @@
  */
 
 #include "tcpclient.h"
+#include "tcpserver.h"
 #include "jsoncmd.h"
 #include "gdbcmd.h"
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 namespace debugger {
 
-TcpClient::TcpClient(const char *name) : IService(name) {
-    registerInterface(static_cast<IThread *>(this));
-    registerAttribute("Enable", &isEnable_);
-    registerAttribute("PlatformConfig", &platformConfig_);
-    registerAttribute("Type", &type_);
-    registerAttribute("ListenDefaultOutput", &listenDefaultOutput_);
-    RISCV_mutex_init(&mutexTx_);
+TcpClient::TcpClient(TcpServer *server, IService *parent, int idx) {
+    server_ = server;
+    parent_ = parent;
+    idx_ = idx;
+    hsock_ = 0;
+    opened_ = false;
+    listenOutput_ = false;
+    busy_ = false;
+    closing_ = false;
+    overflow_ = false;
+    RISCV_mutex_init(&mutex_);
+
+    rxtotal_ = 4096;
+    rxbuf_ = new char[rxtotal_];
+    rxcnt_ = 0;
+    worktotal_ = 4096;
+    workbuf_ = new char[worktotal_];
+    txtotal_ = 4096;
+    txbuf_ = new char[txtotal_];
+    txcnt_ = 0;
     tcpcmd_ = 0;
 }
 
 TcpClient::~TcpClient() {
-    RISCV_mutex_destroy(&mutexTx_);
+    RISCV_mutex_destroy(&mutex_);
+    delete [] rxbuf_;
+    delete [] workbuf_;
+    delete [] txbuf_;
     if (tcpcmd_) {
         delete tcpcmd_;
     }
 }
 
-void TcpClient::postinitService() {
-    if (type_.is_equal("json")) {
-        tcpcmd_ = new JsonCommands(static_cast<IService *>(this));
-    } else if (type_.is_equal("gdb")) {
-        tcpcmd_ = new GdbCommands(static_cast<IService *>(this));
-    } else {
-        RISCV_error("Unsupported command type %s.", type_.to_string());
-        return;
+void TcpClient::open(socket_def skt, bool listenOutput) {
+    RISCV_mutex_lock(&mutex_);
+    hsock_ = skt;
+    opened_ = true;
+    closing_ = false;
+    overflow_ = false;
+    rxcnt_ = 0;
+    txcnt_ = 0;
+    RISCV_mutex_unlock(&mutex_);
+    if (tcpcmd_) {
+        tcpcmd_->reset();
     }
 
-    tcpcmd_->setPlatformConfig(&platformConfig_);
-    if (isEnable_.to_bool()) {
-        if (!run()) {
-            RISCV_error("Can't create thread.", NULL);
-            return;
-        }
+    listenOutput_ = listenOutput;
+    if (listenOutput_) {
+        RISCV_add_default_output(static_cast<IRawListener *>(this));
     }
 }
 
-int TcpClient::updateData(const char *buf, int buflen) {
-    int tsz = RISCV_sprintf(&asyncbuf_[0].ibyte, sizeof(asyncbuf_),
-                    "['%s',", "Console");
+void TcpClient::close() {
+    if (listenOutput_) {
+        RISCV_remove_default_output(static_cast<IRawListener *>(this));
+    }
+    RISCV_mutex_lock(&mutex_);
+#if defined(_WIN32) || defined(__CYGWIN__)
+    closesocket(hsock_);
+#else
+    shutdown(hsock_, SHUT_RDWR);
+    ::close(hsock_);
+#endif
+    opened_ = false;
+    rxcnt_ = 0;
+    txcnt_ = 0;
+    RISCV_mutex_unlock(&mutex_);
+}
 
-    memcpy(&asyncbuf_[tsz], buf, buflen);
-    tsz += buflen;
-    asyncbuf_[tsz++].ubyte = ']';
-    asyncbuf_[tsz++].ubyte = '\0';
+bool TcpClient::received(const char *buf, int sz) {
+    bool ret;
+    RISCV_mutex_lock(&mutex_);
+    if (rxcnt_ + sz > rxtotal_) {
+        while (rxcnt_ + sz > rxtotal_) {
+            rxtotal_ *= 2;
+        }
+        char *t = new char[rxtotal_];
+        memcpy(t, rxbuf_, rxcnt_);
+        delete [] rxbuf_;
+        rxbuf_ = t;
+    }
+    memcpy(&rxbuf_[rxcnt_], buf, sz);
+    rxcnt_ += sz;
+    ret = !busy_;
+    busy_ = true;
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
+}
 
-    sendData(&asyncbuf_[0].ubyte, tsz);
-    return buflen;
+bool TcpClient::disconnect() {
+    bool ret;
+    RISCV_mutex_lock(&mutex_);
+    closing_ = true;
+    ret = !busy_;
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
 }
 
-void TcpClient::busyLoop() {
-    int rxbytes;
-    if (listenDefaultOutput_.to_bool()) {
-        RISCV_add_default_output(static_cast<IRawListener *>(this));
+int TcpClient::flush() {
+    int ret = 0;
+    int off = 0;
+    int txbytes;
+    RISCV_mutex_lock(&mutex_);
+    if (closing_) {
+        // Wait the worker to release the slot
+        ret = busy_ ? 0 : -1;
+        RISCV_mutex_unlock(&mutex_);
+        return ret;
     }
-
-    txcnt_ = 0;
-    while (isEnabled()) {
-        rxbytes = recv(hsock_, rcvbuf, sizeof(rcvbuf), 0);
-        if (rxbytes <= 0) {
-            // Timeout:
-            continue;
-        } 
-
-        rcvbuf[rxbytes] = '\0';
-        RISCV_debug("i=>[%d]: %s", rxbytes, rcvbuf);
-        tcpcmd_->updateData(rcvbuf, rxbytes);
-        int tsz = tcpcmd_->response_size();
-        if (tsz != 0) {
-            sendData(tcpcmd_->response_buf(), tsz);
+    if (overflow_) {
+        RISCV_mutex_unlock(&mutex_);
+        // Outside of the lock: log output comes back via updateData()
+        RISCV_printf(parent_, LOG_ERROR,
+                     "TCP client%d output exceeds %d bytes, disconnecting",
+                     idx_, TX_LIMIT);
+        return -1;
+    }
+    while (off < txcnt_) {
+        txbytes = send(hsock_, &txbuf_[off], txcnt_ - off, MSG_NOSIGNAL);
+        if (txbytes > 0) {
+            off += txbytes;
+        } else {
+            if (!TcpServer::isWouldBlock()) {
+                ret = -1;
+            }
+            break;
         }
-        tcpcmd_->done();
     }
-
-    if (listenDefaultOutput_.to_bool()) {
-        RISCV_remove_default_output(static_cast<IRawListener *>(this));
+    txcnt_ -= off;
+    if (off && txcnt_) {
+        memmove(txbuf_, &txbuf_[off], txcnt_);
+    }
+    if (ret == 0) {
+        ret = txcnt_;
     }
-    closeSocket();
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
 }
 
-int TcpClient::sendData(uint8_t *buf, int sz) {
-    RISCV_mutex_lock(&mutexTx_);
-    memcpy(txbuf_, buf, sz);
-    txbuf_[sz] = '\0';
-    txcnt_ = sz;
-    RISCV_mutex_unlock(&mutexTx_);
-
-    RISCV_debug("o<=[%d]: %s", txcnt_, txbuf_);
+/**
+ * Console output is called from any thread (simulation as well), so it
+ * only copies data into the output buffer and wakes up the reactor.
+ */
+int TcpClient::updateData(const char *buf, int buflen) {
+    static const char CONSOLE_PREFIX[] = "['Console',";
+    RISCV_mutex_lock(&mutex_);
+    int sz = static_cast<int>(sizeof(CONSOLE_PREFIX)) - 1 + buflen + 2;
+    if (opened_ && !closing_ && !overflow_ && txcnt_ + sz > TX_LIMIT) {
+        overflow_ = true;
+        txcnt_ = 0;
+    } else if (opened_ && !closing_ && !overflow_) {
+        reserveTx(sz);
+        memcpy(&txbuf_[txcnt_], CONSOLE_PREFIX, sizeof(CONSOLE_PREFIX) - 1);
+        txcnt_ += sizeof(CONSOLE_PREFIX) - 1;
+        memcpy(&txbuf_[txcnt_], buf, buflen);
+        txcnt_ += buflen;
+        txbuf_[txcnt_++] = ']';
+        txbuf_[txcnt_++] = '\0';
+    }
+    RISCV_mutex_unlock(&mutex_);
+    server_->postTransmit();
+    return buflen;
+}
 
-    int total = txcnt_;
-    char *ptx = txbuf_;
-    int txbytes;
+void TcpClient::processRequests() {
+    if (!tcpcmd_) {
+        createCommands();
+    }
+    while (true) {
+        RISCV_mutex_lock(&mutex_);
+        if (rxcnt_ == 0 || closing_ || !tcpcmd_) {
+            rxcnt_ = 0;
+            busy_ = false;
+            RISCV_mutex_unlock(&mutex_);
+            break;
+        }
+        // Swap buffers so that the reactor continues to receive data
+        char *t = workbuf_;
+        int ttotal = worktotal_;
+        int sz = rxcnt_;
+        workbuf_ = rxbuf_;
+        worktotal_ = rxtotal_;
+        rxbuf_ = t;
+        rxtotal_ = ttotal;
+        rxcnt_ = 0;
+        RISCV_mutex_unlock(&mutex_);
 
-    while (total > 0) {
-        txbytes = send(hsock_, ptx, total, 0);
-        if (txbytes <= 0) {
-            RISCV_error("Send error: txcnt=%d", txcnt_);
-            loopEnable_.state = false;
-            return -1;
+        int off = 0;
+        while (off < sz) {
+            int n = tcpcmd_->updateData(&workbuf_[off], sz - off);
+            if (n == 0) {
+                break;      // the rest is an incomplete request
+            }
+            int tsz = tcpcmd_->response_size();
+            if (tsz != 0) {
+                write(reinterpret_cast<char *>(tcpcmd_->response_buf()), tsz);
+            }
+            tcpcmd_->done();
+            off += n;
         }
-        total -= txbytes;
-        ptx += txbytes;
+        server_->postTransmit();
     }
-    RISCV_mutex_lock(&mutexTx_);
-    txcnt_ = 0;
-    RISCV_mutex_unlock(&mutexTx_);
-    return 0;
+    // Closing slot is released by the reactor
+    server_->postTransmit();
 }
 
-void TcpClient::closeSocket() {
-    if (hsock_ < 0) {
+void TcpClient::createCommands() {
+    AttributeType *type =
+        static_cast<AttributeType *>(parent_->getAttribute("Type"));
+    AttributeType *cfg =
+        static_cast<AttributeType *>(parent_->getAttribute("PlatformConfig"));
+    if (type->is_equal("json")) {
+        tcpcmd_ = new JsonCommands(parent_);
+    } else if (type->is_equal("gdb")) {
+        tcpcmd_ = new GdbCommands(parent_);
+    } else {
+        RISCV_printf(parent_, LOG_ERROR, "Unsupported command type %s.",
+                     type->to_string());
         return;
     }
+    tcpcmd_->setPlatformConfig(cfg);
+}
 
-#if defined(_WIN32) || defined(__CYGWIN__)
-    closesocket(hsock_);
-#else
-    shutdown(hsock_, SHUT_RDWR);
-    close(hsock_);
-#endif
-    hsock_ = -1;
+void TcpClient::write(const char *buf, int sz) {
+    RISCV_mutex_lock(&mutex_);
+    if (!closing_ && !overflow_ && txcnt_ + sz > TX_LIMIT) {
+        overflow_ = true;
+        txcnt_ = 0;
+    } else if (!closing_ && !overflow_) {
+        reserveTx(sz);
+        memcpy(&txbuf_[txcnt_], buf, sz);
+        txcnt_ += sz;
+    }
+    RISCV_mutex_unlock(&mutex_);
+}
+
+void TcpClient::reserveTx(int sz) {
+    if (txcnt_ + sz <= txtotal_) {
+        return;
+    }
+    while (txcnt_ + sz > txtotal_) {
+        txtotal_ *= 2;
+    }
+    char *t = new char[txtotal_];
+    memcpy(t, txbuf_, txcnt_);
+    delete [] txbuf_;
+    txbuf_ = t;
 }
 
 }  // namespace debugger
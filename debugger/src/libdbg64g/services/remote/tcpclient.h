@@ -17,60 +17,84 @@
 #ifndef __DEBUGGER_TCPCLIENT_H__
 #define __DEBUGGER_TCPCLIENT_H__
 
-#include <iclass.h>
 #include <iservice.h>
 #include "tcpcmd_gen.h"
-#include "coreservices/ithread.h"
 #include "coreservices/irawlistener.h"
 
 namespace debugger {
 
-class TcpClient : public IService,
-                  public IThread,
-                  public IRawListener {
+class TcpServer;
+
+/**
+ * Connection slot of the TcpServer pool. Slot with its buffers and the
+ * commands generator is re-used by the next accepted connection, so that
+ * connection setup doesn't allocate memory or create threads.
+ *
+ * Socket is accessed only by the server reactor thread, received requests
+ * are executed by one of the server workers, output is buffered and sent
+ * by the reactor.
+ */
+class TcpClient : public IRawListener {
  public:
-    explicit TcpClient(const char *name);
+    TcpClient(TcpServer *server, IService *parent, int idx);
     virtual ~TcpClient();
 
-    /** IService interface */
-    virtual void postinitService();
-    virtual void setExtArgument(void *args) {
-        hsock_ = *reinterpret_cast<socket_def *>(args);
-    }
-
-    /** IRawListener interface */
+    /** IRawListener interface: asynchronous console output */
     virtual int updateData(const char *buf, int buflen);
 
- protected:
-    /** IThread interface */
-    virtual void busyLoop();
+    /** Reactor methods */
+    void open(socket_def skt, bool listenOutput);
+    void close();
+    bool isOpened() { return opened_; }
+    bool isClosing() { return closing_; }
+    socket_def getSocket() { return hsock_; }
+    int getIndex() { return idx_; }
+    /** @return true if the client should be queued to a worker */
+    bool received(const char *buf, int sz);
+    /**
+     * @return bytes waiting for the socket or -1 to disconnect the slot,
+     *         client is disconnected when its output exceeds TX_LIMIT.
+     */
+    int flush();
+    /** Peer was disconnected; @return true if slot can be closed now */
+    bool disconnect();
 
- protected:
-    int sendData(uint8_t *buf, int sz);
-    void closeSocket();
+    /** Worker method: execute all received requests */
+    void processRequests();
 
  private:
-    AttributeType isEnable_;
-    AttributeType timeout_;
-    AttributeType platformConfig_;
-    AttributeType type_;
-    AttributeType listenDefaultOutput_;
+    void createCommands();
+    void write(const char *buf, int sz);
+    void reserveTx(int sz);
 
+ public:
+    /** Stalled client is disconnected above this output limit */
+    static const int TX_LIMIT = 1 << 26;
+
+ private:
+    TcpServer *server_;
+    IService *parent_;
+    int idx_;
     socket_def hsock_;
-    mutex_def mutexTx_;
-    char rcvbuf[4096];
-    char txbuf_[1<<20];
+    bool opened_;
+    bool listenOutput_;
+    bool busy_;         // queued or processed by a worker
+    bool closing_;      // peer disconnected while busy
+    bool overflow_;     // output exceeds TX_LIMIT
+
+    mutex_def mutex_;
+    char *rxbuf_;       // received but not processed data
+    int rxcnt_;
+    int rxtotal_;
+    char *workbuf_;     // data processed by the worker
+    int worktotal_;
+    char *txbuf_;       // data to send
     int txcnt_;
-    union reg8_type {
-        char ibyte;
-        uint8_t ubyte;
-    } asyncbuf_[1 << 20];
+    int txtotal_;
 
     TcpCommandsGen *tcpcmd_;
 };
 
-DECLARE_CLASS(TcpClient)
-
 }  // namespace debugger
 
 #endif  // __DEBUGGER_TCPCLIENT_H__
@@ -20,6 +20,8 @@ namespace debugger {
 
 TcpCommandsGen::TcpCommandsGen(IService *parent) : IHap(HAP_All) {
     parent_ = parent;
+    rxtotal_ = 4096;    // should re-allocated if need in childs
+    rxbuf_ = new char[rxtotal_];
     rxcnt_ = 0;
     estate_ = State_Idle;
 
@@ -42,6 +44,7 @@ TcpCommandsGen::TcpCommandsGen(IService *parent) : IHap(HAP_All) {
         RISCV_get_service_iface(cpu_.to_string(), IFACE_CLOCK));
     IService *iservcpu = static_cast<IService *>(
                         RISCV_get_service(cpu_.to_string()));
+    iservcpu_ = iservcpu;
     cpuLogLevel_ = static_cast<AttributeType *>(
                         iservcpu->getAttribute("LogLevel"));
 
@@ -69,6 +72,8 @@ TcpCommandsGen::~TcpCommandsGen() {
     respcnt_ = 0;
     resptotal_ = 0;
     delete [] respbuf_;
+    rxtotal_ = 0;
+    delete [] rxbuf_;
 }
 
 void TcpCommandsGen::setPlatformConfig(AttributeType *cfg) {
@@ -78,7 +83,10 @@ void TcpCommandsGen::setPlatformConfig(AttributeType *cfg) {
 void TcpCommandsGen::hapTriggered(IFace *isrc, EHapType type,
                                 const char *descr) {
     if (type == HAP_Halt) {
-        RISCV_event_set(&eventHalt_);
+        // Other CPUs and harts halt independently
+        if (isrc == iservcpu_) {
+            RISCV_event_set(&eventHalt_);
+        }
     } else if (type == HAP_CpuTurnON || type == HAP_CpuTurnOFF) {
         RISCV_event_set(&eventPowerChanged_);
     }
@@ -89,7 +97,6 @@ void TcpCommandsGen::stepCallback(uint64_t t) {
 }
 
 int TcpCommandsGen::updateData(const char *buf, int buflen) {
-    int ret = 0;
     for (int i = 0; i < buflen; i++) {
         switch (estate_) {
         case State_Idle:
@@ -99,7 +106,7 @@ int TcpCommandsGen::updateData(const char *buf, int buflen) {
             }
             break;
         case State_Started:
-            if (rxcnt_ < static_cast<int>(sizeof(rxbuf_))) {
+            if (rxcnt_ < rxtotal_ - 1) {
                 rxbuf_[rxcnt_++] = buf[i];
                 rxbuf_[rxcnt_] = '\0';
             } else {
@@ -116,10 +123,10 @@ int TcpCommandsGen::updateData(const char *buf, int buflen) {
             processCommand(rxbuf_, rxcnt_);
             rxcnt_ = 0;
             estate_ = State_Idle;
-            ret = i + 1;  // take into account the last symbol
+            return i + 1;  // take into account the last symbol
         }
     }
-    return ret;
+    return 0;
 }
 
 void TcpCommandsGen::br_add(const AttributeType &symb, AttributeType *res) {
@@ -45,7 +45,12 @@ class TcpCommandsGen : public IRawListener,
     explicit TcpCommandsGen(IService *parent);
     virtual ~TcpCommandsGen();
 
-    /** IRawListener interface */
+    /**
+     * IRawListener interface
+     * @return number of bytes up to and including the first complete
+     *         request (its response is ready) or 0 if all data were
+     *         consumed without complete request.
+     */
     virtual int updateData(const char *buf, int buflen);
 
     /** IHap */
@@ -59,6 +64,12 @@ class TcpCommandsGen : public IRawListener,
     uint8_t *response_buf() { return reinterpret_cast<uint8_t *>(respbuf_); }
     int response_size() { return respcnt_; }
     void done() { respcnt_ = 0; }
+    /** Drop the protocol state before serving a new connection */
+    virtual void reset() {
+        rxcnt_ = 0;
+        respcnt_ = 0;
+        estate_ = State_Idle;
+    }
 
  protected:
     virtual int processCommand(const char *cmdbuf, int bufsz) = 0;
@@ -79,7 +90,8 @@ class TcpCommandsGen : public IRawListener,
     void power_off(const char *btn_name, AttributeType *res);
 
  protected:
-    char rxbuf_[4096];
+    char *rxbuf_;
+    int rxtotal_;
     int rxcnt_;
     AttributeType platformConfig_;
     AttributeType cpu_;
@@ -92,6 +104,7 @@ class TcpCommandsGen : public IRawListener,
     int respcnt_;
 
     IService *parent_;
+    IFace *iservcpu_;       // HAP_Halt source of the controlled CPU
     ICmdExecutor *iexec_;
     ISourceCode *isrc_;
     ICpuFunctional *icpufunc_;
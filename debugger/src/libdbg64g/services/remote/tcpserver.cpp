@@ -15,6 +15,10 @@
  */
 
 #include "tcpserver.h"
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 namespace debugger {
 
@@ -28,22 +32,84 @@ TcpServer::TcpServer(const char *name) : IService(name) {
     registerAttribute("PlatformConfig", &platformConfig_);
     registerAttribute("Type", &type_);
     registerAttribute("ListenDefaultOutput", &listenDefaultOutput_);
+    registerAttribute("MaxClients", &maxClients_);
+    registerAttribute("Workers", &workers_);
+
+    maxClients_.make_int64(64);
+    workers_.make_int64(2);
+    hsock_ = -1;
+    clients_total_ = 0;
+    free_cnt_ = 0;
+    workers_total_ = 0;
+    workers_busy_ = 0;
+    req_rd_ = 0;
+    req_cnt_ = 0;
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    epoll_fd_ = -1;
+    wake_fd_ = -1;
+#endif
+    RISCV_mutex_init(&mutexRequests_);
+    char tstr[256];
+    RISCV_sprintf(tstr, sizeof(tstr), "eventRequests_%s", name);
+    RISCV_event_create(&eventRequests_, tstr);
+}
+
+TcpServer::~TcpServer() {
+    stop();
+    for (int i = 0; i < workers_total_; i++) {
+        delete worker_[i];
+    }
+    for (int i = 0; i < clients_total_; i++) {
+        delete clients_[i];
+    }
+    RISCV_event_close(&eventRequests_);
+    RISCV_mutex_destroy(&mutexRequests_);
 }
 
 void TcpServer::postinitService() {
-    createServerSocket();
+    clients_total_ = maxClients_.to_int();
+    if (clients_total_ <= 0 || clients_total_ > CLIENTS_MAX) {
+        RISCV_error("MaxClients %d is out of range", clients_total_);
+        clients_total_ = clients_total_ <= 0 ? 1 : CLIENTS_MAX;
+    }
+    for (int i = 0; i < clients_total_; i++) {
+        clients_[i] = new TcpClient(this, static_cast<IService *>(this), i);
+        pollout_[i] = false;
+        // The lowest slots are re-used first
+        free_[free_cnt_++] = clients_total_ - 1 - i;
+    }
 
-    if (listen(hsock_, 1) < 0)  {
+    if (createServerSocket() != 0) {
+        return;
+    }
+
+    if (listen(hsock_, SOMAXCONN) < 0)  {
         RISCV_error("listen() failed", 0);
         return;
     }
 
-    /** By default socket was created with Blocking mode */
-    if (!blockmode_.to_bool()) {
-        setBlockingMode(false);
+    /** Reactor accepts connections until the queue is empty */
+    setBlockingMode(hsock_, false);
+
+    if (!pollInit()) {
+        RISCV_error("Can't create poller", 0);
+        return;
     }
 
     if (isEnable_.to_bool()) {
+        workers_total_ = workers_.to_int();
+        // The pool grows up to one worker per client
+        if (workers_total_ <= 0 || workers_total_ > clients_total_) {
+            RISCV_error("Workers %d is out of range", workers_total_);
+            workers_total_ = workers_total_ <= 0 ? 1 : clients_total_;
+        }
+        for (int i = 0; i < workers_total_; i++) {
+            worker_[i] = new TcpWorker(this);
+            if (!worker_[i]->run()) {
+                RISCV_error("Can't create worker thread %d", i);
+                return;
+            }
+        }
         if (!run()) {
             RISCV_error("Can't create thread.", NULL);
             return;
@@ -51,64 +117,378 @@ void TcpServer::postinitService() {
     }
 }
 
+void TcpServer::stop() {
+    IThread::stop();
+    // Reactor doesn't create workers after its thread is stopped
+    for (int i = 0; i < workers_total_; i++) {
+        worker_[i]->stop();
+    }
+}
+
 void TcpServer::busyLoop() {
-    socket_def client_sock;
-    int err;
+    int cnt;
+    bool flush;
+    TcpClient *client;
+    while (isEnabled()) {
+        cnt = pollWait(400);
+        if (cnt < 0) {
+            RISCV_info("TCP server thread poll failed", 0);
+            break;
+        }
+        flush = false;
+        for (int i = 0; i < cnt; i++) {
+            if (ready_[i] == Poll_Listen) {
+                acceptClients();
+            } else if (ready_[i] == Poll_Wake) {
+                flush = true;
+            } else {
+                client = clients_[ready_[i]];
+                if (!client->isOpened() || client->isClosing()) {
+                    continue;
+                }
+                if (ready_flags_[i] & POLL_RD) {
+                    readClient(client);
+                }
+                if (ready_flags_[i] & POLL_WR) {
+                    flushClient(client);
+                }
+            }
+        }
+        if (flush) {
+            flushAll();
+        }
+    }
 
-    fd_set readSet;
-    timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 400000;   // 400 ms
+    for (int i = 0; i < clients_total_; i++) {
+        if (clients_[i]->isOpened()) {
+            clients_[i]->close();
+        }
+    }
+    pollClose();
+    closeServerSocket();
+}
 
-    int idx = 0;
-    char tname[64];
+void TcpServer::acceptClients() {
+    socket_def skt;
+    TcpClient *client;
+    int enable = 1;
+    while (true) {
+        skt = accept(hsock_, 0, 0);
+        if (static_cast<int>(skt) < 0) {
+            return;
+        }
+        if (free_cnt_ == 0) {
+            RISCV_error("Clients limit %d reached", clients_total_);
+#if defined(_WIN32) || defined(__CYGWIN__)
+            closesocket(skt);
+#else
+            close(skt);
+#endif
+            continue;
+        }
+        setBlockingMode(skt, false);
+        setsockopt(skt, IPPROTO_TCP, TCP_NODELAY,
+                   reinterpret_cast<const char *>(&enable), sizeof(int));
 
-    IClass *icls;
-    IService *isrv;
-    while (isEnabled()) {
-        FD_ZERO(&readSet);
-        FD_SET(hsock_, &readSet);
-        err = select(hsock_ + 1, &readSet, NULL, NULL, &timeout);
-        if (err > 0) {
-            client_sock = accept(hsock_, 0, 0);
-            setRcvTimeout(client_sock, timeout_.to_int());
-            RISCV_sprintf(tname, sizeof(tname), "client%d", idx++);
-
-            icls = static_cast<IClass *>(RISCV_get_class("TcpClientClass"));
-            isrv = icls->createService(tname);
-            AttributeType lst, item;
-            lst.make_list(0);
-            item.make_list(2);
-            item[0u].make_string("LogLevel");
-            item[1].make_int64(logLevel_.to_int());
-            lst.add_to_list(&item);
-            item[0u].make_string("Enable");
-            item[1].make_boolean(true);
-            lst.add_to_list(&item);
-            item[0u].make_string("PlatformConfig");
-            item[1].clone(&platformConfig_);
-            lst.add_to_list(&item);
-            item[0u].make_string("Type");
-            item[1].clone(&type_);
-            lst.add_to_list(&item);
-            item[0u].make_string("ListenDefaultOutput");
-            item[1].clone(&listenDefaultOutput_);
-            lst.add_to_list(&item);
-
-            isrv->initService(&lst);
-            IThread *ithrd =
-                static_cast<IThread *>(isrv->getInterface(IFACE_THREAD));
-            ithrd->setExtArgument(&client_sock);
-            isrv->postinitService();
-            RISCV_info("TCP %s %p started", isrv->getObjName(), client_sock);
-        } else if (err == 0) {
-            // timeout
+        client = clients_[free_[--free_cnt_]];
+        client->open(skt, listenDefaultOutput_.to_bool());
+        pollAdd(client);
+        RISCV_debug("TCP client%d opened", client->getIndex());
+    }
+}
+
+void TcpServer::readClient(TcpClient *client) {
+    int rxbytes;
+    while (true) {
+        rxbytes = recv(client->getSocket(), rcvbuf_, sizeof(rcvbuf_), 0);
+        if (rxbytes > 0) {
+            if (client->received(rcvbuf_, rxbytes)) {
+                postRequest(client);
+            }
+            if (rxbytes < static_cast<int>(sizeof(rcvbuf_))) {
+                return;
+            }
+        } else if (rxbytes < 0 && isWouldBlock()) {
+            return;
         } else {
-            RISCV_info("TCP server thread accept() failed", 0);
-            loopEnable_.state = false;
+            disconnectClient(client);
+            return;
+        }
+    }
+}
+
+void TcpServer::flushClient(TcpClient *client) {
+    int idx = client->getIndex();
+    int rest = client->flush();
+    if (rest < 0) {
+        disconnectClient(client);
+    } else if ((rest > 0) != pollout_[idx]) {
+        pollWrite(client, rest > 0);
+    }
+}
+
+void TcpServer::flushAll() {
+    for (int i = 0; i < clients_total_; i++) {
+        if (clients_[i]->isOpened()) {
+            flushClient(clients_[i]);
+        }
+    }
+}
+
+/** Slot is released when the worker doesn't process it */
+void TcpServer::disconnectClient(TcpClient *client) {
+    if (!client->isClosing()) {
+        pollRemove(client);
+    }
+    if (!client->disconnect()) {
+        return;
+    }
+    client->close();
+    free_[free_cnt_++] = client->getIndex();
+    RISCV_debug("TCP client%d closed", client->getIndex());
+}
+
+void TcpServer::postTransmit() {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    uint64_t v = 1;
+    if (wake_fd_ >= 0 && ::write(wake_fd_, &v, sizeof(v)) < 0) {
+        // counter is already signaled
+    }
+#endif
+}
+
+/**
+ * Worker may be blocked by a request waiting for the simulation, so new
+ * worker is created when there's no free one. Each client is queued or
+ * processed only once, so workers total never exceeds the clients total.
+ */
+void TcpServer::postRequest(TcpClient *client) {
+    RISCV_mutex_lock(&mutexRequests_);
+    requests_[(req_rd_ + req_cnt_) % CLIENTS_MAX] = client;
+    req_cnt_++;
+    if (workers_busy_ + req_cnt_ > workers_total_
+        && workers_total_ < clients_total_ && isEnabled()) {
+        worker_[workers_total_] = new TcpWorker(this);
+        if (worker_[workers_total_]->run()) {
+            workers_total_++;
+        } else {
+            RISCV_error("Can't create worker thread %d", workers_total_);
+            delete worker_[workers_total_];
+        }
+    }
+    RISCV_event_set(&eventRequests_);
+    RISCV_mutex_unlock(&mutexRequests_);
+}
+
+TcpClient *TcpServer::waitRequest(IThread *worker) {
+    TcpClient *ret = 0;
+    RISCV_mutex_lock(&mutexRequests_);
+    if (!worker->isEnabled()) {
+        RISCV_mutex_unlock(&mutexRequests_);
+        return 0;
+    }
+    if (req_cnt_ == 0) {
+        RISCV_event_clear(&eventRequests_);
+        RISCV_mutex_unlock(&mutexRequests_);
+        RISCV_event_wait(&eventRequests_);
+        return 0;
+    }
+    ret = requests_[req_rd_];
+    req_rd_ = (req_rd_ + 1) % CLIENTS_MAX;
+    req_cnt_--;
+    workers_busy_++;
+    RISCV_mutex_unlock(&mutexRequests_);
+    return ret;
+}
+
+void TcpServer::releaseWorker() {
+    RISCV_mutex_lock(&mutexRequests_);
+    workers_busy_--;
+    RISCV_mutex_unlock(&mutexRequests_);
+}
+
+bool TcpServer::isWouldBlock() {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+bool TcpServer::pollInit() {
+    return true;
+}
+
+void TcpServer::pollClose() {
+}
+
+void TcpServer::pollAdd(TcpClient *client) {
+    pollout_[client->getIndex()] = false;
+}
+
+void TcpServer::pollRemove(TcpClient *client) {
+    pollout_[client->getIndex()] = false;
+}
+
+void TcpServer::pollWrite(TcpClient *client, bool ena) {
+    pollout_[client->getIndex()] = ena;
+}
+
+/**
+ * Without wake-up descriptor the output is flushed after each 10 ms
+ * timeout, only the first EVENTS_MAX ready clients are returned.
+ */
+int TcpServer::pollWait(int timeout_ms) {
+    fd_set rdset;
+    fd_set wrset;
+    timeval tv;
+    int cnt = 0;
+    int flags;
+    TcpClient *client;
+    FD_ZERO(&rdset);
+    FD_ZERO(&wrset);
+    FD_SET(hsock_, &rdset);
+    for (int i = 0; i < clients_total_; i++) {
+        client = clients_[i];
+        if (!client->isOpened() || client->isClosing()) {
+            continue;
+        }
+        FD_SET(client->getSocket(), &rdset);
+        if (pollout_[i]) {
+            FD_SET(client->getSocket(), &wrset);
+        }
+    }
+    tv.tv_sec = 0;
+    tv.tv_usec = 10000;
+    if (select(0, &rdset, &wrset, NULL, &tv) < 0) {
+        return -1;
+    }
+    ready_flags_[cnt] = 0;
+    ready_[cnt++] = Poll_Wake;
+    if (FD_ISSET(hsock_, &rdset)) {
+        ready_flags_[cnt] = POLL_RD;
+        ready_[cnt++] = Poll_Listen;
+    }
+    for (int i = 0; i < clients_total_ && cnt < EVENTS_MAX; i++) {
+        client = clients_[i];
+        if (!client->isOpened() || client->isClosing()) {
+            continue;
+        }
+        flags = 0;
+        if (FD_ISSET(client->getSocket(), &rdset)) {
+            flags |= POLL_RD;
+        }
+        if (FD_ISSET(client->getSocket(), &wrset)) {
+            flags |= POLL_WR;
+        }
+        if (flags) {
+            ready_flags_[cnt] = flags;
+            ready_[cnt++] = i;
+        }
+    }
+    return cnt;
+}
+#else
+bool TcpServer::pollInit() {
+    struct epoll_event ev;
+    epoll_fd_ = epoll_create1(0);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        return false;
+    }
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    ev.data.u32 = static_cast<uint32_t>(Poll_Listen);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, hsock_, &ev);
+    ev.data.u32 = static_cast<uint32_t>(Poll_Wake);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+    return true;
+}
+
+void TcpServer::pollClose() {
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+    epoll_fd_ = -1;
+    wake_fd_ = -1;
+}
+
+void TcpServer::pollAdd(TcpClient *client) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = 0;
+    ev.data.u32 = static_cast<uint32_t>(client->getIndex());
+    pollout_[client->getIndex()] = false;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client->getSocket(), &ev);
+}
+
+void TcpServer::pollRemove(TcpClient *client) {
+    struct epoll_event ev;
+    pollout_[client->getIndex()] = false;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client->getSocket(), &ev);
+}
+
+void TcpServer::pollWrite(TcpClient *client, bool ena) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    if (ena) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.u64 = 0;
+    ev.data.u32 = static_cast<uint32_t>(client->getIndex());
+    pollout_[client->getIndex()] = ena;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client->getSocket(), &ev);
+}
+
+int TcpServer::pollWait(int timeout_ms) {
+    struct epoll_event ev[EVENTS_MAX];
+    uint64_t v;
+    int cnt = epoll_wait(epoll_fd_, ev, EVENTS_MAX, timeout_ms);
+    if (cnt < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    for (int i = 0; i < cnt; i++) {
+        ready_[i] = static_cast<int>(ev[i].data.u32);
+        ready_flags_[i] = 0;
+        if (ev[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            ready_flags_[i] |= POLL_RD;
+        }
+        if (ev[i].events & EPOLLOUT) {
+            ready_flags_[i] |= POLL_WR;
+        }
+        if (ready_[i] == Poll_Wake && read(wake_fd_, &v, sizeof(v)) < 0) {
+            // already drained
+        }
+    }
+    return cnt;
+}
+#endif
+
+TcpServer::TcpWorker::TcpWorker(TcpServer *server) : IThread() {
+    server_ = server;
+}
+
+void TcpServer::TcpWorker::stop() {
+    RISCV_mutex_lock(&server_->mutexRequests_);
+    RISCV_event_clear(&loopEnable_);
+    RISCV_event_set(&server_->eventRequests_);
+    RISCV_mutex_unlock(&server_->mutexRequests_);
+    IThread::stop();
+}
+
+void TcpServer::TcpWorker::busyLoop() {
+    TcpClient *client;
+    while (isEnabled()) {
+        client = server_->waitRequest(this);
+        if (client) {
+            client->processRequests();
+            server_->releaseWorker();
         }
     }
-    closeServerSocket();
 }
 
 int TcpServer::createServerSocket() {
@@ -190,50 +570,25 @@ int TcpServer::createServerSocket() {
     return 0;
 }
 
-void TcpServer::setRcvTimeout(socket_def skt, int timeout_ms) {
-    if (!timeout_ms) {
-        return;
-    }
-    struct timeval tv;
-#if defined(_WIN32) || defined(__CYGWIN__)
-    /** On windows timeout of the setsockopt() function is the DWORD
-        * size variable in msec, so we use only the first field in timeval
-        * struct and directly assgign argument.
-        */
-    tv.tv_sec = timeout_ms;
-    tv.tv_usec = 0;
-#else
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-    tv.tv_sec = timeout_ms / 1000;
-#endif
-    setsockopt(skt, SOL_SOCKET, SO_RCVTIMEO,
-                    reinterpret_cast<char *>(&tv), sizeof(struct timeval));
-}
-
-bool TcpServer::setBlockingMode(bool mode) {
+bool TcpServer::setBlockingMode(socket_def skt, bool mode) {
     int ret;
 #if defined(_WIN32) || defined(__CYGWIN__)
     // 0 = disable non-blocking mode
     // 1 = enable non-blocking mode
     u_long arg = mode ? 0 : 1;
-    ret = ioctlsocket(hsock_, FIONBIO, &arg);
+    ret = ioctlsocket(skt, FIONBIO, &arg);
     if (ret == SOCKET_ERROR) {
         RISCV_error("Set non-blocking socket failed", 0);
     }
 #else
-    int flags = fcntl(hsock_, F_GETFL, 0);
+    int flags = fcntl(skt, F_GETFL, 0);
     if (flags < 0) {
         return false;
     }
     flags = mode ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
-    ret = fcntl(hsock_, F_SETFL, flags);
+    ret = fcntl(skt, F_SETFL, flags);
 #endif
-    if (ret == 0) {
-        // success
-        blockmode_.make_boolean(mode);
-        return true;
-    }
-    return false;
+    return ret == 0;
 }
 
 void TcpServer::closeServerSocket() {
@@ -24,14 +24,32 @@
 
 namespace debugger {
 
+/**
+ * Single reactor thread multiplexes the listening socket and all client
+ * sockets (epoll on Linux, select on Windows). Connections are taken from
+ * the pool of 'MaxClients' slots, received requests are executed by the
+ * pool of 'Workers' threads and responses are sent by the reactor, so
+ * that idle clients don't cost threads and writers never block. Requests
+ * may wait for the simulation (halt, power), so the pool grows when all
+ * workers are busy: each queued client gets its own worker.
+ */
 class TcpServer : public IService,
                   public IThread {
  public:
     explicit TcpServer(const char *name);
+    virtual ~TcpServer();
 
     /** IService interface */
     virtual void postinitService();
 
+    /** IThread interface */
+    virtual void stop();
+
+    /** Client has output data or was released by a worker */
+    void postTransmit();
+    /** Socket operation would block */
+    static bool isWouldBlock();
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
@@ -39,8 +57,37 @@ class TcpServer : public IService,
  protected:
     int createServerSocket();
     void closeServerSocket();
-    void setRcvTimeout(socket_def skt, int timeout_ms);
-    bool setBlockingMode(bool mode);
+    bool setBlockingMode(socket_def skt, bool mode);
+
+ private:
+    class TcpWorker : public IThread {
+     public:
+        explicit TcpWorker(TcpServer *server);
+        virtual void stop();
+
+     protected:
+        virtual void busyLoop();
+
+     private:
+        TcpServer *server_;
+    };
+
+    bool pollInit();
+    void pollClose();
+    void pollAdd(TcpClient *client);
+    void pollRemove(TcpClient *client);
+    void pollWrite(TcpClient *client, bool ena);
+    int pollWait(int timeout_ms);
+
+    void acceptClients();
+    void readClient(TcpClient *client);
+    void flushClient(TcpClient *client);
+    void disconnectClient(TcpClient *client);
+    void flushAll();
+
+    void postRequest(TcpClient *client);
+    TcpClient *waitRequest(IThread *worker);
+    void releaseWorker();
 
  private:
     AttributeType isEnable_;
@@ -51,10 +98,44 @@ class TcpServer : public IService,
     AttributeType platformConfig_;
     AttributeType type_;
     AttributeType listenDefaultOutput_;
+    AttributeType maxClients_;
+    AttributeType workers_;
+
+    static const int CLIENTS_MAX = 1024;
+    static const int EVENTS_MAX = 64;
 
     struct sockaddr_in sockaddr_ipv4_;
     socket_def hsock_;
-    char rcvbuf[4096];
+    char rcvbuf_[1 << 14];
+
+    TcpClient *clients_[CLIENTS_MAX];
+    int clients_total_;
+    bool pollout_[CLIENTS_MAX];
+    int free_[CLIENTS_MAX];     // stack of the free slots
+    int free_cnt_;
+
+    TcpWorker *worker_[CLIENTS_MAX];
+    int workers_total_;
+    int workers_busy_;
+    mutex_def mutexRequests_;
+    event_def eventRequests_;
+    TcpClient *requests_[CLIENTS_MAX];     // each client queued once
+    int req_rd_;
+    int req_cnt_;
+
+    /** Ready sources: client index or Poll_Listen/Poll_Wake */
+    enum EPollId {
+        Poll_Listen = -1,
+        Poll_Wake = -2
+    };
+    static const int POLL_RD = 0x1;
+    static const int POLL_WR = 0x2;
+    int ready_[EVENTS_MAX];
+    int ready_flags_[EVENTS_MAX];
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+    int epoll_fd_;
+    int wake_fd_;
+#endif
 };
 
 DECLARE_CLASS(TcpServer)
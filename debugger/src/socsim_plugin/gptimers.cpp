@@ -12,6 +12,8 @@ namespace debugger {
 
 GPTimers::GPTimers(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
+    registerInterface(static_cast<IClockListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("IrqControl", &irqctrl_);
     registerAttribute("ClkSource", &clksrc_);
 
@@ -128,6 +130,19 @@ void GPTimers::stepCallback(uint64_t t) {
     }
 }
 
+void GPTimers::saveSnapshot(uint8_t *buf) {
+    memcpy(buf, &regs_, sizeof(regs_));
+}
+
+/** Pending timer event is restored by the clock owner */
+ESnapshotStatus GPTimers::restoreSnapshot(uint8_t *buf, uint64_t sz) {
+    if (sz != sizeof(regs_)) {
+        RISCV_error("Wrong snapshot size %" RV_PRI64 "d", sz);
+        return SNAPSHOT_ERROR;
+    }
+    memcpy(&regs_, buf, sizeof(regs_));
+    return SNAPSHOT_COPIED;
+}
 
 }  // namespace debugger
 
@@ -13,12 +13,14 @@
 #include "coreservices/imemop.h"
 #include "coreservices/iclock.h"
 #include "coreservices/iwire.h"
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
 class GPTimers : public IService, 
                  public IMemoryOperation,
-                 public IClockListener {
+                 public IClockListener,
+                 public ISnapshot {
 public:
     GPTimers(const char *name);
     ~GPTimers();
@@ -32,6 +34,12 @@ public:
     /** IClockListener */
     virtual void stepCallback(uint64_t t);
 
+    /** ISnapshot */
+    virtual uint64_t getSnapshotSize() { return sizeof(regs_); }
+    virtual bool checkSnapshotSize(uint64_t sz) { return sz == sizeof(regs_); }
+    virtual void saveSnapshot(uint8_t *buf);
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz);
+
 private:
     AttributeType irqctrl_;
     AttributeType clksrc_;
@@ -34,7 +34,7 @@ void IrqPort::setLevel(bool level) {
 
 IrqController::IrqController(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
-    registerInterface(static_cast<IClockListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("CPU", &cpu_);
     registerAttribute("CSR_MIPI", &mipi_);
     registerAttribute("IrqTotal", &irqTotal_);
@@ -52,34 +52,37 @@ IrqController::IrqController(const char *name)  : IService(name) {
     memset(&regs_, 0, sizeof(regs_));
     regs_.irq_mask = 0x1e;
     regs_.irq_lock = 1;
+    icpu_ = 0;
+    RISCV_mutex_init(&mutex_);
 }
 
 IrqController::~IrqController() {
+    RISCV_mutex_destroy(&mutex_);
 }
 
 void IrqController::postinitService() {
-    iclk_ = static_cast<IClock *>(
-        RISCV_get_service_iface(cpu_.to_string(), IFACE_CLOCK));
-    if (!iclk_) {
-        RISCV_error("Can't find IClock interface %s", cpu_.to_string());
-        return;
+    if (cpu_.is_list() && cpu_.size() == 2) {
+        // Hart of the multi-core service: ['service', 'port']
+        icpu_ = static_cast<ICpuGeneric *>(
+            RISCV_get_service_port_iface(cpu_[0u].to_string(),
+                                         cpu_[1].to_string(),
+                                         IFACE_CPU_GENERIC));
+    } else {
+        icpu_ = static_cast<ICpuGeneric *>(
+            RISCV_get_service_iface(cpu_.to_string(), IFACE_CPU_GENERIC));
     }
-
-    icpu_ = static_cast<ICpuGeneric *>(
-        RISCV_get_service_iface(cpu_.to_string(), IFACE_CPU_GENERIC));
     if (!icpu_) {
-        RISCV_error("Can't find ICpuRiscV interface %s", cpu_.to_string());
+        RISCV_error("Can't find ICpuGeneric interface %s",
+                    cpu_.is_list() ? cpu_[0u].to_string() : cpu_.to_string());
         return;
     }
-    uint64_t t = iclk_->getStepCounter();
-    iclk_->registerStepCallback(static_cast<IClockListener *>(this), t + 1);
 }
 
 ETransStatus IrqController::b_transport(Axi4TransactionType *trans) {
     uint64_t mask = (length_.to_uint64() - 1);
     uint64_t off = ((trans->addr - getBaseAddress()) & mask) / 4;
-    uint32_t t1;
     trans->response = MemResp_Valid;
+    RISCV_mutex_lock(&mutex_);
     if (trans->action == MemAction_Write) {
         for (uint64_t i = 0; i < trans->xsize/4; i++) {
             if (((trans->wstrb >> 4*i) & 0xFF) == 0) {
@@ -90,22 +93,22 @@ ETransStatus IrqController::b_transport(Axi4TransactionType *trans) {
             case 0:
                 regs_.irq_mask = trans->wpayload.b32[i] & 0x1e;
                 RISCV_info("Set irq_mask = %08x", trans->wpayload.b32[i]);
+                updateInterruptLine();
                 break;
             case 1:
                 regs_.irq_pending = trans->wpayload.b32[i] & 0x1e;
                 RISCV_info("Set irq_pending = %08x", trans->wpayload.b32[i]);
+                updateInterruptLine();
                 break;
             case 2:
-                t1 = regs_.irq_pending;
                 regs_.irq_pending &= ~trans->wpayload.b32[i];
-                if (t1 && !regs_.irq_pending) {
-                    icpu_->lowerSignal(INTERRUPT_MExternal);
-                }
                 RISCV_info("Set irq_clear = %08x", trans->wpayload.b32[i]);
+                updateInterruptLine();
                 break;
             case 3:
                 regs_.irq_pending |= trans->wpayload.b32[i];
                 RISCV_info("Set irq_rise = %08x", trans->wpayload.b32[i]);
+                updateInterruptLine();
                 break;
             case 4:
                 regs_.isr_table &= ~0xFFFFFFFFLL;
@@ -148,9 +151,7 @@ ETransStatus IrqController::b_transport(Axi4TransactionType *trans) {
             case 10:
                 regs_.irq_lock = trans->wpayload.b32[i];
                 RISCV_info("Set irq_ena = %08x", trans->wpayload.b32[i]);
-                if (regs_.irq_lock == 0 && regs_.irq_pending) {
-                    icpu_->lowerSignal(INTERRUPT_MExternal);
-                }
+                updateInterruptLine();
                 break;
             case 11:
                 regs_.irq_cause_idx = trans->wpayload.b32[i];
@@ -228,24 +229,64 @@ ETransStatus IrqController::b_transport(Axi4TransactionType *trans) {
             }
         }
     }
+    RISCV_mutex_unlock(&mutex_);
     return TRANS_OK;
 }
 
-void IrqController::stepCallback(uint64_t t) {
-    iclk_->registerStepCallback(static_cast<IClockListener *>(this), t + 1);
-    if (regs_.irq_lock == 1) {
+void IrqController::requestInterrupt(int idx) {
+    RISCV_mutex_lock(&mutex_);
+    regs_.irq_pending |= (0x1 << idx);
+    RISCV_info("request Interrupt %d", idx);
+    updateInterruptLine();
+    RISCV_mutex_unlock(&mutex_);
+}
+
+uint64_t IrqController::getSnapshotSize() {
+    return sizeof(regs_) + sizeof(uint32_t);
+}
+
+void IrqController::saveSnapshot(uint8_t *buf) {
+    uint32_t levels = 0;
+    for (int i = 1; i < IRQ_MAX; i++) {
+        if (irqlines_[i]->getLevel()) {
+            levels |= 1u << i;
+        }
+    }
+    RISCV_mutex_lock(&mutex_);
+    memcpy(buf, &regs_, sizeof(regs_));
+    RISCV_mutex_unlock(&mutex_);
+    memcpy(&buf[sizeof(regs_)], &levels, sizeof(levels));
+}
+
+ESnapshotStatus IrqController::restoreSnapshot(uint8_t *buf, uint64_t sz) {
+    uint32_t levels;
+    if (sz != getSnapshotSize()) {
+        RISCV_error("Wrong snapshot size %" RV_PRI64 "d", sz);
+        return SNAPSHOT_ERROR;
+    }
+    RISCV_mutex_lock(&mutex_);
+    memcpy(&regs_, buf, sizeof(regs_));
+    memcpy(&levels, &buf[sizeof(regs_)], sizeof(levels));
+    for (int i = 1; i < IRQ_MAX; i++) {
+        irqlines_[i]->restoreLevel(((levels >> i) & 0x1) != 0);
+    }
+    updateInterruptLine();
+    RISCV_mutex_unlock(&mutex_);
+    return SNAPSHOT_COPIED;
+}
+
+void IrqController::updateInterruptLine() {
+    if (!icpu_) {
         return;
     }
-    if (~regs_.irq_mask & regs_.irq_pending) {
+    if (regs_.irq_lock == 0 && (~regs_.irq_mask & regs_.irq_pending)) {
         icpu_->raiseSignal(INTERRUPT_MExternal);   // PLIC interrupt (external)
         RISCV_debug("Raise interrupt", NULL);
+    } else {
+        icpu_->lowerSignal(INTERRUPT_MExternal);
+        RISCV_debug("Lower interrupt", NULL);
     }
 }
 
-void IrqController::requestInterrupt(int idx) {
-    regs_.irq_pending |= (0x1 << idx);
-    RISCV_info("request Interrupt %d", idx);
-}
-
 }  // namespace debugger
 
@@ -10,10 +10,10 @@
 
 #include <iclass.h>
 #include <iservice.h>
-#include "coreservices/iclock.h"
 #include "coreservices/imemop.h"
 #include "coreservices/iwire.h"
 #include "coreservices/icpugen.h"
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
@@ -27,6 +27,9 @@ class IrqPort : public IWire {
     virtual void setLevel(bool level);
     virtual bool getLevel() { return level_; }
 
+    /** Restore line state without side effects */
+    void restoreLevel(bool level) { level_ = level; }
+
  protected:
     IService *parent_;
     int idx_;
@@ -35,7 +38,7 @@ class IrqPort : public IWire {
 
 class IrqController : public IService, 
                       public IMemoryOperation,
-                      public IClockListener {
+                      public ISnapshot {
  public:
     IrqController(const char *name);
     ~IrqController();
@@ -46,20 +49,34 @@ class IrqController : public IService,
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *payload);
 
-    /** IClockListener interface */
-    virtual void stepCallback(uint64_t t);
+    /** ISnapshot */
+    virtual uint64_t getSnapshotSize();
+    virtual bool checkSnapshotSize(uint64_t sz) {
+        return sz == getSnapshotSize();
+    }
+    virtual void saveSnapshot(uint8_t *buf);
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz);
 
     /** Controller specific methods visible for ports */
     void requestInterrupt(int idx);
 
+ private:
+    /**
+     * Recompute CPU-facing line on each register or port event. Called
+     * with mutex_ locked: ports are raised from the CPU thread and from
+     * the host threads (UART input), so the pending state and the line
+     * are updated atomically.
+     */
+    void updateInterruptLine();
+
  private:
     AttributeType mipi_;
     AttributeType irqTotal_;
     AttributeType cpu_;
     ICpuGeneric *icpu_;
-    IClock *iclk_;
     static const int IRQ_MAX = 32;
     IrqPort *irqlines_[IRQ_MAX];
+    mutex_def mutex_;
 
     struct irqctrl_map {
         uint32_t irq_mask;      // 0x00: [RW] 1=disable; 0=enable
@@ -28,6 +28,7 @@ UART::UART(const char *name) : RegMemBankGeneric(name),
     data_(static_cast<IService *>(this), "data", 0x10) {
     registerInterface(static_cast<ISerial *>(this));
     registerInterface(static_cast<IClockListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("FifoSize", &fifoSize_);
     registerAttribute("IrqControl", &irqctrl_);
     registerAttribute("Clock", &clock_);
@@ -177,6 +178,45 @@ void UART::stepCallback(uint64_t t) {
 #endif
 }
 
+uint64_t UART::getSnapshotSize() {
+    return sizeof(snapshot_type) + fifoSize_.to_uint64();
+}
+
+void UART::saveSnapshot(uint8_t *buf) {
+    snapshot_type *p = reinterpret_cast<snapshot_type *>(buf);
+    p->status = status_.getValue().val;
+    p->scaler = scaler_.getValue().val;
+    p->rx_total = rx_total_;
+    p->rx_rd_idx = static_cast<int32_t>(p_rx_rd_ - rxfifo_);
+    p->rx_wr_idx = static_cast<int32_t>(p_rx_wr_ - rxfifo_);
+    p->tx_wcnt = tx_wcnt_;
+    p->tx_rcnt = tx_rcnt_;
+    p->tx_total = tx_total_;
+    p->t_cb_cnt = t_cb_cnt_;
+    memcpy(p->tx_fifo, tx_fifo_, sizeof(tx_fifo_));
+    memcpy(&buf[sizeof(snapshot_type)], rxfifo_, fifoSize_.to_int());
+}
+
+ESnapshotStatus UART::restoreSnapshot(uint8_t *buf, uint64_t sz) {
+    snapshot_type *p = reinterpret_cast<snapshot_type *>(buf);
+    if (sz != getSnapshotSize()) {
+        RISCV_error("Wrong snapshot size %" RV_PRI64 "d", sz);
+        return SNAPSHOT_ERROR;
+    }
+    status_.setValue(p->status);
+    scaler_.setValue(p->scaler);
+    rx_total_ = p->rx_total;
+    p_rx_rd_ = rxfifo_ + p->rx_rd_idx;
+    p_rx_wr_ = rxfifo_ + p->rx_wr_idx;
+    tx_wcnt_ = p->tx_wcnt;
+    tx_rcnt_ = p->tx_rcnt;
+    tx_total_ = p->tx_total;
+    t_cb_cnt_ = p->t_cb_cnt;
+    memcpy(tx_fifo_, p->tx_fifo, sizeof(tx_fifo_));
+    memcpy(rxfifo_, &buf[sizeof(snapshot_type)], fifoSize_.to_int());
+    return SNAPSHOT_COPIED;
+}
+
 void UART::putByte(char v) {
     char tbuf[2] = {v};
     uint64_t t = iclk_->getStepCounter();
@@ -26,6 +26,7 @@
 #include "coreservices/iclock.h"
 #include "coreservices/icommand.h"
 #include "coreservices/icmdexec.h"
+#include "coreservices/isnapshot.h"
 #include "generic/mapreg.h"
 #include "generic/rmembank_gen1.h"
 
@@ -70,7 +71,8 @@ class UartCmdType : public ICommand {
 
 class UART : public RegMemBankGeneric,
              public ISerial,
-             public IClockListener {
+             public IClockListener,
+             public ISnapshot {
  public:
     explicit UART(const char *name);
     virtual ~UART();
@@ -90,6 +92,14 @@ class UART : public RegMemBankGeneric,
     /** IClockListener */
     virtual void stepCallback(uint64_t t);
 
+    /** ISnapshot */
+    virtual uint64_t getSnapshotSize();
+    virtual bool checkSnapshotSize(uint64_t sz) {
+        return sz == getSnapshotSize();
+    }
+    virtual void saveSnapshot(uint8_t *buf);
+    virtual ESnapshotStatus restoreSnapshot(uint8_t *buf, uint64_t sz);
+
     /** Common methods */
     void setScaler(uint32_t scaler);
     int getFifoSize() { return fifoSize_.to_int(); }
@@ -192,6 +202,20 @@ class UART : public RegMemBankGeneric,
     DWORD_TYPE fwcpuid_;
     DATA_TYPE data_;
     int t_cb_cnt_;
+
+    /** Snapshot header followed by the Rx FIFO content */
+    struct snapshot_type {
+        uint32_t status;
+        uint32_t scaler;
+        int32_t rx_total;
+        int32_t rx_rd_idx;
+        int32_t rx_wr_idx;
+        int32_t tx_wcnt;
+        int32_t tx_rcnt;
+        int32_t tx_total;
+        int32_t t_cb_cnt;
+        char tx_fifo[FIFOSZ];
+    };
 };
 
 DECLARE_CLASS(UART)
@@ -15,9 +15,10 @@
  *
  * Packet format:
  *             Write command: 
- *                 Send     [11.Length-1].Addr[63:0].Data[31:0]*(x Length)
+ *                 Send     0x31.[11.Length-1].Addr[63:0].Data[31:0]*(x Length)
+ *                 Receive  "ACK\n"
  *             Read command: 
- *                 Send     [10.Length-1].Addr[63:0]
+ *                 Send     0x31.[10.Length-1].Addr[63:0]
  *                 Receive  Data[31:0]*(x Length)
  */
 
@@ -92,13 +93,13 @@ void UartMst::busyLoop() {
 
         if (!baudrate_detect_) {
             // Symbol 0x55 runs baudrate detector
-            if (packet.cmd == 0x55) {
+            if (packet.magic == 0x55) {
                 baudrate_detect_ = true;
             }
             continue;
         }
 
-        if ((packet.cmd & 0x80) == 0) {
+        if (packet.magic != UART_MST_MAGIC_ID || (packet.cmd & 0x80) == 0) {
             RISCV_error("Wrong request format", NULL);
             continue;
         }
@@ -122,19 +123,26 @@ void UartMst::busyLoop() {
             if (RISCV_event_wait_ms(&event_tap_, 500) != 0) {
                 RISCV_error("CPU queue callback timeout", NULL);
             } else if (trans_.action == MemAction_Read) {
-                RISCV_mutex_lock(&mutexListeners_);
-                for (unsigned n = 0; n < listeners_.size(); n++) {
-                    IRawListener *lstn = static_cast<IRawListener *>(
-                                        listeners_[n].to_iface());
-                    lstn->updateData(
-                        reinterpret_cast<char *>(trans_.rpayload.b8),
-                        trans_.xsize);
-                }
-                RISCV_mutex_unlock(&mutexListeners_);
+                sendToListeners(reinterpret_cast<char *>(trans_.rpayload.b8),
+                                trans_.xsize);
             }
             trans_.addr += 4;
         }
+        if (trans_.action == MemAction_Write) {
+            // Handshake on write request
+            sendToListeners("ACK\n", 4);
+        }
+    }
+}
+
+void UartMst::sendToListeners(const char *buf, int sz) {
+    RISCV_mutex_lock(&mutexListeners_);
+    for (unsigned n = 0; n < listeners_.size(); n++) {
+        IRawListener *lstn = static_cast<IRawListener *>(
+                            listeners_[n].to_iface());
+        lstn->updateData(buf, sz);
     }
+    RISCV_mutex_unlock(&mutexListeners_);
 }
 
 int UartMst::writeData(const char *buf, int sz) {
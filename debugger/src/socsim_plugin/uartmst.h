@@ -30,9 +30,11 @@
 namespace debugger {
 
 static const int UART_MST_BURST_MAX = 64;
+static const uint8_t UART_MST_MAGIC_ID = 0x31;
 
 #pragma pack(1)
 struct UartMstPacketType {
+    uint8_t magic;
     uint8_t cmd;
     Reg64Type addr;
     Reg64Type data[UART_MST_BURST_MAX];
@@ -65,6 +67,9 @@ protected:
     /** IThread interface */
     virtual void busyLoop();
 
+private:
+    void sendToListeners(const char *buf, int sz);
+
 private:
     AttributeType listeners_;  // non-registering attribute
     AttributeType bus_;